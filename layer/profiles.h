@@ -45,6 +45,9 @@ std::string GetDebugReportsLog(DebugActionFlags flags);
 #define kLayerSettingsProfileDirs "profile_dirs"
 #define kLayerSettingsProfileName "profile_name"
 #define kLayerSettingsProfileValidation "profile_validation"
+#define kLayerSettingsProfileCacheDir "profile_cache_dir"
+#define kLayerSettingsProfileParallelLoading "profile_parallel_loading"
+#define kLayerSettingsProfileHotReload "profile_hot_reload"
 #define kLayerSettingsEmulatePortability "emulate_portability"
 #define kLayerSettings_constantAlphaColorBlendFactors "constantAlphaColorBlendFactors"
 #define kLayerSettings_events "events"
@@ -65,8 +68,10 @@ std::string GetDebugReportsLog(DebugActionFlags flags);
 #define kLayerSettingsSimulateCapabilities "simulate_capabilities"
 #define kLayerSettingsDebugActions "debug_actions"
 #define kLayerSettingsDebugFilename "debug_filename"
+#define kLayerSettingsDebugMismatchFilename "debug_mismatch_filename"
 #define kLayerSettingsDebugFileClear "debug_file_clear"
 #define kLayerSettingsDebugFailOnError "debug_fail_on_error"
+#define kLayerSettingsDebugAsync "debug_async"
 #define kLayerSettingsDebugReports "debug_reports"
 #define kLayerSettingsExcludeDeviceExtensions "exclude_device_extensions"
 #define kLayerSettingsExcludeFormats "exclude_formats"
@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2024-2024 Valve Corporation
+ * Copyright (C) 2024-2024 LunarG, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Author: Christophe Riccio <christophe@lunarg.com>
+ */
+
+#include "profiles_async_log.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <string>
+
+AsyncLogWriter::AsyncLogWriter(bool write_stdout, FILE *file)
+    : write_stdout_(write_stdout), file_(file), slots_(new Slot[kSlotCount]) {
+    for (std::size_t i = 0; i < kSlotCount; ++i) {
+        slots_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    thread_ = std::thread(&AsyncLogWriter::Run, this);
+}
+
+AsyncLogWriter::~AsyncLogWriter() {
+    {
+        std::lock_guard<std::mutex> lock(lock_);
+        stop_ = true;
+    }
+    wake_.notify_one();
+    thread_.join();
+}
+
+bool AsyncLogWriter::Push(const char *message) {
+    std::size_t position = push_position_.load(std::memory_order_relaxed);
+    for (;;) {
+        Slot &slot = slots_[position & (kSlotCount - 1)];
+        const std::size_t sequence = slot.sequence.load(std::memory_order_acquire);
+        const std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(position);
+        if (diff == 0) {
+            if (push_position_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                snprintf(slot.message, kMessageSize, "%s", message);
+                slot.sequence.store(position + 1, std::memory_order_release);
+
+                // Write the batch early when half of the ring buffer is used
+                if (((position + 1) & (kSlotCount / 2 - 1)) == 0) {
+                    wake_.notify_one();
+                }
+                return true;
+            }
+        } else if (diff < 0) {
+            // The writer thread is kSlotCount messages behind
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        } else {
+            position = push_position_.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+void AsyncLogWriter::Flush() {
+    std::unique_lock<std::mutex> lock(lock_);
+    const std::size_t position = push_position_.load(std::memory_order_relaxed);
+    flush_position_ = std::max(flush_position_, position);
+    wake_.notify_one();
+    written_.wait(lock, [&] { return written_position_ >= position; });
+}
+
+void AsyncLogWriter::Run() {
+    std::string batch;
+
+    for (bool stop = false; !stop;) {
+        std::size_t flush_position = 0;
+        {
+            std::unique_lock<std::mutex> lock(lock_);
+            wake_.wait_for(lock, std::chrono::milliseconds(kWritePeriodMs),
+                           [&] {
+                               return stop_ || flush_position_ > written_position_ ||
+                                      push_position_.load(std::memory_order_relaxed) - written_position_ >= kSlotCount / 2;
+                           });
+            stop = stop_;
+            flush_position = flush_position_;
+        }
+
+        // A message reserved before the flush request may still be copied by its producer
+        for (;;) {
+            Slot &slot = slots_[pop_position_ & (kSlotCount - 1)];
+            if (slot.sequence.load(std::memory_order_acquire) != pop_position_ + 1) {
+                if (pop_position_ < flush_position || (stop && pop_position_ < push_position_.load(std::memory_order_relaxed))) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                break;
+            }
+            batch += slot.message;
+            slot.sequence.store(pop_position_ + kSlotCount, std::memory_order_release);
+            ++pop_position_;
+        }
+
+        if (!batch.empty()) {
+            if (write_stdout_) {
+                fwrite(batch.data(), 1, batch.size(), stdout);
+                std::fflush(stdout);
+            }
+            if (file_ != nullptr) {
+                fwrite(batch.data(), 1, batch.size(), file_);
+                std::fflush(file_);
+            }
+            batch.clear();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(lock_);
+            written_position_ = pop_position_;
+        }
+        written_.notify_all();
+    }
+}
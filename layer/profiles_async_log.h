@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2024-2024 Valve Corporation
+ * Copyright (C) 2024-2024 LunarG, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Author: Christophe Riccio <christophe@lunarg.com>
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+// Write the log messages to stdout and/or a file from a background thread, in batches. Push() never blocks: the messages are
+// stored in a bounded ring buffer and the messages that don't fit are dropped and counted.
+class AsyncLogWriter {
+   public:
+    static constexpr std::size_t kMessageSize = 4096;  // Maximum size of a message, including the null terminator
+
+    AsyncLogWriter(bool write_stdout, FILE *file);
+    ~AsyncLogWriter();  // Write the pending messages before returning
+
+    AsyncLogWriter(const AsyncLogWriter &) = delete;
+    AsyncLogWriter &operator=(const AsyncLogWriter &) = delete;
+
+    // Thread safe, returns false when the message was dropped
+    bool Push(const char *message);
+
+    // Block until the messages pushed before the call are written and flushed
+    void Flush();
+
+    uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+   private:
+    static constexpr std::size_t kSlotCount = 256;  // Power of two
+    static constexpr int kWritePeriodMs = 20;
+
+    // Vyukov's bounded queue, with multiple producers and a single consumer
+    struct Slot {
+        std::atomic<std::size_t> sequence;
+        char message[kMessageSize];
+    };
+
+    void Run();
+
+    const bool write_stdout_;
+    FILE *const file_;
+    std::unique_ptr<Slot[]> slots_;
+    std::atomic<std::size_t> push_position_{0};
+    std::size_t pop_position_ = 0;  // Only accessed by the writer thread
+
+    std::mutex lock_;
+    std::condition_variable wake_;
+    std::condition_variable written_;
+    std::size_t written_position_ = 0;  // Messages written so far, guarded by lock_
+    std::size_t flush_position_ = 0;    // Messages to write without waiting for the period, guarded by lock_
+    bool stop_ = false;
+
+    std::atomic<uint64_t> dropped_{0};
+    std::thread thread_;
+};
@@ -24,8 +24,22 @@
 #include <valijson/schema_parser.hpp>
 #include <valijson/validator.hpp>
 
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <filesystem>
+#include <thread>
+
+namespace fs = std::filesystem;
+
 std::unique_ptr<valijson::Schema> schema;
 
+bool ParseJson(const char *begin, const char *end, Json::Value *root, std::string *errors) {
+    Json::CharReaderBuilder builder;
+    std::unique_ptr<Json::CharReader> reader(builder.newCharReader());
+    return reader->parse(begin, end, root, errors);
+}
+
 static Json::Value ParseJsonFile(std::string filename) {
     Json::Value root = Json::nullValue;
 
@@ -34,16 +48,13 @@ static Json::Value ParseJsonFile(std::string filename) {
         filename.pop_back();
     }
 
-    std::ifstream file;
-    file.open(filename.c_str());
+    FileBuffer file(filename);
     if (!file.is_open()) {
         return root;
     }
 
     std::string errs;
-    Json::CharReaderBuilder builder;
-    Json::parseFromStream(builder, file, &root, &errs);
-    file.close();
+    ParseJson(file.data(), file.data() + file.size(), &root, &errs);
 
     return root;
 }
@@ -77,7 +88,7 @@ bool JsonValidator::Init() {
     return schema.get() != nullptr;
 }
 
-bool JsonValidator::Check(const Json::Value &json_document) {
+bool JsonValidator::Check(const Json::Value &json_document, std::string *message) const {
     assert(!json_document.empty());
 
     if (schema.get() == nullptr) return true;
@@ -102,13 +113,13 @@ bool JsonValidator::Check(const Json::Value &json_document) {
                 log += "\t context: " + context + "\n";
                 log += "\t desc:    " + error.description + "\n\n";
 
-                message += log.c_str();
+                *message += log.c_str();
             }
 
             ++error_num;
         }
 
-        message += format("Total Error Count: %d\n", error_num).c_str();
+        *message += format("Total Error Count: %d\n", error_num).c_str();
 
         return false;
     }
@@ -131,3 +142,530 @@ bool WarnDuplicated(ProfileLayerSettings *layer_settings, const Json::Value &par
     }
     return set.size() <= 1;
 }
+
+// Minimal JSON scanner only decoding the top-level "$schema" string and the "profiles" member names
+class ProfileIndexScanner {
+   public:
+    ProfileIndexScanner(const char *begin, const char *end) : cur_(begin), end_(end) {}
+
+    bool Scan(ProfileFileIndex *index) {
+        SkipWhitespaces();
+        if (!Consume('{')) return Fail("Expected '{' at the document root");
+
+        SkipWhitespaces();
+        if (Consume('}')) return true;
+
+        do {
+            std::string key;
+            SkipWhitespaces();
+            if (Peek() == '}') break;  // Trailing comma
+            if (!ReadString(&key)) return false;
+            SkipWhitespaces();
+            if (!Consume(':')) return Fail("Expected ':' after object member name");
+            SkipWhitespaces();
+
+            if (key == "$schema" && Peek() == '"') {
+                if (!ReadString(&index->schema)) return false;
+            } else if (key == "profiles" && Peek() == '{') {
+                if (!ReadMemberNames(&index->profiles)) return false;
+            } else if (!SkipValue(0)) {
+                return false;
+            }
+            SkipWhitespaces();
+        } while (Consume(','));
+
+        if (!Consume('}')) return Fail("Expected '}' at the end of the document root");
+        return true;
+    }
+
+    const std::string &error() const { return error_; }
+
+   private:
+    static const uint32_t kMaxDepth = 1024;
+
+    char Peek() const { return cur_ < end_ ? *cur_ : '\0'; }
+
+    bool Consume(char c) {
+        if (cur_ < end_ && *cur_ == c) {
+            ++cur_;
+            return true;
+        }
+        return false;
+    }
+
+    bool Fail(const char *message) {
+        error_ = message;
+        return false;
+    }
+
+    void SkipWhitespaces() {
+        while (cur_ < end_) {
+            if (*cur_ == ' ' || *cur_ == '\t' || *cur_ == '\n' || *cur_ == '\r') {
+                ++cur_;
+            } else if (*cur_ == '/' && cur_ + 1 < end_ && cur_[1] == '/') {
+                while (cur_ < end_ && *cur_ != '\n') ++cur_;
+            } else if (*cur_ == '/' && cur_ + 1 < end_ && cur_[1] == '*') {
+                cur_ += 2;
+                while (cur_ + 1 < end_ && !(cur_[0] == '*' && cur_[1] == '/')) ++cur_;
+                cur_ = cur_ + 1 < end_ ? cur_ + 2 : end_;
+            } else {
+                break;
+            }
+        }
+    }
+
+    bool ReadString(std::string *result) {
+        if (!Consume('"')) return Fail("Expected a string");
+
+        while (cur_ < end_ && *cur_ != '"') {
+            if (*cur_ != '\\') {
+                if (result) result->push_back(*cur_);
+                ++cur_;
+                continue;
+            }
+
+            if (++cur_ == end_) break;
+            const char escape = *cur_++;
+            if (escape == 'u') {
+                if (end_ - cur_ < 4) return Fail("Invalid unicode escape sequence");
+                const unsigned long code = std::strtoul(std::string(cur_, cur_ + 4).c_str(), nullptr, 16);
+                cur_ += 4;
+                if (result) {
+                    // Profile names are ASCII, non-ASCII code points are encoded as UTF-8 without surrogate pairs handling
+                    if (code < 0x80) {
+                        result->push_back(static_cast<char>(code));
+                    } else if (code < 0x800) {
+                        result->push_back(static_cast<char>(0xC0 | (code >> 6)));
+                        result->push_back(static_cast<char>(0x80 | (code & 0x3F)));
+                    } else {
+                        result->push_back(static_cast<char>(0xE0 | (code >> 12)));
+                        result->push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+                        result->push_back(static_cast<char>(0x80 | (code & 0x3F)));
+                    }
+                }
+            } else if (result) {
+                switch (escape) {
+                    case 'b':
+                        result->push_back('\b');
+                        break;
+                    case 'f':
+                        result->push_back('\f');
+                        break;
+                    case 'n':
+                        result->push_back('\n');
+                        break;
+                    case 'r':
+                        result->push_back('\r');
+                        break;
+                    case 't':
+                        result->push_back('\t');
+                        break;
+                    default:
+                        result->push_back(escape);
+                        break;
+                }
+            }
+        }
+
+        if (!Consume('"')) return Fail("Missing '\"' at the end of a string");
+        return true;
+    }
+
+    bool ReadMemberNames(std::vector<std::string> *names) {
+        if (!Consume('{')) return Fail("Expected an object");
+
+        SkipWhitespaces();
+        if (Consume('}')) return true;
+
+        do {
+            std::string name;
+            SkipWhitespaces();
+            if (Peek() == '}') break;  // Trailing comma
+            if (!ReadString(&name)) return false;
+            SkipWhitespaces();
+            if (!Consume(':')) return Fail("Expected ':' after object member name");
+            SkipWhitespaces();
+            if (!SkipValue(1)) return false;
+            SkipWhitespaces();
+            names->push_back(name);
+        } while (Consume(','));
+
+        if (!Consume('}')) return Fail("Expected '}' at the end of an object");
+        return true;
+    }
+
+    bool SkipValue(uint32_t depth) {
+        if (depth > kMaxDepth) return Fail("Exceeded the maximum nesting depth");
+
+        switch (Peek()) {
+            case '"':
+                return ReadString(nullptr);
+            case '{':
+            case '[': {
+                const char close = Peek() == '{' ? '}' : ']';
+                ++cur_;
+                SkipWhitespaces();
+                if (Consume(close)) return true;
+                do {
+                    SkipWhitespaces();
+                    if (Peek() == close) break;  // Trailing comma
+                    if (close == '}') {
+                        if (!ReadString(nullptr)) return false;
+                        SkipWhitespaces();
+                        if (!Consume(':')) return Fail("Expected ':' after object member name");
+                        SkipWhitespaces();
+                    }
+                    if (!SkipValue(depth + 1)) return false;
+                    SkipWhitespaces();
+                } while (Consume(','));
+                if (!Consume(close)) return Fail(close == '}' ? "Expected '}' at the end of an object" : "Expected ']' at the end of an array");
+                return true;
+            }
+            default: {
+                // Numbers, true, false and null
+                const char *begin = cur_;
+                while (cur_ < end_ && (std::isalnum(static_cast<unsigned char>(*cur_)) || *cur_ == '-' || *cur_ == '+' || *cur_ == '.')) {
+                    ++cur_;
+                }
+                if (begin == cur_) return Fail("Expected a value");
+                return true;
+            }
+        }
+    }
+
+    const char *cur_;
+    const char *end_;
+    std::string error_;
+};
+
+bool IndexProfileFile(const std::string &filename, ProfileFileIndex *index, std::string *errors) {
+    assert(index != nullptr);
+
+    FileBuffer file(filename);
+    if (!file.is_open()) {
+        if (errors) *errors = "Fail to open file";
+        return false;
+    }
+
+    ProfileIndexScanner scanner(file.data(), file.data() + file.size());
+    if (!scanner.Scan(index)) {
+        if (errors) *errors = scanner.error();
+        return false;
+    }
+
+    // Match Json::Value::getMemberNames() ordering
+    std::sort(index->profiles.begin(), index->profiles.end());
+    index->profiles.erase(std::unique(index->profiles.begin(), index->profiles.end()), index->profiles.end());
+
+    return true;
+}
+
+static const char kProfileCacheMagic[4] = {'V', 'K', 'P', 'C'};
+static const uint32_t kProfileCacheVersion = 1;
+static const uint32_t kProfileCacheMaxDepth = 256;
+
+struct ProfileCacheHeader {
+    char magic[4];
+    uint32_t cache_version;
+    uint32_t layer_version;
+    uint32_t path_size;
+    uint64_t file_size;
+    int64_t file_time;
+};
+
+enum ProfileCacheTag : uint8_t {
+    PROFILE_CACHE_TAG_NULL = 0,
+    PROFILE_CACHE_TAG_FALSE,
+    PROFILE_CACHE_TAG_TRUE,
+    PROFILE_CACHE_TAG_INT,
+    PROFILE_CACHE_TAG_UINT,
+    PROFILE_CACHE_TAG_REAL,
+    PROFILE_CACHE_TAG_STRING,
+    PROFILE_CACHE_TAG_ARRAY,
+    PROFILE_CACHE_TAG_OBJECT
+};
+
+class ProfileCacheReader {
+   public:
+    ProfileCacheReader(const uint8_t *data, std::size_t size) : cur_(data), end_(data + size) {}
+
+    template <typename T>
+    bool Read(T *value) {
+        if (static_cast<std::size_t>(end_ - cur_) < sizeof(T)) {
+            return false;
+        }
+        std::memcpy(value, cur_, sizeof(T));
+        cur_ += sizeof(T);
+        return true;
+    }
+
+    bool ReadString(uint32_t size, const char **begin) {
+        if (static_cast<std::size_t>(end_ - cur_) < size) {
+            return false;
+        }
+        *begin = reinterpret_cast<const char *>(cur_);
+        cur_ += size;
+        return true;
+    }
+
+    bool ReadValue(Json::Value *value, uint32_t depth) {
+        uint8_t tag = 0;
+        if (depth > kProfileCacheMaxDepth || !Read(&tag)) {
+            return false;
+        }
+
+        switch (tag) {
+            case PROFILE_CACHE_TAG_NULL:
+                *value = Json::Value(Json::nullValue);
+                return true;
+            case PROFILE_CACHE_TAG_FALSE:
+            case PROFILE_CACHE_TAG_TRUE:
+                *value = Json::Value(tag == PROFILE_CACHE_TAG_TRUE);
+                return true;
+            case PROFILE_CACHE_TAG_INT: {
+                int64_t data = 0;
+                if (!Read(&data)) return false;
+                *value = Json::Value(static_cast<Json::Int64>(data));
+                return true;
+            }
+            case PROFILE_CACHE_TAG_UINT: {
+                uint64_t data = 0;
+                if (!Read(&data)) return false;
+                *value = Json::Value(static_cast<Json::UInt64>(data));
+                return true;
+            }
+            case PROFILE_CACHE_TAG_REAL: {
+                double data = 0.0;
+                if (!Read(&data)) return false;
+                *value = Json::Value(data);
+                return true;
+            }
+            case PROFILE_CACHE_TAG_STRING: {
+                uint32_t size = 0;
+                const char *begin = nullptr;
+                if (!Read(&size) || !ReadString(size, &begin)) return false;
+                *value = Json::Value(begin, begin + size);
+                return true;
+            }
+            case PROFILE_CACHE_TAG_ARRAY: {
+                uint32_t count = 0;
+                if (!Read(&count)) return false;
+                *value = Json::Value(Json::arrayValue);
+                for (uint32_t i = 0; i < count; ++i) {
+                    Json::Value element;
+                    if (!ReadValue(&element, depth + 1)) return false;
+                    value->append(std::move(element));
+                }
+                return true;
+            }
+            case PROFILE_CACHE_TAG_OBJECT: {
+                uint32_t count = 0;
+                if (!Read(&count)) return false;
+                *value = Json::Value(Json::objectValue);
+                for (uint32_t i = 0; i < count; ++i) {
+                    uint32_t size = 0;
+                    const char *begin = nullptr;
+                    if (!Read(&size) || !ReadString(size, &begin)) return false;
+                    Json::Value &member = (*value)[std::string(begin, size)];
+                    if (!ReadValue(&member, depth + 1)) return false;
+                }
+                return true;
+            }
+            default:
+                return false;
+        }
+    }
+
+    bool AtEnd() const { return cur_ == end_; }
+
+   private:
+    const uint8_t *cur_;
+    const uint8_t *end_;
+};
+
+class ProfileCacheWriter {
+   public:
+    template <typename T>
+    void Write(const T &value) {
+        const char *begin = reinterpret_cast<const char *>(&value);
+        data_.insert(data_.end(), begin, begin + sizeof(T));
+    }
+
+    void WriteBytes(const char *begin, const char *end) { data_.insert(data_.end(), begin, end); }
+
+    void WriteString(const char *begin, const char *end) {
+        Write(static_cast<uint32_t>(end - begin));
+        WriteBytes(begin, end);
+    }
+
+    void WriteValue(const Json::Value &value) {
+        switch (value.type()) {
+            default:
+            case Json::nullValue:
+                Write(static_cast<uint8_t>(PROFILE_CACHE_TAG_NULL));
+                break;
+            case Json::booleanValue:
+                Write(static_cast<uint8_t>(value.asBool() ? PROFILE_CACHE_TAG_TRUE : PROFILE_CACHE_TAG_FALSE));
+                break;
+            case Json::intValue:
+                Write(static_cast<uint8_t>(PROFILE_CACHE_TAG_INT));
+                Write(static_cast<int64_t>(value.asInt64()));
+                break;
+            case Json::uintValue:
+                Write(static_cast<uint8_t>(PROFILE_CACHE_TAG_UINT));
+                Write(static_cast<uint64_t>(value.asUInt64()));
+                break;
+            case Json::realValue:
+                Write(static_cast<uint8_t>(PROFILE_CACHE_TAG_REAL));
+                Write(value.asDouble());
+                break;
+            case Json::stringValue: {
+                const char *begin = nullptr;
+                const char *end = nullptr;
+                value.getString(&begin, &end);
+                Write(static_cast<uint8_t>(PROFILE_CACHE_TAG_STRING));
+                WriteString(begin, end);
+                break;
+            }
+            case Json::arrayValue:
+                Write(static_cast<uint8_t>(PROFILE_CACHE_TAG_ARRAY));
+                Write(static_cast<uint32_t>(value.size()));
+                for (const auto &element : value) {
+                    WriteValue(element);
+                }
+                break;
+            case Json::objectValue:
+                Write(static_cast<uint8_t>(PROFILE_CACHE_TAG_OBJECT));
+                Write(static_cast<uint32_t>(value.size()));
+                for (auto it = value.begin(), end = value.end(); it != end; ++it) {
+                    const char *name_end = nullptr;
+                    const char *name_begin = it.memberName(&name_end);
+                    WriteString(name_begin, name_end);
+                    WriteValue(*it);
+                }
+                break;
+        }
+    }
+
+    const std::vector<char> &data() const { return data_; }
+
+   private:
+    std::vector<char> data_;
+};
+
+static std::string GetProfileCachePath(const std::string &cache_dir, const std::string &filename) {
+    // FNV-1a hash of the profile file path to name the cache entry
+    uint64_t hash = 14695981039346656037ull;
+    for (char c : filename) {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 1099511628211ull;
+    }
+
+    return (fs::path(cache_dir) / format("%016" PRIx64 ".profile_cache", hash)).generic_string();
+}
+
+bool GetProfileFileStamp(const std::string &filename, ProfileFileStamp *stamp) {
+    assert(stamp != nullptr);
+
+    std::error_code error;
+    const auto size = fs::file_size(filename, error);
+    if (error) {
+        return false;
+    }
+    const auto time = fs::last_write_time(filename, error);
+    if (error) {
+        return false;
+    }
+
+    stamp->file_size = static_cast<uint64_t>(size);
+    stamp->file_time = static_cast<int64_t>(time.time_since_epoch().count());
+    return true;
+}
+
+bool LoadProfileCache(const std::string &cache_dir, const std::string &filename, const ProfileFileStamp &stamp,
+                      uint32_t layer_version, Json::Value *root) {
+    assert(root != nullptr);
+
+    if (cache_dir.empty()) {
+        return false;
+    }
+
+    // Cache entries are only replaced by a rename, never modified in place, so they can be mapped
+    MappedFile cache_file(GetProfileCachePath(cache_dir, filename));
+    if (!cache_file.is_open()) {
+        return false;
+    }
+
+    ProfileCacheReader reader(reinterpret_cast<const uint8_t *>(cache_file.data()), cache_file.size());
+
+    ProfileCacheHeader header = {};
+    if (!reader.Read(&header)) {
+        return false;
+    }
+    if (std::memcmp(header.magic, kProfileCacheMagic, sizeof(header.magic)) != 0 || header.cache_version != kProfileCacheVersion ||
+        header.layer_version != layer_version || header.file_size != stamp.file_size || header.file_time != stamp.file_time) {
+        return false;
+    }
+
+    const char *path = nullptr;
+    if (!reader.ReadString(header.path_size, &path) || filename.compare(0, std::string::npos, path, header.path_size) != 0) {
+        return false;
+    }
+
+    Json::Value value;
+    if (!reader.ReadValue(&value, 0) || !reader.AtEnd()) {
+        return false;
+    }
+
+    *root = std::move(value);
+    return true;
+}
+
+bool StoreProfileCache(const std::string &cache_dir, const std::string &filename, const ProfileFileStamp &stamp,
+                       uint32_t layer_version, const Json::Value &root) {
+    if (cache_dir.empty()) {
+        return false;
+    }
+
+    ProfileCacheHeader header = {};
+    std::memcpy(header.magic, kProfileCacheMagic, sizeof(header.magic));
+    header.cache_version = kProfileCacheVersion;
+    header.layer_version = layer_version;
+    header.path_size = static_cast<uint32_t>(filename.size());
+    header.file_size = stamp.file_size;
+    header.file_time = stamp.file_time;
+
+    ProfileCacheWriter writer;
+    writer.Write(header);
+    writer.WriteBytes(filename.data(), filename.data() + filename.size());
+    writer.WriteValue(root);
+
+    std::error_code error;
+    fs::create_directories(cache_dir, error);
+
+    // Write to a temporary file first so that concurrent instances never read a partial cache entry
+    const std::string cache_path = GetProfileCachePath(cache_dir, filename);
+    const std::size_t temp_id = std::hash<std::thread::id>{}(std::this_thread::get_id()) ^
+                                static_cast<std::size_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+    const std::string temp_path = format("%s.%zx.tmp", cache_path.c_str(), temp_id);
+    {
+        std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+        if (!file) {
+            return false;
+        }
+        file.write(writer.data().data(), static_cast<std::streamsize>(writer.data().size()));
+        if (!file) {
+            file.close();
+            fs::remove(temp_path, error);
+            return false;
+        }
+    }
+
+    fs::rename(temp_path, cache_path, error);
+    if (error) {
+        fs::remove(temp_path, error);
+        return false;
+    }
+
+    return true;
+}
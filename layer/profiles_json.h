@@ -21,6 +21,7 @@
 #include <json/json.h>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "profiles_settings.h"
 
@@ -30,9 +31,35 @@ struct JsonValidator {
 
     bool Init();
 
-    bool Check(const Json::Value &json_document);
-
-    std::string message;
+    // Can be called concurrently once Init() succeeded
+    bool Check(const Json::Value &json_document, std::string *message) const;
 };
 
 bool WarnDuplicated(ProfileLayerSettings *layer_settings, const Json::Value &parent, const std::vector<std::string> &members);
+
+// Parse a JSON document in place from a memory range, such as a FileBuffer
+bool ParseJson(const char *begin, const char *end, Json::Value *root, std::string *errors);
+
+// Top-level information of a profile file, read without building the whole JSON document
+struct ProfileFileIndex {
+    std::string schema;
+    std::vector<std::string> profiles;
+};
+
+bool IndexProfileFile(const std::string &filename, ProfileFileIndex *index, std::string *errors);
+
+// Size and last write time identifying the version of a profile file
+struct ProfileFileStamp {
+    uint64_t file_size;
+    int64_t file_time;
+};
+
+bool GetProfileFileStamp(const std::string &filename, ProfileFileStamp *stamp);
+
+// Binary cache of the parsed profile files, stored in the directory set by the `profile_cache_dir` layer setting.
+// A cache entry is only used when the profile file path, stamp and the layer version all match. The stamp must be taken
+// before the profile file is read, so that an entry is never stored with the stamp of a newer file version.
+bool LoadProfileCache(const std::string &cache_dir, const std::string &filename, const ProfileFileStamp &stamp,
+                      uint32_t layer_version, Json::Value *root);
+bool StoreProfileCache(const std::string &cache_dir, const std::string &filename, const ProfileFileStamp &stamp,
+                       uint32_t layer_version, const Json::Value &root);
@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2024-2024 Valve Corporation
+ * Copyright (C) 2024-2024 LunarG, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Author: Christophe Riccio <christophe@lunarg.com>
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Compatibility between the device queue families (rows) and the profile queue families (columns)
+class QueueFamilyMatrix {
+   public:
+    QueueFamilyMatrix(std::size_t device_count, std::size_t profile_count)
+        : device_count_(device_count), profile_count_(profile_count), values_(device_count * profile_count, false) {}
+
+    std::size_t device_count() const { return device_count_; }
+    std::size_t profile_count() const { return profile_count_; }
+
+    bool Get(std::size_t device, std::size_t profile) const { return values_[device * profile_count_ + profile]; }
+    void Set(std::size_t device, std::size_t profile, bool value) { values_[device * profile_count_ + profile] = value; }
+
+   private:
+    std::size_t device_count_;
+    std::size_t profile_count_;
+    std::vector<bool> values_;
+};
+
+// Kuhn's augmenting path from a profile queue family, over the device queue families not yet assigned
+inline bool AugmentQueueFamilyMatching(const QueueFamilyMatrix &matrix, std::size_t first_free_device, std::size_t profile,
+                                       std::vector<bool> *visited, std::vector<std::size_t> *device_match) {
+    for (std::size_t device = first_free_device, n = matrix.device_count(); device < n; ++device) {
+        if (!matrix.Get(device, profile) || (*visited)[device]) {
+            continue;
+        }
+        (*visited)[device] = true;
+
+        const std::size_t matched_profile = (*device_match)[device];
+        if (matched_profile == matrix.profile_count() ||
+            AugmentQueueFamilyMatching(matrix, first_free_device, matched_profile, visited, device_match)) {
+            (*device_match)[device] = profile;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Whether the profile queue families not yet assigned can all be matched with the device queue families from first_free_device
+inline bool HasQueueFamilyMatching(const QueueFamilyMatrix &matrix, std::size_t first_free_device,
+                                   const std::vector<bool> &assigned_profiles) {
+    std::vector<std::size_t> device_match(matrix.device_count(), matrix.profile_count());
+    std::vector<bool> visited(matrix.device_count());
+
+    for (std::size_t profile = 0, n = matrix.profile_count(); profile < n; ++profile) {
+        if (assigned_profiles[profile]) {
+            continue;
+        }
+        visited.assign(visited.size(), false);
+        if (!AugmentQueueFamilyMatching(matrix, first_free_device, profile, &visited, &device_match)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Assign each profile queue family to a distinct compatible device queue family. The assignment is the first one in the order
+// of std::next_permutation over the device queue families: each device queue family takes the lowest profile queue family
+// that still allows a complete matching, using bipartite matching instead of enumerating the permutations.
+// On success, (*assignment)[device] is the profile queue family index, or matrix.profile_count() when the device queue family
+// isn't assigned.
+inline bool AssignQueueFamilies(const QueueFamilyMatrix &matrix, std::vector<std::size_t> *assignment) {
+    const std::size_t device_count = matrix.device_count();
+    const std::size_t profile_count = matrix.profile_count();
+
+    if (device_count < profile_count) {
+        return false;
+    }
+
+    std::vector<bool> assigned_profiles(profile_count, false);
+    if (!HasQueueFamilyMatching(matrix, 0, assigned_profiles)) {
+        return false;
+    }
+
+    assignment->assign(device_count, profile_count);
+
+    // When no profile queue family can be assigned to a device queue family, the remaining profile queue families have a
+    // matching without it, so leaving it unassigned, which comes last in the permutation order, is always possible.
+    for (std::size_t device = 0; device < device_count; ++device) {
+        for (std::size_t profile = 0; profile < profile_count; ++profile) {
+            if (assigned_profiles[profile] || !matrix.Get(device, profile)) {
+                continue;
+            }
+
+            assigned_profiles[profile] = true;
+            if (HasQueueFamilyMatching(matrix, device + 1, assigned_profiles)) {
+                (*assignment)[device] = profile;
+                break;
+            }
+            assigned_profiles[profile] = false;
+        }
+    }
+
+    return true;
+}
@@ -19,10 +19,14 @@
 
 #include "profiles_settings.h"
 #include "profiles_util.h"
+#include "profiles_async_log.h"
 
 void WarnMissingFormatFeatures(ProfileLayerSettings *layer_settings, const char *device_name, const std::string &format_name,
                                const std::string &features, VkFormatFeatureFlags profile_features,
                                VkFormatFeatureFlags device_features) {
+    LOG_MISMATCH(layer_settings, device_name, format_name.c_str(), features.c_str(), "missing_bits", true, profile_features,
+                 device_features);
+
     if (!(layer_settings->log.debug_reports & DEBUG_REPORT_WARNING_BIT)) {
         return;
     }
@@ -37,6 +41,9 @@ void WarnMissingFormatFeatures(ProfileLayerSettings *layer_settings, const char
 void WarnMissingFormatFeatures2(ProfileLayerSettings *layer_settings, const char *device_name, const std::string &format_name,
                                 const std::string &features, VkFormatFeatureFlags2 profile_features,
                                 VkFormatFeatureFlags2 device_features) {
+    LOG_MISMATCH(layer_settings, device_name, format_name.c_str(), features.c_str(), "missing_bits", true, profile_features,
+                 device_features);
+
     if (!(layer_settings->log.debug_reports & DEBUG_REPORT_WARNING_BIT)) {
         return;
     }
@@ -50,6 +57,10 @@ void WarnMissingFormatFeatures2(ProfileLayerSettings *layer_settings, const char
 
 
 
+ProfileLayerSettings::ProfileLayerSettings() = default;
+
+ProfileLayerSettings::~ProfileLayerSettings() { LogClose(this); }
+
 std::string GetDebugActionsLog(DebugActionFlags flags) {
     std::string result = {};
 
@@ -128,16 +139,20 @@ void LogMessage(ProfileLayerSettings *layer_settings, DebugReportBits report, co
     vsnprintf(log + len, STRING_BUFFER - len, message, list);
     va_end(list);
 
-    if (layer_settings->log.debug_actions & DEBUG_ACTION_STDOUT_BIT) {
+    if (layer_settings->log.async_writer) {
+        layer_settings->log.async_writer->Push(log);
+    } else {
+        if (layer_settings->log.debug_actions & DEBUG_ACTION_STDOUT_BIT) {
 #if defined(__ANDROID__)
-        AndroidPrintf(report, log);
+            AndroidPrintf(report, log);
 #else
-        fprintf(stdout, "%s", log);
+            fprintf(stdout, "%s", log);
 #endif
-    }
+        }
 
-    if (layer_settings->log.debug_actions & DEBUG_ACTION_FILE_BIT) {
-        fprintf(layer_settings->log.profiles_log_file, "%s", log);
+        if (layer_settings->log.debug_actions & DEBUG_ACTION_FILE_BIT) {
+            fprintf(layer_settings->log.profiles_log_file, "%s", log);
+        }
     }
 
 #if _WIN32
@@ -155,6 +170,19 @@ void LogMessage(ProfileLayerSettings *layer_settings, DebugReportBits report, co
     }
 }
 
+void LogMismatch(ProfileLayerSettings *layer_settings, const char *device_name, const char *struct_name, const char *member_name,
+                 const char *comparison, bool modifiable, const std::string &profile_value, const std::string &device_value) {
+    if (layer_settings->log.mismatch_file == nullptr) {
+        return;
+    }
+
+    const std::string record =
+        FormatMismatchRecord(device_name, struct_name, member_name, comparison, modifiable, profile_value, device_value);
+
+    // A single write per record, so that the records of concurrent threads are not interleaved
+    fwrite(record.data(), 1, record.size(), layer_settings->log.mismatch_file);
+}
+
 void LogFlush(ProfileLayerSettings *layer_settings) {
 #if defined(__ANDROID__)
     if (!layer_settings) return;
@@ -162,6 +190,15 @@ void LogFlush(ProfileLayerSettings *layer_settings) {
     assert(layer_settings);
 #endif
 
+    if (layer_settings->log.mismatch_file != nullptr) {
+        std::fflush(layer_settings->log.mismatch_file);
+    }
+
+    if (layer_settings->log.async_writer) {
+        layer_settings->log.async_writer->Flush();
+        return;
+    }
+
     if (layer_settings->log.debug_actions & DEBUG_ACTION_STDOUT_BIT) {
         std::fflush(stdout);
     }
@@ -170,6 +207,23 @@ void LogFlush(ProfileLayerSettings *layer_settings) {
     }
 }
 
+void LogClose(ProfileLayerSettings *layer_settings) {
+    // Write the pending messages before closing the log file
+    layer_settings->log.async_writer.reset();
+
+    if (layer_settings->log.profiles_log_file != nullptr) {
+        fclose(layer_settings->log.profiles_log_file);
+        layer_settings->log.profiles_log_file = nullptr;
+    }
+
+    if (layer_settings->log.mismatch_file != nullptr) {
+        fclose(layer_settings->log.mismatch_file);
+        layer_settings->log.mismatch_file = nullptr;
+    }
+
+    layer_settings->log.debug_actions &= ~(DEBUG_ACTION_FILE_BIT | DEBUG_ACTION_MISMATCH_FILE_BIT);
+}
+
 static ForceDevice GetForceDevice(const std::string &value) {
     if (value == "FORCE_DEVICE_OFF") {
         return FORCE_DEVICE_OFF;
@@ -203,6 +257,77 @@ static std::vector<std::string> Split(const std::string &value, const std::strin
     return result;
 }
 
+static std::string GetSettingsLog(const ProfileLayerSettings *layer_settings) {
+    const std::string profile_dirs = GetString(layer_settings->simulate.profile_dirs);
+    const std::string simulation_capabilities_log = GetSimulateCapabilitiesLog(layer_settings->simulate.capabilities);
+    const std::string default_feature_values = GetDefaultFeatureValuesString(layer_settings->simulate.default_feature_values);
+    const std::string debug_actions_log = GetDebugActionsLog(layer_settings->log.debug_actions);
+    const std::string debug_reports_log = GetDebugReportsLog(layer_settings->log.debug_reports);
+
+    std::string settings_log;
+    settings_log += format("\t%s: %s\n", kLayerSettingsProfileEmulation, layer_settings->simulate.profile_emulation ? "true" : "false");
+    settings_log += format("\t%s: %s\n", kLayerSettingsProfileFile, layer_settings->simulate.profile_file.c_str());
+    settings_log += format("\t%s: %s\n", kLayerSettingsProfileDirs, profile_dirs.c_str());
+    settings_log += format("\t%s: %s\n", kLayerSettingsProfileName, layer_settings->simulate.profile_name.c_str());
+    settings_log +=
+        format("\t%s: %s\n", kLayerSettingsProfileValidation, layer_settings->simulate.profile_validation ? "true" : "false");
+    settings_log += format("\t%s: %s\n", kLayerSettingsProfileCacheDir, layer_settings->simulate.profile_cache_dir.c_str());
+    settings_log += format("\t%s: %s\n", kLayerSettingsProfileParallelLoading,
+                           layer_settings->simulate.profile_parallel_loading ? "true" : "false");
+    settings_log +=
+        format("\t%s: %s\n", kLayerSettingsProfileHotReload, layer_settings->simulate.profile_hot_reload ? "true" : "false");
+    settings_log += format("\t%s: %s\n", kLayerSettingsSimulateCapabilities, simulation_capabilities_log.c_str());
+    settings_log += format("\t%s: %s\n", kLayerSettingsDefaultFeatureValues, default_feature_values.c_str());
+
+    settings_log +=
+        format("\t%s: %s\n", kLayerSettingsEmulatePortability, layer_settings->simulate.emulate_portability ? "true" : "false");
+    if (layer_settings->simulate.emulate_portability) {
+        settings_log += format("\t\t%s: %s\n", kLayerSettings_constantAlphaColorBlendFactors,
+                               layer_settings->portability.constantAlphaColorBlendFactors ? "true" : "false");
+        settings_log += format("\t\t%s: %s\n", kLayerSettings_events, layer_settings->portability.events ? "true" : "false");
+        settings_log += format("\t\t%s: %s\n", kLayerSettings_imageViewFormatReinterpretation,
+                               layer_settings->portability.imageViewFormatReinterpretation ? "true" : "false");
+        settings_log += format("\t\t%s: %s\n", kLayerSettings_imageViewFormatSwizzle,
+                               layer_settings->portability.imageViewFormatSwizzle ? "true" : "false");
+        settings_log += format("\t\t%s: %s\n", kLayerSettings_imageView2DOn3DImage,
+                               layer_settings->portability.imageView2DOn3DImage ? "true" : "false");
+        settings_log += format("\t\t%s: %s\n", kLayerSettings_multisampleArrayImage,
+                               layer_settings->portability.multisampleArrayImage ? "true" : "false");
+        settings_log += format("\t\t%s: %s\n", kLayerSettings_mutableComparisonSamplers,
+                               layer_settings->portability.mutableComparisonSamplers ? "true" : "false");
+        settings_log +=
+            format("\t\t%s: %s\n", kLayerSettings_pointPolygons, layer_settings->portability.pointPolygons ? "true" : "false");
+        settings_log += format("\t\t%s: %s\n", kLayerSettings_samplerMipLodBias,
+                               layer_settings->portability.samplerMipLodBias ? "true" : "false");
+        settings_log += format("\t\t%s: %s\n", kLayerSettings_separateStencilMaskRef,
+                               layer_settings->portability.separateStencilMaskRef ? "true" : "false");
+        settings_log += format("\t\t%s: %s\n", kLayerSettings_shaderSampleRateInterpolationFunctions,
+                               layer_settings->portability.shaderSampleRateInterpolationFunctions ? "true" : "false");
+        settings_log += format("\t\t%s: %s\n", kLayerSettings_tessellationIsolines,
+                               layer_settings->portability.tessellationIsolines ? "true" : "false");
+        settings_log +=
+            format("\t\t%s: %s\n", kLayerSettings_triangleFans, layer_settings->portability.triangleFans ? "true" : "false");
+        settings_log += format("\t\t%s: %s\n", kLayerSettings_vertexAttributeAccessBeyondStride,
+                               layer_settings->portability.vertexAttributeAccessBeyondStride ? "true" : "false");
+        settings_log += format("\t\t%s: %d\n", kLayerSettings_minVertexInputBindingStrideAlignment,
+                               static_cast<int>(layer_settings->portability.minVertexInputBindingStrideAlignment));
+    }
+    settings_log += format("\t%s: %s\n", kLayerSettingsDebugActions, debug_actions_log.c_str());
+    settings_log += format("\t%s: %s\n", kLayerSettingsDebugFilename, layer_settings->log.debug_filename.c_str());
+    settings_log +=
+        format("\t%s: %s\n", kLayerSettingsDebugMismatchFilename, layer_settings->log.debug_mismatch_filename.c_str());
+    settings_log += format("\t%s: %s\n", kLayerSettingsDebugFileClear, layer_settings->log.debug_file_discard ? "true" : "false");
+    settings_log +=
+        format("\t%s: %s\n", kLayerSettingsDebugFailOnError, layer_settings->log.debug_fail_on_error ? "true" : "false");
+    settings_log += format("\t%s: %s\n", kLayerSettingsDebugAsync, layer_settings->log.debug_async ? "true" : "false");
+    settings_log += format("\t%s: %s\n", kLayerSettingsDebugReports, debug_reports_log.c_str());
+    settings_log += format("\t%s: %s\n", kLayerSettingsExcludeDeviceExtensions,
+                           GetString(layer_settings->simulate.exclude_device_extensions).c_str());
+    settings_log += format("\t%s: %s\n", kLayerSettingsExcludeFormats, GetString(layer_settings->simulate.exclude_formats).c_str());
+
+    return settings_log;
+}
+
 void InitProfilesLayerSettings(const VkInstanceCreateInfo *pCreateInfo, const VkAllocationCallbacks *pAllocator,
                                ProfileLayerSettings *layer_settings) {
     assert(layer_settings != nullptr);
@@ -219,6 +344,9 @@ void InitProfilesLayerSettings(const VkInstanceCreateInfo *pCreateInfo, const Vk
                                               kLayerSettingsProfileDirs,
                                               kLayerSettingsProfileName,
                                               kLayerSettingsProfileValidation,
+                                              kLayerSettingsProfileCacheDir,
+                                              kLayerSettingsProfileParallelLoading,
+                                              kLayerSettingsProfileHotReload,
                                               kLayerSettingsEmulatePortability,
                                               kLayerSettings_constantAlphaColorBlendFactors,
                                               kLayerSettings_events,
@@ -239,8 +367,10 @@ void InitProfilesLayerSettings(const VkInstanceCreateInfo *pCreateInfo, const Vk
                                               kLayerSettingsSimulateCapabilities,
                                               kLayerSettingsDebugActions,
                                               kLayerSettingsDebugFilename,
+                                              kLayerSettingsDebugMismatchFilename,
                                               kLayerSettingsDebugFileClear,
                                               kLayerSettingsDebugFailOnError,
+                                              kLayerSettingsDebugAsync,
                                               kLayerSettingsDebugReports,
                                               kLayerSettingsExcludeDeviceExtensions,
                                               kLayerSettingsExcludeFormats,
@@ -291,6 +421,19 @@ void InitProfilesLayerSettings(const VkInstanceCreateInfo *pCreateInfo, const Vk
             vkuGetLayerSettingValue(layerSettingSet, kLayerSettingsProfileValidation, layer_settings->simulate.profile_validation);
         }
 
+        if (vkuHasLayerSetting(layerSettingSet, kLayerSettingsProfileCacheDir)) {
+            vkuGetLayerSettingValue(layerSettingSet, kLayerSettingsProfileCacheDir, layer_settings->simulate.profile_cache_dir);
+        }
+
+        if (vkuHasLayerSetting(layerSettingSet, kLayerSettingsProfileParallelLoading)) {
+            vkuGetLayerSettingValue(layerSettingSet, kLayerSettingsProfileParallelLoading,
+                                    layer_settings->simulate.profile_parallel_loading);
+        }
+
+        if (vkuHasLayerSetting(layerSettingSet, kLayerSettingsProfileHotReload)) {
+            vkuGetLayerSettingValue(layerSettingSet, kLayerSettingsProfileHotReload, layer_settings->simulate.profile_hot_reload);
+        }
+
         if (vkuHasLayerSetting(layerSettingSet, kLayerSettingsSimulateCapabilities)) {
             std::vector<std::string> values;
             vkuGetLayerSettingValues(layerSettingSet, kLayerSettingsSimulateCapabilities, values);
@@ -415,6 +558,10 @@ void InitProfilesLayerSettings(const VkInstanceCreateInfo *pCreateInfo, const Vk
         vkuGetLayerSettingValue(layerSettingSet, kLayerSettingsDebugFailOnError, layer_settings->log.debug_fail_on_error);
     }
 
+    if (vkuHasLayerSetting(layerSettingSet, kLayerSettingsDebugAsync)) {
+        vkuGetLayerSettingValue(layerSettingSet, kLayerSettingsDebugAsync, layer_settings->log.debug_async);
+    }
+
     if (vkuHasLayerSetting(layerSettingSet, kLayerSettingsDebugActions)) {
         std::vector<std::string> values;
         vkuGetLayerSettingValues(layerSettingSet, kLayerSettingsDebugActions, values);
@@ -428,6 +575,10 @@ void InitProfilesLayerSettings(const VkInstanceCreateInfo *pCreateInfo, const Vk
         vkuGetLayerSettingValue(layerSettingSet, kLayerSettingsDebugFilename, layer_settings->log.debug_filename);
     }
 
+    if (vkuHasLayerSetting(layerSettingSet, kLayerSettingsDebugMismatchFilename)) {
+        vkuGetLayerSettingValue(layerSettingSet, kLayerSettingsDebugMismatchFilename, layer_settings->log.debug_mismatch_filename);
+    }
+
     if (vkuHasLayerSetting(layerSettingSet, kLayerSettingsDebugFileClear)) {
         vkuGetLayerSettingValue(layerSettingSet, kLayerSettingsDebugFileClear, layer_settings->log.debug_file_discard);
     }
@@ -458,66 +609,33 @@ void InitProfilesLayerSettings(const VkInstanceCreateInfo *pCreateInfo, const Vk
                    layer_settings->log.debug_filename.c_str());
     }
 
-    const std::string profile_dirs = GetString(layer_settings->simulate.profile_dirs);
-    const std::string simulation_capabilities_log = GetSimulateCapabilitiesLog(layer_settings->simulate.capabilities);
-    const std::string default_feature_values = GetDefaultFeatureValuesString(layer_settings->simulate.default_feature_values);
-    const std::string debug_actions_log = GetDebugActionsLog(layer_settings->log.debug_actions);
-    const std::string debug_reports_log = GetDebugReportsLog(layer_settings->log.debug_reports);
-
-    std::string settings_log;
-    settings_log += format("\t%s: %s\n", kLayerSettingsProfileEmulation, layer_settings->simulate.profile_emulation ? "true" : "false");
-    settings_log += format("\t%s: %s\n", kLayerSettingsProfileFile, layer_settings->simulate.profile_file.c_str());
-    settings_log += format("\t%s: %s\n", kLayerSettingsProfileDirs, profile_dirs.c_str());
-    settings_log += format("\t%s: %s\n", kLayerSettingsProfileName, layer_settings->simulate.profile_name.c_str());
-    settings_log +=
-        format("\t%s: %s\n", kLayerSettingsProfileValidation, layer_settings->simulate.profile_validation ? "true" : "false");
-    settings_log += format("\t%s: %s\n", kLayerSettingsSimulateCapabilities, simulation_capabilities_log.c_str());
-    settings_log += format("\t%s: %s\n", kLayerSettingsDefaultFeatureValues, default_feature_values.c_str());
+    if (layer_settings->log.debug_actions & DEBUG_ACTION_MISMATCH_FILE_BIT && layer_settings->log.mismatch_file == nullptr) {
+        layer_settings->log.mismatch_file =
+            fopen(layer_settings->log.debug_mismatch_filename.c_str(), layer_settings->log.debug_file_discard ? "w" : "a");
+        if (layer_settings->log.mismatch_file == nullptr) {
+            layer_settings->log.debug_actions &= ~DEBUG_ACTION_MISMATCH_FILE_BIT;
+            LogMessage(layer_settings, DEBUG_REPORT_ERROR_BIT, "Could not open %s, the mismatch records are disabled.\n",
+                       layer_settings->log.debug_mismatch_filename.c_str());
+        } else {
+            // Large fully buffered writes, the records are only needed once the profile is loaded
+            setvbuf(layer_settings->log.mismatch_file, nullptr, _IOFBF, 1 << 16);
+            LogMessage(layer_settings, DEBUG_REPORT_DEBUG_BIT, "Mismatch file %s opened\n",
+                       layer_settings->log.debug_mismatch_filename.c_str());
+        }
+    }
 
-    settings_log +=
-        format("\t%s: %s\n", kLayerSettingsEmulatePortability, layer_settings->simulate.emulate_portability ? "true" : "false");
-    if (layer_settings->simulate.emulate_portability) {
-        settings_log += format("\t\t%s: %s\n", kLayerSettings_constantAlphaColorBlendFactors,
-                               layer_settings->portability.constantAlphaColorBlendFactors ? "true" : "false");
-        settings_log += format("\t\t%s: %s\n", kLayerSettings_events, layer_settings->portability.events ? "true" : "false");
-        settings_log += format("\t\t%s: %s\n", kLayerSettings_imageViewFormatReinterpretation,
-                               layer_settings->portability.imageViewFormatReinterpretation ? "true" : "false");
-        settings_log += format("\t\t%s: %s\n", kLayerSettings_imageViewFormatSwizzle,
-                               layer_settings->portability.imageViewFormatSwizzle ? "true" : "false");
-        settings_log += format("\t\t%s: %s\n", kLayerSettings_imageView2DOn3DImage,
-                               layer_settings->portability.imageView2DOn3DImage ? "true" : "false");
-        settings_log += format("\t\t%s: %s\n", kLayerSettings_multisampleArrayImage,
-                               layer_settings->portability.multisampleArrayImage ? "true" : "false");
-        settings_log += format("\t\t%s: %s\n", kLayerSettings_mutableComparisonSamplers,
-                               layer_settings->portability.mutableComparisonSamplers ? "true" : "false");
-        settings_log +=
-            format("\t\t%s: %s\n", kLayerSettings_pointPolygons, layer_settings->portability.pointPolygons ? "true" : "false");
-        settings_log += format("\t\t%s: %s\n", kLayerSettings_samplerMipLodBias,
-                               layer_settings->portability.samplerMipLodBias ? "true" : "false");
-        settings_log += format("\t\t%s: %s\n", kLayerSettings_separateStencilMaskRef,
-                               layer_settings->portability.separateStencilMaskRef ? "true" : "false");
-        settings_log += format("\t\t%s: %s\n", kLayerSettings_shaderSampleRateInterpolationFunctions,
-                               layer_settings->portability.shaderSampleRateInterpolationFunctions ? "true" : "false");
-        settings_log += format("\t\t%s: %s\n", kLayerSettings_tessellationIsolines,
-                               layer_settings->portability.tessellationIsolines ? "true" : "false");
-        settings_log +=
-            format("\t\t%s: %s\n", kLayerSettings_triangleFans, layer_settings->portability.triangleFans ? "true" : "false");
-        settings_log += format("\t\t%s: %s\n", kLayerSettings_vertexAttributeAccessBeyondStride,
-                               layer_settings->portability.vertexAttributeAccessBeyondStride ? "true" : "false");
-        settings_log += format("\t\t%s: %d\n", kLayerSettings_minVertexInputBindingStrideAlignment,
-                               static_cast<int>(layer_settings->portability.minVertexInputBindingStrideAlignment));
+#if !defined(__ANDROID__)
+    if (layer_settings->log.debug_async && !layer_settings->log.async_writer) {
+        const bool write_stdout = layer_settings->log.debug_actions & DEBUG_ACTION_STDOUT_BIT;
+        FILE *file = layer_settings->log.debug_actions & DEBUG_ACTION_FILE_BIT ? layer_settings->log.profiles_log_file : nullptr;
+        if (write_stdout || file != nullptr) {
+            layer_settings->log.async_writer.reset(new AsyncLogWriter(write_stdout, file));
+        }
     }
-    settings_log += format("\t%s: %s\n", kLayerSettingsDebugActions, debug_actions_log.c_str());
-    settings_log += format("\t%s: %s\n", kLayerSettingsDebugFilename, layer_settings->log.debug_filename.c_str());
-    settings_log += format("\t%s: %s\n", kLayerSettingsDebugFileClear, layer_settings->log.debug_file_discard ? "true" : "false");
-    settings_log +=
-        format("\t%s: %s\n", kLayerSettingsDebugFailOnError, layer_settings->log.debug_fail_on_error ? "true" : "false");
-    settings_log += format("\t%s: %s\n", kLayerSettingsDebugReports, debug_reports_log.c_str());
-    settings_log += format("\t%s: %s\n", kLayerSettingsExcludeDeviceExtensions,
-                           GetString(layer_settings->simulate.exclude_device_extensions).c_str());
-    settings_log += format("\t%s: %s\n", kLayerSettingsExcludeFormats, GetString(layer_settings->simulate.exclude_formats).c_str());
+#endif
 
-    LogMessage(layer_settings, DEBUG_REPORT_NOTIFICATION_BIT, "Profile Layers Settings: {\n%s}\n", settings_log.c_str());
+    LOG_MESSAGE(layer_settings, DEBUG_REPORT_NOTIFICATION_BIT, "Profile Layers Settings: {\n%s}\n",
+                GetSettingsLog(layer_settings).c_str());
 
     vkuDestroyLayerSettingSet(layerSettingSet, pAllocator);
 }
@@ -20,9 +20,13 @@
 #pragma once
 
 #include <vulkan/layer/vk_layer_settings.hpp>
+#include <charconv>
+#include <cmath>
+#include <cstdio>
 #include <memory>
 #include <vector>
 #include <string>
+#include <type_traits>
 
 enum SimulateCapabilityBits {
     SIMULATE_API_VERSION_BIT = 1 << 0,
@@ -40,6 +44,7 @@ enum DebugActionBits {
     DEBUG_ACTION_STDOUT_BIT = (1 << 1),
     DEBUG_ACTION_OUTPUT_BIT = (1 << 2),
     DEBUG_ACTION_BREAKPOINT_BIT = (1 << 3),
+    DEBUG_ACTION_MISMATCH_FILE_BIT = (1 << 4),
     DEBUG_ACTION_MAX_ENUM = 0x7FFFFFFF
 };
 typedef int DebugActionFlags;
@@ -56,6 +61,8 @@ static DebugActionFlags GetDebugActionFlags(const std::vector<std::string> &valu
             result |= DEBUG_ACTION_OUTPUT_BIT;
         } else if (values[i] == "DEBUG_ACTION_BREAKPOINT_BIT") {
             result |= DEBUG_ACTION_BREAKPOINT_BIT;
+        } else if (values[i] == "DEBUG_ACTION_MISMATCH_FILE_BIT") {
+            result |= DEBUG_ACTION_MISMATCH_FILE_BIT;
         } else if (values[i] == "DEBUG_ACTION_MAX_ENUM") {
             result = DEBUG_ACTION_MAX_ENUM;
         }
@@ -69,7 +76,8 @@ static std::vector<std::string> GetDebugActionStrings(DebugActionFlags flags) {
         "DEBUG_ACTION_FILE_BIT",
         "DEBUG_ACTION_STDOUT_BIT",
         "DEBUG_ACTION_OUTPUT_BIT",
-        "DEBUG_ACTION_BREAKPOINT_BIT"
+        "DEBUG_ACTION_BREAKPOINT_BIT",
+        "DEBUG_ACTION_MISMATCH_FILE_BIT"
     };
 
     std::vector<std::string> result;
@@ -146,13 +154,11 @@ enum ForceDevice {
     FORCE_DEVICE_WITH_NAME
 };
 
+class AsyncLogWriter;
+
 struct ProfileLayerSettings {
-    ~ProfileLayerSettings() {
-        if (log.profiles_log_file != nullptr) {
-            fclose(log.profiles_log_file);
-            log.profiles_log_file = nullptr;
-        }
-    }
+    ProfileLayerSettings();
+    ~ProfileLayerSettings();
 
     struct Simulate {
         bool profile_emulation{true};
@@ -160,6 +166,9 @@ struct ProfileLayerSettings {
         std::vector<std::string> profile_dirs;
         std::string profile_name{"${VP_DEFAULT}"};
         bool profile_validation{false};
+        std::string profile_cache_dir{};
+        bool profile_parallel_loading{false};
+        bool profile_hot_reload{false};
         SimulateCapabilityFlags capabilities{SIMULATE_API_VERSION_BIT | SIMULATE_FEATURES_BIT | SIMULATE_PROPERTIES_BIT};
         DefaultFeatureValues default_feature_values{DEFAULT_FEATURE_VALUES_DEVICE};
         std::vector<std::string> exclude_device_extensions;
@@ -189,10 +198,14 @@ struct ProfileLayerSettings {
     struct Log {
         DebugActionFlags debug_actions{DEBUG_ACTION_STDOUT_BIT};
         std::string debug_filename{"profiles_layer_log.txt"};
+        std::string debug_mismatch_filename{"profiles_layer_mismatches.jsonl"};
         bool debug_file_discard{true};
         DebugReportFlags debug_reports{DEBUG_REPORT_WARNING_BIT | DEBUG_REPORT_ERROR_BIT};
         bool debug_fail_on_error{false};
+        bool debug_async{false};
         FILE *profiles_log_file{nullptr};
+        FILE *mismatch_file{nullptr};  // JSON lines, only when DEBUG_ACTION_MISMATCH_FILE_BIT is enabled
+        std::unique_ptr<AsyncLogWriter> async_writer;  // Only when debug_async is enabled
     } log;
 
     struct Device {
@@ -215,5 +228,98 @@ void WarnMissingFormatFeatures2(ProfileLayerSettings *layer_settings, const char
 
 void LogMessage(ProfileLayerSettings *layer_settings, DebugReportBits report, const char *message, ...);
 
+inline bool IsLogEnabled(const ProfileLayerSettings *layer_settings, DebugReportBits report) {
+    return layer_settings != nullptr && (layer_settings->log.debug_reports & report);
+}
+
+// Check the report type before evaluating the message arguments, which are often built strings
+#define LOG_MESSAGE(layer_settings, report, ...)                 \
+    do {                                                         \
+        if (IsLogEnabled(layer_settings, report)) {              \
+            LogMessage(layer_settings, report, __VA_ARGS__);     \
+        }                                                        \
+    } while (false)
+
+template <typename T>
+std::string GetJsonValue(T value) {
+    if constexpr (std::is_same<T, bool>::value) {
+        return value ? "true" : "false";
+    } else if constexpr (std::is_floating_point<T>::value) {
+        // JSON has no NaN or infinity, and std::to_chars doesn't depend on the locale decimal separator
+        if (!std::isfinite(value)) {
+            return "null";
+        }
+        char buffer[32];
+        const std::to_chars_result result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+        return std::string(buffer, result.ptr);
+    } else {
+        return std::to_string(value);
+    }
+}
+
+inline void AppendJsonString(std::string *json, const char *value) {
+    *json += '"';
+    for (const char *c = value; *c != '\0'; ++c) {
+        switch (*c) {
+            case '"':
+                *json += "\\\"";
+                break;
+            case '\\':
+                *json += "\\\\";
+                break;
+            default:
+                if (static_cast<unsigned char>(*c) < 0x20) {
+                    char escape[8];
+                    snprintf(escape, sizeof(escape), "\\u%04x", static_cast<unsigned char>(*c));
+                    *json += escape;
+                } else {
+                    *json += *c;
+                }
+                break;
+        }
+    }
+    *json += '"';
+}
+
+// JSON lines record of a profile value that the device doesn't support:
+// {"device": ..., "struct": ..., "member": ..., "comparison": ..., "modifiable": ..., "profile_value": ..., "device_value": ...}
+// comparison is one of "not_equal", "greater", "lesser" or "missing_bits". For the format features, "struct" is the format.
+// The values are JSON values, as returned by GetJsonValue().
+inline std::string FormatMismatchRecord(const char *device_name, const char *struct_name, const char *member_name,
+                                        const char *comparison, bool modifiable, const std::string &profile_value,
+                                        const std::string &device_value) {
+    std::string record = "{\"device\":";
+    AppendJsonString(&record, device_name);
+    record += ",\"struct\":";
+    AppendJsonString(&record, struct_name);
+    record += ",\"member\":";
+    AppendJsonString(&record, member_name);
+    record += ",\"comparison\":";
+    AppendJsonString(&record, comparison);
+    record += ",\"modifiable\":";
+    record += modifiable ? "true" : "false";
+    record += ",\"profile_value\":";
+    record += profile_value;
+    record += ",\"device_value\":";
+    record += device_value;
+    record += "}\n";
+    return record;
+}
+
+// Write a mismatch record in the mismatch file, see FormatMismatchRecord()
+void LogMismatch(ProfileLayerSettings *layer_settings, const char *device_name, const char *struct_name, const char *member_name,
+                 const char *comparison, bool modifiable, const std::string &profile_value, const std::string &device_value);
+
+#define LOG_MISMATCH(layer_settings, device_name, struct_name, member_name, comparison, modifiable, profile_value, device_value) \
+    do {                                                                                                                      \
+        if ((layer_settings)->log.mismatch_file != nullptr) {                                                                \
+            LogMismatch(layer_settings, device_name, struct_name, member_name, comparison, modifiable,                        \
+                        GetJsonValue(profile_value), GetJsonValue(device_value));                                             \
+        }                                                                                                                     \
+    } while (false)
+
 void LogFlush(ProfileLayerSettings *layer_settings);
 
+// Write the pending messages and close the log files, the later messages are only written to the standard output
+void LogClose(ProfileLayerSettings *layer_settings);
+
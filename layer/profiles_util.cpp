@@ -20,6 +20,25 @@
 #include "profiles_util.h"
 #include "profiles_settings.h"
 
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__)
+#include <cerrno>
+#include <poll.h>
+#include <sys/inotify.h>
+#endif
+
 //void LayerSettingsLog(const char* pSettingName, const char* pMessage) {
 //    LogMessage(DEBUG_REPORT_ERROR_BIT, "%s : %s\n", pSettingName, pMessage);
 //}
@@ -99,27 +118,6 @@ std::string format_device_support_string(VkFormatFeatureFlags2 format_features)
     return ::format("only supports:\n\t\" % s\"", GetFormatFeature2String(format_features).c_str());
 }
 
-VkResult EnumerateExtensions(const MapOfVkExtensionProperties &source, uint32_t *dst_count, VkExtensionProperties *dst_props) {
-    assert(dst_count);
-    if (!dst_props) {
-        *dst_count = static_cast<uint32_t>(source.size());
-        return VK_SUCCESS;
-    }
-    uint32_t count_written = 0;
-    uint32_t src_count = static_cast<uint32_t>(source.size());
-    const uint32_t copy_count = (*dst_count < src_count) ? *dst_count : src_count;
-    *dst_count = copy_count;
-    for (const auto &[ext_name, ext] : source) {
-        dst_props[count_written] = ext;
-        count_written++;
-
-        if (count_written == *dst_count) {
-            break;
-        }
-    }
-    return (copy_count == src_count) ? VK_SUCCESS : VK_INCOMPLETE;
-}
-
 bool QueueFamilyMatch(const VkQueueFamilyProperties &device, const VkQueueFamilyProperties &profile) {
     if ((device.queueFlags & profile.queueFlags) != profile.queueFlags) {
         return false;
@@ -157,3 +155,376 @@ bool GlobalPriorityMatch(const VkQueueFamilyGlobalPriorityPropertiesKHR &device,
     }
     return match;
 }
+
+static const uint32_t kExtensionEnumBase = 1000000000;
+static const uint32_t kExtensionEnumBlockSize = 1000;
+
+static std::size_t HashImageFormatKey(const ImageFormatCache::Key &key) {
+    uint64_t hash = 14695981039346656037ull;
+    const uint32_t values[] = {static_cast<uint32_t>(key.format), static_cast<uint32_t>(key.type), static_cast<uint32_t>(key.tiling),
+                               key.usage, key.flags};
+    for (const uint32_t value : values) {
+        hash = (hash ^ value) * 1099511628211ull;
+    }
+    return static_cast<std::size_t>(hash ^ (hash >> 32));
+}
+
+static bool operator==(const ImageFormatCache::Key &a, const ImageFormatCache::Key &b) {
+    return a.format == b.format && a.type == b.type && a.tiling == b.tiling && a.usage == b.usage && a.flags == b.flags;
+}
+
+ImageFormatCache::~ImageFormatCache() { delete[] entries_.load(std::memory_order_relaxed); }
+
+bool ImageFormatCache::Find(const Key &key, VkResult *result, VkImageFormatProperties *properties) const {
+    const Entry *entries = entries_.load(std::memory_order_acquire);
+    if (entries != nullptr) {
+        // The table is never full so the probing always reaches an empty entry
+        for (std::size_t i = HashImageFormatKey(key) & (kCapacity - 1);; i = (i + 1) & (kCapacity - 1)) {
+            const Entry &entry = entries[i];
+            if (!entry.ready.load(std::memory_order_acquire)) {
+                break;
+            }
+            if (entry.key == key) {
+                *result = entry.result;
+                *properties = entry.properties;
+#if !defined(NDEBUG)
+                hits_.fetch_add(1, std::memory_order_relaxed);
+#endif
+                return true;
+            }
+        }
+    }
+
+#if !defined(NDEBUG)
+    misses_.fetch_add(1, std::memory_order_relaxed);
+#endif
+    return false;
+}
+
+void ImageFormatCache::Insert(const Key &key, VkResult result, const VkImageFormatProperties &properties) {
+    std::lock_guard<std::mutex> lock(insert_lock_);
+
+    if (size_ >= kMaxSize) {
+        return;
+    }
+
+    Entry *entries = entries_.load(std::memory_order_relaxed);
+    if (entries == nullptr) {
+        entries = new Entry[kCapacity];
+        entries_.store(entries, std::memory_order_release);
+    }
+
+    for (std::size_t i = HashImageFormatKey(key) & (kCapacity - 1);; i = (i + 1) & (kCapacity - 1)) {
+        Entry &entry = entries[i];
+        if (!entry.ready.load(std::memory_order_relaxed)) {
+            entry.key = key;
+            entry.result = result;
+            entry.properties = properties;
+            entry.ready.store(true, std::memory_order_release);
+            ++size_;
+            return;
+        }
+        if (entry.key == key) {
+            // Inserted by a concurrent query of the same key
+            return;
+        }
+    }
+}
+
+void EnumIndex::Init(const std::vector<uint32_t> &values) {
+    for (const uint32_t value : values) {
+        if (value < kExtensionEnumBase) {
+            core_count_ = std::max<std::size_t>(core_count_, value + 1);
+            continue;
+        }
+
+        const uint32_t number = (value - kExtensionEnumBase) / kExtensionEnumBlockSize;
+        const uint32_t offset = value % kExtensionEnumBlockSize;
+        if (number >= blocks_.size()) {
+            blocks_.resize(number + 1, Block{0, 0, 0});
+        }
+
+        Block &block = blocks_[number];
+        if (block.count == 0) {
+            block = Block{offset, 1, 0};
+        } else {
+            const uint32_t last_offset = std::max(block.first_offset + block.count - 1, offset);
+            block.first_offset = std::min(block.first_offset, offset);
+            block.count = last_offset - block.first_offset + 1;
+        }
+    }
+
+    size_ = core_count_;
+    for (Block &block : blocks_) {
+        block.base = size_;
+        size_ += block.count;
+    }
+}
+
+std::size_t EnumIndex::Find(uint32_t value) const {
+    if (value < core_count_) {
+        return value;
+    } else if (value < kExtensionEnumBase) {
+        return size_;
+    }
+
+    const uint32_t number = (value - kExtensionEnumBase) / kExtensionEnumBlockSize;
+    if (number >= blocks_.size()) {
+        return size_;
+    }
+
+    // offset below first_offset wraps around and fails the range check
+    const Block &block = blocks_[number];
+    const uint32_t offset = value % kExtensionEnumBlockSize;
+    return (offset - block.first_offset < block.count) ? block.base + (offset - block.first_offset) : size_;
+}
+
+MappedFile::MappedFile(const std::string &filename) {
+    static const char empty_file[] = "";
+
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return;
+    }
+
+    LARGE_INTEGER file_size = {};
+    if (!GetFileSizeEx(file, &file_size)) {
+        CloseHandle(file);
+        return;
+    }
+
+    if (file_size.QuadPart == 0) {
+        data_ = empty_file;
+    } else {
+        HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping != nullptr) {
+            mapping_ = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            CloseHandle(mapping);
+        }
+        if (mapping_ != nullptr) {
+            data_ = static_cast<const char *>(mapping_);
+            size_ = static_cast<std::size_t>(file_size.QuadPart);
+        }
+    }
+    CloseHandle(file);
+#else
+    const int file = open(filename.c_str(), O_RDONLY);
+    if (file < 0) {
+        return;
+    }
+
+    struct stat file_stat = {};
+    if (fstat(file, &file_stat) == 0 && S_ISREG(file_stat.st_mode)) {
+        if (file_stat.st_size == 0) {
+            data_ = empty_file;
+        } else {
+            void *mapping = mmap(nullptr, static_cast<std::size_t>(file_stat.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+            if (mapping != MAP_FAILED) {
+                mapping_ = mapping;
+                data_ = static_cast<const char *>(mapping_);
+                size_ = static_cast<std::size_t>(file_stat.st_size);
+            }
+        }
+    }
+    close(file);
+#endif
+}
+
+MappedFile::~MappedFile() {
+    if (mapping_ == nullptr) {
+        return;
+    }
+
+#if defined(_WIN32)
+    UnmapViewOfFile(mapping_);
+#else
+    munmap(mapping_, size_);
+#endif
+}
+
+FileBuffer::FileBuffer(const std::string &filename) {
+    FILE *file = fopen(filename.c_str(), "rb");
+    if (file == nullptr) {
+        return;
+    }
+
+    // The size at open time is only a hint, the file is read until its end in case it is modified concurrently
+    std::size_t capacity = 4096;
+    if (fseek(file, 0, SEEK_END) == 0) {
+        const long end = ftell(file);
+        if (end > 0) {
+            capacity = static_cast<std::size_t>(end) + 1;
+        }
+    }
+    rewind(file);
+
+    data_.resize(capacity);
+    std::size_t size = 0;
+    for (;;) {
+        if (size == data_.size()) {
+            data_.resize(data_.size() * 2);
+        }
+        size += fread(data_.data() + size, 1, data_.size() - size, file);
+        if (ferror(file)) {
+            data_.clear();
+            fclose(file);
+            return;
+        }
+        if (feof(file)) {
+            break;
+        }
+    }
+    fclose(file);
+
+    data_.resize(size);
+    open_ = true;
+}
+
+FileWatcher::FileWatcher(const std::vector<std::string> &paths, std::function<void()> on_change)
+    : on_change_(std::move(on_change)) {
+#if defined(__linux__)
+    inotify_fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_fd_ < 0) {
+        return;
+    }
+
+    const uint32_t mask = IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO;
+    for (const std::string &path : paths) {
+        if (path.empty()) {
+            continue;
+        }
+
+        std::string directory = path;
+        std::string filename;
+
+        // Files are watched through their directory so that editors replacing the file are detected
+        struct stat path_stat = {};
+        if (stat(path.c_str(), &path_stat) != 0 || !S_ISDIR(path_stat.st_mode)) {
+            const std::size_t separator = path.find_last_of('/');
+            if (separator == std::string::npos) {
+                directory = ".";
+            } else {
+                directory = separator == 0 ? "/" : path.substr(0, separator);
+            }
+            filename = path.substr(separator + 1);
+        }
+
+        const int watch = inotify_add_watch(inotify_fd_, directory.c_str(), mask);
+        if (watch >= 0) {
+            watches_.emplace_back(watch, filename);
+        }
+    }
+
+    if (watches_.empty() || pipe(stop_fds_) != 0) {
+        return;
+    }
+
+    thread_ = std::thread(&FileWatcher::Run, this);
+#else
+    (void)paths;
+#endif
+}
+
+FileWatcher::~FileWatcher() {
+#if defined(__linux__)
+    if (thread_.joinable()) {
+        const char stop = 0;
+        const ssize_t written = write(stop_fds_[1], &stop, sizeof(stop));
+        (void)written;
+        thread_.join();
+    }
+
+    for (int fd : {stop_fds_[0], stop_fds_[1], inotify_fd_}) {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+#endif
+}
+
+void FileWatcher::Run() {
+#if defined(__linux__)
+    // Writing a file produces a burst of events, wait for them to settle before notifying the change
+    static const int kSettleTimeMs = 100;
+
+    alignas(struct inotify_event) char buffer[4096];
+    bool changed = false;
+
+    for (;;) {
+        struct pollfd fds[2] = {{stop_fds_[0], POLLIN, 0}, {inotify_fd_, POLLIN, 0}};
+        const int ready = poll(fds, 2, changed ? kSettleTimeMs : -1);
+        if (ready < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+
+        if (fds[0].revents != 0) {
+            break;
+        }
+
+        if (ready == 0) {
+            changed = false;
+            on_change_();
+            continue;
+        }
+
+        if ((fds[1].revents & POLLIN) == 0) {
+            break;
+        }
+
+        for (;;) {
+            const ssize_t length = read(inotify_fd_, buffer, sizeof(buffer));
+            if (length <= 0) {
+                break;
+            }
+
+            for (ssize_t offset = 0; offset < length;) {
+                const struct inotify_event *event = reinterpret_cast<const struct inotify_event *>(buffer + offset);
+                offset += static_cast<ssize_t>(sizeof(struct inotify_event) + event->len);
+                if (event->len == 0) {
+                    continue;
+                }
+
+                const std::string name = event->name;
+                for (const auto &watch : watches_) {
+                    if (watch.first != event->wd) {
+                        continue;
+                    }
+                    if (watch.second.empty() ? EndsWith(name, ".json") : watch.second == name) {
+                        changed = true;
+                    }
+                }
+            }
+        }
+    }
+#endif
+}
+
+void ParallelFor(std::size_t count, const std::function<void(std::size_t)> &func) {
+    static const std::size_t kMaxThreads = 16;
+
+    const std::size_t hardware_threads = std::max<std::size_t>(std::thread::hardware_concurrency(), 1);
+    const std::size_t thread_count = std::min(std::min(hardware_threads, kMaxThreads), count);
+
+    std::atomic<std::size_t> next{0};
+    const auto worker = [&]() {
+        for (std::size_t i = next++; i < count; i = next++) {
+            func(i);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(thread_count > 0 ? thread_count - 1 : 0);
+    for (std::size_t i = 1; i < thread_count; ++i) {
+        threads.emplace_back(worker);
+    }
+
+    worker();
+
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+}
@@ -31,9 +31,14 @@
 #include <unordered_map>
 #include <vector>
 #include <array>
+#include <atomic>
 #include <fstream>
+#include <memory>
 #include <mutex>
 #include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
 
 #include "vulkan/vk_layer.h"
 #include "vulkan/vulkan_beta.h"
@@ -65,7 +70,6 @@ typedef std::unordered_map<uint32_t /*VkFormat*/, VkFormatProperties> MapOfVkFor
 typedef std::unordered_map<uint32_t /*VkFormat*/, VkFormatProperties3> MapOfVkFormatProperties3;
 typedef std::unordered_map<uint32_t /*VkFormat*/, VkDrmFormatModifierPropertiesList2EXT> MapOfVkDrmFormatModifierProperties;
 typedef std::vector<VkExtensionProperties> ArrayOfVkExtensionProperties;
-typedef std::unordered_map<std::string, VkExtensionProperties> MapOfVkExtensionProperties;
 
 struct QueueFamilyProperties {
     VkQueueFamilyProperties2 properties_2 = {};
@@ -87,6 +91,84 @@ struct QueueFamilyProperties {
 
 typedef std::vector<QueueFamilyProperties> ArrayOfVkQueueFamilyProperties;
 
+// Memoization of the vkGetPhysicalDeviceImageFormatProperties results of a physical device. The lookups are lock free, the
+// insertions are serialized and stop once the table is full.
+class ImageFormatCache {
+   public:
+    struct Key {
+        VkFormat format;
+        VkImageType type;
+        VkImageTiling tiling;
+        VkImageUsageFlags usage;
+        VkImageCreateFlags flags;
+    };
+
+    ImageFormatCache() = default;
+    ~ImageFormatCache();
+
+    ImageFormatCache(const ImageFormatCache &) = delete;
+    ImageFormatCache &operator=(const ImageFormatCache &) = delete;
+
+    bool Find(const Key &key, VkResult *result, VkImageFormatProperties *properties) const;
+    void Insert(const Key &key, VkResult result, const VkImageFormatProperties &properties);
+
+#if !defined(NDEBUG)
+    // Only counted in debug builds: the counters are shared by all the threads querying the physical device
+    uint64_t hits() const { return hits_.load(std::memory_order_relaxed); }
+    uint64_t misses() const { return misses_.load(std::memory_order_relaxed); }
+#endif
+
+   private:
+    static const std::size_t kCapacity = 1024;  // Power of two
+    static const std::size_t kMaxSize = kCapacity * 3 / 4;
+
+    struct Entry {
+        std::atomic<bool> ready{false};  // Set once the key and the values are written, entries are never removed
+        Key key;
+        VkResult result;
+        VkImageFormatProperties properties;
+    };
+
+    std::atomic<Entry *> entries_{nullptr};  // Allocated on the first insertion
+    std::mutex insert_lock_;
+    std::size_t size_ = 0;
+#if !defined(NDEBUG)
+    mutable std::atomic<uint64_t> hits_{0};
+    mutable std::atomic<uint64_t> misses_{0};
+#endif
+};
+
+// Dense indexing of a set of Vulkan enum values, such as VkFormat or VkStructureType. The core values are indexed by their value,
+// followed by the values of each extension enum block, where a value is 1000000000 + (extension number - 1) * 1000 + offset.
+class EnumIndex {
+   public:
+    template <typename T>
+    explicit EnumIndex(const std::vector<T> &values) {
+        std::vector<uint32_t> raw_values(values.size());
+        for (std::size_t i = 0, n = values.size(); i < n; ++i) {
+            raw_values[i] = static_cast<uint32_t>(values[i]);
+        }
+        Init(raw_values);
+    }
+
+    // Index of the value, or size() if the value isn't part of the set
+    std::size_t Find(uint32_t value) const;
+    std::size_t size() const { return size_; }
+
+   private:
+    void Init(const std::vector<uint32_t> &values);
+
+    struct Block {
+        uint32_t first_offset;
+        uint32_t count;
+        std::size_t base;
+    };
+
+    std::size_t core_count_ = 0;
+    std::vector<Block> blocks_;  // Indexed by the extension number, an extension without value has an empty block
+    std::size_t size_ = 0;
+};
+
 // Get all elements from a vkEnumerate*() lambda into a std::vector.
 template <typename T>
 VkResult EnumerateAll(std::vector<T> &vect, std::function<VkResult(uint32_t *, T *)> func) {
@@ -115,8 +197,6 @@ static VkResult EnumerateProperties(uint32_t src_count, const T *src_props, uint
     return (copy_count == src_count) ? VK_SUCCESS : VK_INCOMPLETE;
 }
 
-VkResult EnumerateExtensions(const MapOfVkExtensionProperties &source, uint32_t *dst_count, VkExtensionProperties *dst_props);
-
 bool QueueFamilyMatch(const VkQueueFamilyProperties &device, const VkQueueFamilyProperties &profile);
 
 bool GlobalPriorityMatch(const VkQueueFamilyGlobalPriorityPropertiesKHR &device,
@@ -130,6 +210,217 @@ inline bool HasFlags(VkFlags64 deviceFlags, VkFlags64 profileFlags) {
     return (deviceFlags & profileFlags) == profileFlags;
 }
 
+// Registry of objects keyed by a Vulkan handle, safe to use from multiple threads. Lookups load the pointer of an immutable
+// snapshot of the registry and never lock. Insertions and removals are serialized, copy the snapshot and publish the copy.
+// Each lookup is counted while its reference is held, on a counter shared by a subset of the threads. The replaced snapshots
+// and their objects are retired, then released by the first modification or reference release that sees no lookup in flight.
+template <typename Handle, typename T>
+class HandleRegistry {
+   public:
+    // Reference to an object of the registry, the object remains valid while the reference is held, even if its handle is
+    // removed or its object replaced.
+    class Ref {
+       public:
+        Ref() = default;
+        Ref(Ref &&other) noexcept : registry_(other.registry_), shard_(other.shard_), object_(other.object_) {
+            other.registry_ = nullptr;
+            other.object_ = nullptr;
+        }
+        ~Ref() {
+            if (registry_ != nullptr) {
+                registry_->Release(shard_);
+            }
+        }
+
+        Ref(const Ref &) = delete;
+        Ref &operator=(const Ref &) = delete;
+        Ref &operator=(Ref &&) = delete;
+
+        T *get() const { return object_; }
+        T *operator->() const { return object_; }
+        T &operator*() const { return *object_; }
+        explicit operator bool() const { return object_ != nullptr; }
+        bool operator==(std::nullptr_t) const { return object_ == nullptr; }
+        bool operator!=(std::nullptr_t) const { return object_ != nullptr; }
+
+       private:
+        friend class HandleRegistry;
+
+        Ref(const HandleRegistry *registry, std::size_t shard, T *object) : registry_(registry), shard_(shard), object_(object) {}
+
+        const HandleRegistry *registry_ = nullptr;
+        std::size_t shard_ = 0;
+        T *object_ = nullptr;
+    };
+
+    HandleRegistry() = default;
+
+    HandleRegistry(const HandleRegistry &) = delete;
+    HandleRegistry &operator=(const HandleRegistry &) = delete;
+
+    // Find an object, or an empty reference if doesn't exist
+    Ref Find(Handle handle) const {
+        const std::size_t shard = ReaderShard();
+        readers_[shard].count.fetch_add(1, std::memory_order_seq_cst);
+        const Map *map = snapshot_.load(std::memory_order_seq_cst);
+        if (map != nullptr) {
+            const auto iter = map->find(handle);
+            if (iter != map->end()) {
+                return Ref(this, shard, iter->second.get());
+            }
+        }
+        Release(shard);
+        return Ref();
+    }
+
+    // Insert an object, replacing the previous object of the handle if any
+    void Insert(Handle handle, std::shared_ptr<T> object) {
+        Snapshots released;  // Destroyed after unlocking, the objects destructors may use the registry
+        std::lock_guard<std::mutex> lock(write_lock_);
+        std::unique_ptr<Map> map = Copy();
+        (*map)[handle] = std::move(object);
+        Publish(std::move(map));
+        CollectRetired(&released);
+    }
+
+    // Remove an object, the object is released once no reference to it is held
+    void Erase(Handle handle) {
+        Snapshots released;
+        std::lock_guard<std::mutex> lock(write_lock_);
+        std::unique_ptr<Map> map = Copy();
+        map->erase(handle);
+        Publish(map->empty() ? nullptr : std::move(map));
+        CollectRetired(&released);
+    }
+
+    // Number of replaced snapshots not released yet
+    std::size_t retired_count() const {
+        std::lock_guard<std::mutex> lock(write_lock_);
+        return retired_.size();
+    }
+
+   private:
+    typedef std::unordered_map<Handle, std::shared_ptr<T>> Map;
+    typedef std::vector<std::unique_ptr<const Map>> Snapshots;
+
+    static const std::size_t kReaderShardCount = 16;
+
+    // Lookups in flight of the threads of a shard, on its own cache line so that threads of other shards don't contend on it
+    struct alignas(64) ReaderCount {
+        std::atomic<uint32_t> count{0};
+    };
+
+    static std::size_t ReaderShard() {
+        static std::atomic<std::size_t> next_shard{0};
+        static thread_local const std::size_t shard = next_shard.fetch_add(1, std::memory_order_relaxed) % kReaderShardCount;
+        return shard;
+    }
+
+    std::unique_ptr<Map> Copy() const {
+        return current_ != nullptr ? std::make_unique<Map>(*current_) : std::make_unique<Map>();
+    }
+
+    // Called with write_lock_ held
+    void Publish(std::unique_ptr<const Map> map) {
+        snapshot_.store(map.get(), std::memory_order_seq_cst);
+        std::swap(current_, map);
+        if (map != nullptr) {
+            retired_.push_back(std::move(map));
+            retired_pending_.store(true, std::memory_order_release);
+        }
+    }
+
+    // Called with write_lock_ held. A lookup that starts after the counters are read finds the published snapshot, so the
+    // retired snapshots are unreachable once all the counters are read as zero.
+    void CollectRetired(Snapshots *released) const {
+        if (retired_.empty()) {
+            return;
+        }
+        for (const ReaderCount &reader : readers_) {
+            if (reader.count.load(std::memory_order_seq_cst) != 0) {
+                return;
+            }
+        }
+        released->swap(retired_);
+        retired_pending_.store(false, std::memory_order_release);
+    }
+
+    void Release(std::size_t shard) const {
+        readers_[shard].count.fetch_sub(1, std::memory_order_seq_cst);
+        if (retired_pending_.load(std::memory_order_acquire)) {
+            Snapshots released;
+            std::lock_guard<std::mutex> lock(write_lock_);
+            CollectRetired(&released);
+        }
+    }
+
+    mutable std::mutex write_lock_;
+    std::atomic<const Map *> snapshot_{nullptr};
+    std::unique_ptr<const Map> current_;  // Owner of the published snapshot, guarded by write_lock_
+    mutable Snapshots retired_;           // Guarded by write_lock_
+    mutable std::atomic<bool> retired_pending_{false};
+    mutable ReaderCount readers_[kReaderShardCount];
+};
+
+// Read-only view of a whole file, memory mapped. Only for files that are replaced by a rename rather than modified in
+// place: reading the mapping of a truncated file raises SIGBUS on POSIX, and on Windows the mapping blocks writes to the file.
+class MappedFile {
+   public:
+    explicit MappedFile(const std::string &filename);
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    bool is_open() const { return data_ != nullptr; }
+    const char *data() const { return data_; }
+    std::size_t size() const { return size_; }
+
+   private:
+    const char *data_ = nullptr;
+    std::size_t size_ = 0;
+    void *mapping_ = nullptr;
+};
+
+// Copy of a whole file, for the files that may be modified or truncated while they are read, such as the profile files
+class FileBuffer {
+   public:
+    explicit FileBuffer(const std::string &filename);
+
+    bool is_open() const { return open_; }
+    const char *data() const { return data_.empty() ? "" : data_.data(); }
+    std::size_t size() const { return data_.size(); }
+
+   private:
+    std::vector<char> data_;
+    bool open_ = false;
+};
+
+// Watch files and directories for modifications, on_change is called from a background thread once the modifications settle.
+// Directories are watched for their .json files. Only implemented with inotify on Linux, is_active() is false otherwise.
+class FileWatcher {
+   public:
+    FileWatcher(const std::vector<std::string> &paths, std::function<void()> on_change);
+    ~FileWatcher();
+
+    FileWatcher(const FileWatcher &) = delete;
+    FileWatcher &operator=(const FileWatcher &) = delete;
+
+    bool is_active() const { return thread_.joinable(); }
+
+   private:
+    void Run();
+
+    std::function<void()> on_change_;
+    std::vector<std::pair<int, std::string>> watches_;  // Watch descriptor and watched file name, empty for a directory
+    int inotify_fd_ = -1;
+    int stop_fds_[2] = {-1, -1};
+    std::thread thread_;
+};
+
+// Call func(i) for each i in [0, count), spread over a bounded number of threads including the calling thread
+void ParallelFor(std::size_t count, const std::function<void(std::size_t)> &func);
+
 std::string ToLower(const std::string &s);
 
 std::string ToUpper(const std::string &s);
@@ -400,6 +400,48 @@ TEST_F(LayerTests, TestProfileLayerSettingsEXT_EnumerateExtensions) {
     ASSERT_EQ(count, 1);
 }
 
+TEST_F(LayerTests, TestEnumerateExtensionsSorted) {
+    VkBool32 emulate_portability_data = VK_TRUE;
+
+    std::vector<VkLayerSettingEXT> settings = {
+        {kLayerName, kLayerSettingsEmulatePortability, VK_LAYER_SETTING_TYPE_BOOL32_EXT, 1, &emulate_portability_data}};
+
+    profiles_test::VulkanInstanceBuilder inst_builder;
+    VkResult err = inst_builder.init(VK_API_VERSION_1_0, settings);
+    ASSERT_EQ(err, VK_SUCCESS);
+
+    VkPhysicalDevice gpu;
+    err = inst_builder.getPhysicalDevice(profiles_test::MODE_PROFILE, &gpu);
+    ASSERT_EQ(err, VK_SUCCESS);
+
+    uint32_t count = 0;
+    vkEnumerateDeviceExtensionProperties(gpu, nullptr, &count, nullptr);
+    ASSERT_GT(count, 0);
+
+    std::vector<VkExtensionProperties> extensions(count);
+    err = vkEnumerateDeviceExtensionProperties(gpu, nullptr, &count, extensions.data());
+    ASSERT_EQ(err, VK_SUCCESS);
+
+    bool has_portability_subset = false;
+    for (std::size_t i = 0, n = extensions.size(); i < n; ++i) {
+        if (i > 0) {
+            EXPECT_LT(strcmp(extensions[i - 1].extensionName, extensions[i].extensionName), 0);
+        }
+        has_portability_subset |= strcmp(extensions[i].extensionName, VK_KHR_PORTABILITY_SUBSET_EXTENSION_NAME) == 0;
+    }
+    EXPECT_TRUE(has_portability_subset);
+
+    // The returned list is stable and truncated in order
+    uint32_t partial_count = count - 1;
+    std::vector<VkExtensionProperties> partial(partial_count);
+    err = vkEnumerateDeviceExtensionProperties(gpu, nullptr, &partial_count, partial.data());
+    ASSERT_EQ(err, VK_INCOMPLETE);
+    ASSERT_EQ(partial_count, count - 1);
+    for (std::size_t i = 0, n = partial.size(); i < n; ++i) {
+        EXPECT_STREQ(partial[i].extensionName, extensions[i].extensionName);
+    }
+}
+
 TEST_F(LayerTests, TestNotSettingProfileFile) {
     VkResult err = VK_SUCCESS;
 
@@ -0,0 +1,608 @@
+/*
+ * Copyright (C) 2024 Valve Corporation
+ * Copyright (C) 2024 LunarG, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <vulkan/vulkan_core.h>
+
+#include <gtest/gtest.h>
+#include "profiles_test_helper.h"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Timings of the layer code paths, reported in the test output and as test properties. Only the results are checked, the
+// timings depend on the machine and are compared by reading the reports of two builds.
+class TestsBenchmark : public VkTestFramework {
+   public:
+    TestsBenchmark() {}
+    ~TestsBenchmark() {}
+
+    static void SetUpTestSuite() {}
+    static void TearDownTestSuite() {}
+};
+
+static const int kRunCount = 5;
+
+static void ReportTime(const char* name, double milliseconds) {
+    printf("[   TIME   ] %s: %.3f ms\n", name, milliseconds);
+    ::testing::Test::RecordProperty(name, profiles_test::format("%.3f", milliseconds));
+}
+
+static double Median(std::vector<double> values) {
+    std::sort(values.begin(), values.end());
+    return values[values.size() / 2];
+}
+
+static double MillisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Median durations of creating an instance with the layer settings and of its first physical devices enumeration, which
+// loads the profile for each physical device
+struct InstanceLoadTime {
+    double create_instance{0.0};
+    double enumerate_physical_devices{0.0};
+    bool has_physical_device{false};
+};
+
+static InstanceLoadTime MeasureInstanceLoad(const std::vector<VkLayerSettingEXT>& settings) {
+    profiles_test::setEnvironmentSetting("VK_LAYER_PATH", TEST_BINARY_PATH);
+
+    VkLayerSettingsCreateInfoEXT layer_settings_create_info{VK_STRUCTURE_TYPE_LAYER_SETTINGS_CREATE_INFO_EXT, nullptr,
+                                                            static_cast<uint32_t>(settings.size()), settings.data()};
+
+    std::vector<const char*> layer_names = {kLayerName};
+    std::vector<const char*> extension_names = {VK_EXT_LAYER_SETTINGS_EXTENSION_NAME};
+
+    VkApplicationInfo app_info{profiles_test::GetDefaultApplicationInfo()};
+
+    VkInstanceCreateInfo inst_create_info = {};
+    inst_create_info.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+    inst_create_info.pNext = &layer_settings_create_info;
+#ifdef __APPLE__
+    extension_names.push_back(VK_KHR_PORTABILITY_ENUMERATION_EXTENSION_NAME);
+    inst_create_info.flags |= VK_INSTANCE_CREATE_ENUMERATE_PORTABILITY_BIT_KHR;
+#endif
+    inst_create_info.pApplicationInfo = &app_info;
+    inst_create_info.enabledLayerCount = static_cast<uint32_t>(layer_names.size());
+    inst_create_info.ppEnabledLayerNames = layer_names.data();
+    inst_create_info.enabledExtensionCount = static_cast<uint32_t>(extension_names.size());
+    inst_create_info.ppEnabledExtensionNames = extension_names.data();
+
+    std::vector<double> create_instance;
+    std::vector<double> enumerate_physical_devices;
+    InstanceLoadTime result;
+
+    for (int i = 0; i < kRunCount; ++i) {
+        const auto create_start = std::chrono::steady_clock::now();
+        VkInstance instance = VK_NULL_HANDLE;
+        VkResult err = vkCreateInstance(&inst_create_info, nullptr, &instance);
+        create_instance.push_back(MillisecondsSince(create_start));
+        EXPECT_EQ(err, VK_SUCCESS);
+        if (err != VK_SUCCESS) {
+            return result;
+        }
+
+        const auto enumerate_start = std::chrono::steady_clock::now();
+        uint32_t gpu_count = 0;
+        err = vkEnumeratePhysicalDevices(instance, &gpu_count, nullptr);
+        std::vector<VkPhysicalDevice> gpus(gpu_count);
+        if (err == VK_SUCCESS && gpu_count > 0) {
+            err = vkEnumeratePhysicalDevices(instance, &gpu_count, gpus.data());
+        }
+        enumerate_physical_devices.push_back(MillisecondsSince(enumerate_start));
+        result.has_physical_device = err == VK_SUCCESS && gpu_count > 0;
+
+        vkDestroyInstance(instance, nullptr);
+    }
+
+    result.create_instance = Median(create_instance);
+    result.enumerate_physical_devices = Median(enumerate_physical_devices);
+    return result;
+}
+
+static void WriteProfileFile(const std::string& path, const std::string& profiles) {
+    std::ofstream file(path);
+    file << "{\n"
+            "    \"$schema\": \"https://schema.khronos.org/vulkan/profiles-0.8.0-204.json#\",\n"
+            "    \"capabilities\": {\n"
+            "        \"baseline\": {\n"
+            "            \"extensions\": {\n"
+            "                \"VK_KHR_maintenance3\": 1\n"
+            "            }\n"
+            "        }\n"
+            "    },\n"
+            "    \"profiles\": {\n"
+         << profiles
+         << "    }\n"
+            "}\n";
+}
+
+static std::string ProfileEntry(const std::string& name, const std::vector<std::string>& required_profiles, bool last) {
+    std::string entry = "        \"" + name + "\": {\n"
+                        "            \"version\": 1,\n"
+                        "            \"api-version\": \"1.0.198\",\n"
+                        "            \"label\": \"Benchmark\",\n"
+                        "            \"description\": \"Unit test file\",\n";
+    if (!required_profiles.empty()) {
+        entry += "            \"profiles\": [\n";
+        for (std::size_t i = 0, n = required_profiles.size(); i < n; ++i) {
+            entry += "                \"" + required_profiles[i] + (i + 1 < n ? "\",\n" : "\"\n");
+        }
+        entry += "            ],\n";
+    }
+    entry += "            \"capabilities\": [\n"
+             "                \"baseline\"\n"
+             "            ]\n"
+             "        }";
+    entry += last ? "\n" : ",\n";
+    return entry;
+}
+
+TEST_F(TestsBenchmark, profile_name_lookup) {
+    TEST_DESCRIPTION("Time the loading of a profile with many required profiles spread over many profile files");
+
+    const std::string profile_dirs_path = TEST_BINARY_PATH "/profiles_benchmark_lookup";
+    std::filesystem::remove_all(profile_dirs_path);
+    std::filesystem::create_directories(profile_dirs_path);
+
+    // The requested profile, in the last file, requires a profile of each of the other files
+    const int file_count = 64;
+    const int profiles_per_file = 16;
+    std::vector<std::string> required_profiles;
+    for (int i = 0; i < file_count; ++i) {
+        std::string profiles;
+        for (int j = 0; j < profiles_per_file; ++j) {
+            const std::string name = profiles_test::format("VP_LUNARG_test_lookup_%02d_%02d", i, j);
+            const bool last = j + 1 == profiles_per_file;
+            profiles += ProfileEntry(name, i + 1 == file_count && last ? required_profiles : std::vector<std::string>(), last);
+            if (last) {
+                required_profiles.push_back(name);
+            }
+        }
+        WriteProfileFile(profile_dirs_path + profiles_test::format("/VP_LUNARG_test_lookup_%02d.json", i), profiles);
+    }
+
+    const char* profile_dirs_data = profile_dirs_path.c_str();
+    const std::string profile_name = required_profiles.back();
+    const char* profile_name_data = profile_name.c_str();
+    VkBool32 emulate_portability_data = VK_FALSE;
+    const std::vector<const char*> simulate_capabilities = {"SIMULATE_EXTENSIONS_BIT"};
+
+    std::vector<VkLayerSettingEXT> settings = {
+        {kLayerName, kLayerSettingsProfileDirs, VK_LAYER_SETTING_TYPE_STRING_EXT, 1, &profile_dirs_data},
+        {kLayerName, kLayerSettingsProfileName, VK_LAYER_SETTING_TYPE_STRING_EXT, 1, &profile_name_data},
+        {kLayerName, kLayerSettingsEmulatePortability, VK_LAYER_SETTING_TYPE_BOOL32_EXT, 1, &emulate_portability_data},
+        {kLayerName, kLayerSettingsSimulateCapabilities, VK_LAYER_SETTING_TYPE_STRING_EXT, static_cast<uint32_t>(simulate_capabilities.size()), &simulate_capabilities[0]}};
+
+    const InstanceLoadTime time = MeasureInstanceLoad(settings);
+    ReportTime("profile_name_lookup.create_instance", time.create_instance);
+    ReportTime("profile_name_lookup.enumerate_physical_devices", time.enumerate_physical_devices);
+
+    std::filesystem::remove_all(profile_dirs_path);
+}
+
+TEST_F(TestsBenchmark, profile_parallel_loading) {
+    TEST_DESCRIPTION("Time the loading of a profile dir with many profile files, sequentially then in parallel");
+
+    const std::string profile_dirs_path = TEST_BINARY_PATH "/profiles_benchmark_parallel";
+    std::filesystem::remove_all(profile_dirs_path);
+    std::filesystem::create_directories(profile_dirs_path);
+
+    const int file_count = 500;
+    for (int i = 0; i < file_count; ++i) {
+        const std::string name = profiles_test::format("VP_LUNARG_test_parallel_%03d", i);
+        WriteProfileFile(profile_dirs_path + "/" + name + ".json", ProfileEntry(name, std::vector<std::string>(), true));
+    }
+
+    const char* profile_dirs_data = profile_dirs_path.c_str();
+    const char* profile_name_data = "VP_LUNARG_test_parallel_499";
+    VkBool32 emulate_portability_data = VK_FALSE;
+    const std::vector<const char*> simulate_capabilities = {"SIMULATE_EXTENSIONS_BIT"};
+
+    double create_instance[2] = {};
+    for (VkBool32 profile_parallel_loading_data : {VK_FALSE, VK_TRUE}) {
+        std::vector<VkLayerSettingEXT> settings = {
+            {kLayerName, kLayerSettingsProfileDirs, VK_LAYER_SETTING_TYPE_STRING_EXT, 1, &profile_dirs_data},
+            {kLayerName, kLayerSettingsProfileName, VK_LAYER_SETTING_TYPE_STRING_EXT, 1, &profile_name_data},
+            {kLayerName, kLayerSettingsProfileParallelLoading, VK_LAYER_SETTING_TYPE_BOOL32_EXT, 1, &profile_parallel_loading_data},
+            {kLayerName, kLayerSettingsEmulatePortability, VK_LAYER_SETTING_TYPE_BOOL32_EXT, 1, &emulate_portability_data},
+            {kLayerName, kLayerSettingsSimulateCapabilities, VK_LAYER_SETTING_TYPE_STRING_EXT, static_cast<uint32_t>(simulate_capabilities.size()), &simulate_capabilities[0]}};
+
+        create_instance[profile_parallel_loading_data] = MeasureInstanceLoad(settings).create_instance;
+    }
+
+    ReportTime("profile_parallel_loading.sequential.create_instance", create_instance[VK_FALSE]);
+    ReportTime("profile_parallel_loading.parallel.create_instance", create_instance[VK_TRUE]);
+    printf("[   TIME   ] profile_parallel_loading: %.2fx speedup on %u hardware threads\n",
+           create_instance[VK_FALSE] / std::max(create_instance[VK_TRUE], 0.001), std::thread::hardware_concurrency());
+
+    std::filesystem::remove_all(profile_dirs_path);
+}
+
+#if defined(__linux__)
+// Peak resident set size of the process since the last ResetPeakResidentSetSize(), in KiB
+static long GetPeakResidentSetSize() {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.compare(0, 6, "VmHWM:") == 0) {
+            return std::stol(line.substr(6));
+        }
+    }
+    return 0;
+}
+
+static void ResetPeakResidentSetSize() { std::ofstream("/proc/self/clear_refs") << "5"; }
+#endif
+
+TEST_F(TestsBenchmark, profile_file_reading) {
+    TEST_DESCRIPTION("Time the reading and parsing of large profile files");
+
+    const char* profile_dirs_data = JSON_PROFILES_PATH "VP_LUNARG_desktop_max_2024";
+    const char* profile_name_data = "VP_GPUINFO_NVIDIA_GeForce_RTX_2060_537_59_0_0_windows_11";
+    VkBool32 emulate_portability_data = VK_FALSE;
+    const std::vector<const char*> simulate_capabilities = {"SIMULATE_EXTENSIONS_BIT"};
+
+    std::vector<VkLayerSettingEXT> settings = {
+        {kLayerName, kLayerSettingsProfileDirs, VK_LAYER_SETTING_TYPE_STRING_EXT, 1, &profile_dirs_data},
+        {kLayerName, kLayerSettingsProfileName, VK_LAYER_SETTING_TYPE_STRING_EXT, 1, &profile_name_data},
+        {kLayerName, kLayerSettingsEmulatePortability, VK_LAYER_SETTING_TYPE_BOOL32_EXT, 1, &emulate_portability_data},
+        {kLayerName, kLayerSettingsSimulateCapabilities, VK_LAYER_SETTING_TYPE_STRING_EXT, static_cast<uint32_t>(simulate_capabilities.size()), &simulate_capabilities[0]}};
+
+#if defined(__linux__)
+    ResetPeakResidentSetSize();
+    const long initial_resident_set_size = GetPeakResidentSetSize();
+#endif
+
+    // The profile files are indexed and the requested profile file is parsed by vkCreateInstance
+    const InstanceLoadTime time = MeasureInstanceLoad(settings);
+    ReportTime("profile_file_reading.create_instance", time.create_instance);
+
+#if defined(__linux__)
+    printf("[   TIME   ] profile_file_reading: %ld KiB peak resident set size increase\n",
+           GetPeakResidentSetSize() - initial_resident_set_size);
+#endif
+}
+
+TEST_F(TestsBenchmark, profile_structures_loading) {
+    TEST_DESCRIPTION("Time the loading of the features and properties structures of a full device profile");
+
+    const char* profile_file_data = JSON_PROFILES_PATH "VP_LUNARG_desktop_max_2024/vp_gpuinfo_nvidia_geforce_rtx_2060_537_59_0_0_windows_11.json";
+    const char* profile_name_data = "VP_GPUINFO_NVIDIA_GeForce_RTX_2060_537_59_0_0_windows_11";
+    VkBool32 emulate_portability_data = VK_FALSE;
+    const std::vector<const char*> simulate_capabilities = {"SIMULATE_FEATURES_BIT", "SIMULATE_PROPERTIES_BIT"};
+
+    std::vector<VkLayerSettingEXT> settings = {
+        {kLayerName, kLayerSettingsProfileFile, VK_LAYER_SETTING_TYPE_STRING_EXT, 1, &profile_file_data},
+        {kLayerName, kLayerSettingsProfileName, VK_LAYER_SETTING_TYPE_STRING_EXT, 1, &profile_name_data},
+        {kLayerName, kLayerSettingsEmulatePortability, VK_LAYER_SETTING_TYPE_BOOL32_EXT, 1, &emulate_portability_data},
+        {kLayerName, kLayerSettingsSimulateCapabilities, VK_LAYER_SETTING_TYPE_STRING_EXT, static_cast<uint32_t>(simulate_capabilities.size()), &simulate_capabilities[0]}};
+
+    // The structures of the profile are loaded for each physical device by vkEnumeratePhysicalDevices
+    const InstanceLoadTime time = MeasureInstanceLoad(settings);
+    if (!time.has_physical_device) {
+        printf("No physical device, skipping test.\n");
+        return;
+    }
+    ReportTime("profile_structures_loading.enumerate_physical_devices", time.enumerate_physical_devices);
+}
+
+TEST_F(TestsBenchmark, profile_values_comparison) {
+    TEST_DESCRIPTION("Time the comparisons of the profile properties with the device properties, for different devices profiles");
+
+    const std::vector<std::pair<const char*, const char*>> profiles = {
+        {JSON_PROFILES_PATH "VP_LUNARG_desktop_max_2024/vp_gpuinfo_amd_radeon_rx_6800_xt_2_0_283_windows_11.json",
+         "VP_GPUINFO_AMD_Radeon_RX_6800_XT_2_0_283_windows_11"},
+        {JSON_PROFILES_PATH "VP_LUNARG_desktop_max_2024/vp_gpuinfo_intel_r__arc_tm__a750_graphics_0_405_728_windows_10.json",
+         "VP_GPUINFO_Intel_R__Arc_TM__A750_Graphics_0_405_728_windows_10"},
+        {JSON_PROFILES_PATH "VP_LUNARG_desktop_max_2024/vp_gpuinfo_nvidia_geforce_rtx_2060_537_59_0_0_windows_11.json",
+         "VP_GPUINFO_NVIDIA_GeForce_RTX_2060_537_59_0_0_windows_11"}};
+
+    // Without any report, only the comparisons are timed and not the formatting of the mismatch messages
+    const char* debug_reports = "";
+    VkBool32 emulate_portability_data = VK_FALSE;
+    const std::vector<const char*> simulate_capabilities = {"SIMULATE_PROPERTIES_BIT"};
+
+    double enumerate_physical_devices = 0.0;
+    for (const auto& profile : profiles) {
+        std::vector<VkLayerSettingEXT> settings = {
+            {kLayerName, kLayerSettingsProfileFile, VK_LAYER_SETTING_TYPE_STRING_EXT, 1, &profile.first},
+            {kLayerName, kLayerSettingsProfileName, VK_LAYER_SETTING_TYPE_STRING_EXT, 1, &profile.second},
+            {kLayerName, kLayerSettingsEmulatePortability, VK_LAYER_SETTING_TYPE_BOOL32_EXT, 1, &emulate_portability_data},
+            {kLayerName, kLayerSettingsSimulateCapabilities, VK_LAYER_SETTING_TYPE_STRING_EXT, static_cast<uint32_t>(simulate_capabilities.size()), &simulate_capabilities[0]},
+            {kLayerName, kLayerSettingsDebugReports, VK_LAYER_SETTING_TYPE_STRING_EXT, 0, {&debug_reports}}};
+
+        const InstanceLoadTime time = MeasureInstanceLoad(settings);
+        if (!time.has_physical_device) {
+            printf("No physical device, skipping test.\n");
+            return;
+        }
+        enumerate_physical_devices += time.enumerate_physical_devices;
+    }
+
+    ReportTime("profile_values_comparison.enumerate_physical_devices", enumerate_physical_devices);
+}
+
+TEST_F(TestsBenchmark, query_contention) {
+    TEST_DESCRIPTION("Time the physical device queries from one thread then from multiple threads");
+
+    const char* profile_file_data = JSON_TEST_FILES_PATH "VP_LUNARG_test_capabilities.json";
+    const char* profile_name_data = "VP_LUNARG_test_capabilities_or";
+    VkBool32 emulate_portability_data = VK_TRUE;
+    const std::vector<const char*> simulate_capabilities = {"SIMULATE_MAX_ENUM"};
+
+    std::vector<VkLayerSettingEXT> settings = {
+        {kLayerName, kLayerSettingsProfileFile, VK_LAYER_SETTING_TYPE_STRING_EXT, 1, &profile_file_data},
+        {kLayerName, kLayerSettingsProfileName, VK_LAYER_SETTING_TYPE_STRING_EXT, 1, &profile_name_data},
+        {kLayerName, kLayerSettingsEmulatePortability, VK_LAYER_SETTING_TYPE_BOOL32_EXT, 1, &emulate_portability_data},
+        {kLayerName, kLayerSettingsSimulateCapabilities, VK_LAYER_SETTING_TYPE_STRING_EXT, static_cast<uint32_t>(simulate_capabilities.size()), &simulate_capabilities[0]}};
+
+    profiles_test::VulkanInstanceBuilder inst_builder;
+    VkResult err = inst_builder.init(settings);
+    ASSERT_EQ(err, VK_SUCCESS);
+
+    VkPhysicalDevice gpu;
+    err = inst_builder.getPhysicalDevice(profiles_test::MODE_PROFILE, &gpu);
+    if (err != VK_SUCCESS) {
+        printf("Profile not supported on device, skipping test.\n");
+        return;
+    }
+
+    // Each thread runs the same number of queries, the duration is constant while the queries don't contend
+    const int query_count = 20000;
+    const auto run_queries = [&](unsigned thread_count) -> double {
+        const auto start = std::chrono::steady_clock::now();
+        std::vector<std::thread> threads;
+        for (unsigned i = 0; i < thread_count; ++i) {
+            threads.emplace_back([&]() {
+                for (int j = 0; j < query_count; ++j) {
+                    VkPhysicalDeviceProperties properties{};
+                    vkGetPhysicalDeviceProperties(gpu, &properties);
+
+                    VkFormatProperties format_properties{};
+                    vkGetPhysicalDeviceFormatProperties(gpu, VK_FORMAT_R8G8B8A8_UNORM, &format_properties);
+
+                    VkImageFormatProperties image_format_properties{};
+                    vkGetPhysicalDeviceImageFormatProperties(gpu, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_TYPE_2D, VK_IMAGE_TILING_OPTIMAL,
+                                                             VK_IMAGE_USAGE_SAMPLED_BIT, 0, &image_format_properties);
+                }
+            });
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+        return MillisecondsSince(start);
+    };
+
+    const unsigned thread_count = std::max(2u, std::min(8u, std::thread::hardware_concurrency()));
+    const double single_thread = run_queries(1);
+    const double multiple_threads = run_queries(thread_count);
+
+    ReportTime("query_contention.single_thread", single_thread);
+    ReportTime("query_contention.multiple_threads", multiple_threads);
+    printf("[   TIME   ] query_contention: %.2fx queries throughput with %u threads\n",
+           single_thread * thread_count / std::max(multiple_threads, 0.001), thread_count);
+
+    inst_builder.reset();
+}
+
+// Chain of zeroed structures of the given types, each large enough to hold any features or properties structure
+class PNextChain {
+   public:
+    explicit PNextChain(const std::vector<VkStructureType>& types) : storage_(types.size(), std::vector<uint64_t>(512, 0)) {
+        for (std::size_t i = 0, n = types.size(); i < n; ++i) {
+            VkBaseOutStructure* structure = reinterpret_cast<VkBaseOutStructure*>(storage_[i].data());
+            structure->sType = types[i];
+            structure->pNext = i + 1 < n ? reinterpret_cast<VkBaseOutStructure*>(storage_[i + 1].data()) : nullptr;
+        }
+    }
+
+    void* head() { return storage_.empty() ? nullptr : storage_[0].data(); }
+
+   private:
+    std::vector<std::vector<uint64_t>> storage_;
+};
+
+TEST_F(TestsBenchmark, profile_extensions_lookup) {
+    TEST_DESCRIPTION("Time the extensions checks of the physical devices enumeration and of the pNext chains filling");
+
+    const char* profile_file_data = JSON_PROFILES_PATH "VP_LUNARG_desktop_max_2024/vp_gpuinfo_nvidia_geforce_rtx_2060_537_59_0_0_windows_11.json";
+    const char* profile_name_data = "VP_GPUINFO_NVIDIA_GeForce_RTX_2060_537_59_0_0_windows_11";
+    VkBool32 emulate_portability_data = VK_FALSE;
+    const std::vector<const char*> simulate_capabilities = {"SIMULATE_EXTENSIONS_BIT", "SIMULATE_FEATURES_BIT", "SIMULATE_PROPERTIES_BIT"};
+
+    std::vector<VkLayerSettingEXT> settings = {
+        {kLayerName, kLayerSettingsProfileFile, VK_LAYER_SETTING_TYPE_STRING_EXT, 1, &profile_file_data},
+        {kLayerName, kLayerSettingsProfileName, VK_LAYER_SETTING_TYPE_STRING_EXT, 1, &profile_name_data},
+        {kLayerName, kLayerSettingsEmulatePortability, VK_LAYER_SETTING_TYPE_BOOL32_EXT, 1, &emulate_portability_data},
+        {kLayerName, kLayerSettingsSimulateCapabilities, VK_LAYER_SETTING_TYPE_STRING_EXT, static_cast<uint32_t>(simulate_capabilities.size()), &simulate_capabilities[0]}};
+
+    // vkEnumeratePhysicalDevices checks the support of each of the profile extensions
+    const InstanceLoadTime time = MeasureInstanceLoad(settings);
+    if (!time.has_physical_device) {
+        printf("No physical device, skipping test.\n");
+        return;
+    }
+    ReportTime("profile_extensions_lookup.enumerate_physical_devices", time.enumerate_physical_devices);
+
+    profiles_test::VulkanInstanceBuilder inst_builder;
+    VkResult err = inst_builder.init(settings);
+    ASSERT_EQ(err, VK_SUCCESS);
+
+    VkPhysicalDevice gpu;
+    err = inst_builder.getPhysicalDevice(profiles_test::MODE_PROFILE, &gpu);
+    if (err != VK_SUCCESS) {
+        printf("Profile not supported on device, skipping test.\n");
+        return;
+    }
+
+    // Each structure of the chains is only filled when its extension is simulated or supported
+    PNextChain features_chain({VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_FEATURES_EXT,
+                               VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_2_FEATURES_EXT,
+                               VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_CUSTOM_BORDER_COLOR_FEATURES_EXT,
+                               VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_INDEX_TYPE_UINT8_FEATURES_EXT,
+                               VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_LINE_RASTERIZATION_FEATURES_EXT,
+                               VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ROBUSTNESS_2_FEATURES_EXT});
+    PNextChain properties_chain({VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PUSH_DESCRIPTOR_PROPERTIES_KHR,
+                                 VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DEPTH_STENCIL_RESOLVE_PROPERTIES,
+                                 VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES,
+                                 VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FLOAT_CONTROLS_PROPERTIES,
+                                 VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_PROPERTIES,
+                                 VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SAMPLER_FILTER_MINMAX_PROPERTIES});
+
+    const int query_count = 10000;
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < query_count; ++i) {
+        VkPhysicalDeviceFeatures2 features{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2, features_chain.head()};
+        vkGetPhysicalDeviceFeatures2(gpu, &features);
+
+        VkPhysicalDeviceProperties2 properties{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2, properties_chain.head()};
+        vkGetPhysicalDeviceProperties2(gpu, &properties);
+    }
+    ReportTime("profile_extensions_lookup.fill_pnext_chains", MillisecondsSince(start));
+
+    inst_builder.reset();
+}
+
+TEST_F(TestsBenchmark, features_chain_filling) {
+    TEST_DESCRIPTION("Time the filling of a VkPhysicalDeviceFeatures2 chain of 40 structures");
+
+    const char* profile_file_data = JSON_PROFILES_PATH "VP_LUNARG_desktop_max_2024/vp_gpuinfo_nvidia_geforce_rtx_2060_537_59_0_0_windows_11.json";
+    const char* profile_name_data = "VP_GPUINFO_NVIDIA_GeForce_RTX_2060_537_59_0_0_windows_11";
+    VkBool32 emulate_portability_data = VK_FALSE;
+    const std::vector<const char*> simulate_capabilities = {"SIMULATE_EXTENSIONS_BIT", "SIMULATE_FEATURES_BIT"};
+
+    std::vector<VkLayerSettingEXT> settings = {
+        {kLayerName, kLayerSettingsProfileFile, VK_LAYER_SETTING_TYPE_STRING_EXT, 1, &profile_file_data},
+        {kLayerName, kLayerSettingsProfileName, VK_LAYER_SETTING_TYPE_STRING_EXT, 1, &profile_name_data},
+        {kLayerName, kLayerSettingsEmulatePortability, VK_LAYER_SETTING_TYPE_BOOL32_EXT, 1, &emulate_portability_data},
+        {kLayerName, kLayerSettingsSimulateCapabilities, VK_LAYER_SETTING_TYPE_STRING_EXT, static_cast<uint32_t>(simulate_capabilities.size()), &simulate_capabilities[0]}};
+
+    profiles_test::VulkanInstanceBuilder inst_builder;
+    VkResult err = inst_builder.init(settings);
+    ASSERT_EQ(err, VK_SUCCESS);
+
+    VkPhysicalDevice gpu;
+    err = inst_builder.getPhysicalDevice(profiles_test::MODE_PROFILE, &gpu);
+    if (err != VK_SUCCESS) {
+        printf("Profile not supported on device, skipping test.\n");
+        return;
+    }
+
+    const std::vector<VkStructureType> feature_types = {
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_1_FEATURES,
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES,
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES,
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_16BIT_STORAGE_FEATURES,
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MULTIVIEW_FEATURES,
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VARIABLE_POINTERS_FEATURES,
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROTECTED_MEMORY_FEATURES,
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SAMPLER_YCBCR_CONVERSION_FEATURES,
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADER_DRAW_PARAMETERS_FEATURES,
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_8BIT_STORAGE_FEATURES,
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADER_ATOMIC_INT64_FEATURES,
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADER_FLOAT16_INT8_FEATURES,
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES,
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SCALAR_BLOCK_LAYOUT_FEATURES,
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_MEMORY_MODEL_FEATURES,
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_IMAGELESS_FRAMEBUFFER_FEATURES,
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_UNIFORM_BUFFER_STANDARD_LAYOUT_FEATURES,
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADER_SUBGROUP_EXTENDED_TYPES_FEATURES,
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SEPARATE_DEPTH_STENCIL_LAYOUTS_FEATURES,
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_HOST_QUERY_RESET_FEATURES,
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES,
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_BUFFER_DEVICE_ADDRESS_FEATURES,
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADER_TERMINATE_INVOCATION_FEATURES,
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADER_DEMOTE_TO_HELPER_INVOCATION_FEATURES,
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRIVATE_DATA_FEATURES,
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PIPELINE_CREATION_CACHE_CONTROL_FEATURES,
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES,
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ZERO_INITIALIZE_WORKGROUP_MEMORY_FEATURES,
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_IMAGE_ROBUSTNESS_FEATURES,
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SUBGROUP_SIZE_CONTROL_FEATURES,
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_INLINE_UNIFORM_BLOCK_FEATURES,
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TEXTURE_COMPRESSION_ASTC_HDR_FEATURES,
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES,
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADER_INTEGER_DOT_PRODUCT_FEATURES,
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MAINTENANCE_4_FEATURES,
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_FEATURES_EXT,
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_2_FEATURES_EXT,
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_CUSTOM_BORDER_COLOR_FEATURES_EXT,
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_INDEX_TYPE_UINT8_FEATURES_EXT,
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ROBUSTNESS_2_FEATURES_EXT};
+    EXPECT_EQ(feature_types.size(), 40u);
+
+    PNextChain chain(feature_types);
+
+    const int query_count = 10000;
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < query_count; ++i) {
+        VkPhysicalDeviceFeatures2 features{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2, chain.head()};
+        vkGetPhysicalDeviceFeatures2(gpu, &features);
+    }
+    ReportTime("features_chain_filling.get_physical_device_features2", MillisecondsSince(start));
+
+    inst_builder.reset();
+}
+
+TEST_F(TestsBenchmark, filtered_reports) {
+    TEST_DESCRIPTION("Time the loading of a profile with the error reports only then with all the reports");
+
+    const char* profile_file_data = JSON_PROFILES_PATH "VP_LUNARG_desktop_max_2024/vp_gpuinfo_nvidia_geforce_rtx_2060_537_59_0_0_windows_11.json";
+    const char* profile_name_data = "VP_GPUINFO_NVIDIA_GeForce_RTX_2060_537_59_0_0_windows_11";
+    VkBool32 emulate_portability_data = VK_FALSE;
+    const std::vector<const char*> simulate_capabilities = {"SIMULATE_MAX_ENUM"};
+
+    // The reports are written to a file to keep the messages formatting cost without flooding stdout
+    const std::string debug_filename = TEST_BINARY_PATH "/profiles_benchmark_reports.txt";
+    const char* debug_filename_data = debug_filename.c_str();
+    const char* debug_actions = "DEBUG_ACTION_FILE_BIT";
+    VkBool32 debug_file_clear = VK_TRUE;
+
+    const auto measure = [&](const char* debug_reports) {
+        std::vector<VkLayerSettingEXT> settings = {
+            {kLayerName, kLayerSettingsProfileFile, VK_LAYER_SETTING_TYPE_STRING_EXT, 1, &profile_file_data},
+            {kLayerName, kLayerSettingsProfileName, VK_LAYER_SETTING_TYPE_STRING_EXT, 1, &profile_name_data},
+            {kLayerName, kLayerSettingsEmulatePortability, VK_LAYER_SETTING_TYPE_BOOL32_EXT, 1, &emulate_portability_data},
+            {kLayerName, kLayerSettingsSimulateCapabilities, VK_LAYER_SETTING_TYPE_STRING_EXT, static_cast<uint32_t>(simulate_capabilities.size()), &simulate_capabilities[0]},
+            {kLayerName, kLayerSettingsDebugActions, VK_LAYER_SETTING_TYPE_STRING_EXT, 1, &debug_actions},
+            {kLayerName, kLayerSettingsDebugFilename, VK_LAYER_SETTING_TYPE_STRING_EXT, 1, &debug_filename_data},
+            {kLayerName, kLayerSettingsDebugFileClear, VK_LAYER_SETTING_TYPE_BOOL32_EXT, 1, &debug_file_clear},
+            {kLayerName, kLayerSettingsDebugReports, VK_LAYER_SETTING_TYPE_STRING_EXT, 1, &debug_reports}};
+        return MeasureInstanceLoad(settings);
+    };
+
+    const InstanceLoadTime errors_only = measure("DEBUG_REPORT_ERROR_BIT");
+    const InstanceLoadTime all_reports = measure("DEBUG_REPORT_MAX_ENUM");
+    std::filesystem::remove(debug_filename);
+    if (!errors_only.has_physical_device || !all_reports.has_physical_device) {
+        printf("No physical device, skipping test.\n");
+        return;
+    }
+
+    const double errors_only_time = errors_only.create_instance + errors_only.enumerate_physical_devices;
+    const double all_reports_time = all_reports.create_instance + all_reports.enumerate_physical_devices;
+    ReportTime("filtered_reports.errors_only", errors_only_time);
+    ReportTime("filtered_reports.all_reports", all_reports_time);
+    ReportTime("filtered_reports.time_saved", all_reports_time - errors_only_time);
+}
@@ -26,7 +26,12 @@
 #include <gtest/gtest.h>
 #include "profiles_test_helper.h"
 
+#include <atomic>
+#include <chrono>
 #include <cstdarg>
+#include <filesystem>
+#include <fstream>
+#include <thread>
 
 class TestsMechanism : public VkTestFramework {
    public:
@@ -602,3 +607,418 @@ TEST_F(TestsMechanism, capabilities_or) {
     VkResult err = inst_builder.init(settings);
     EXPECT_EQ(err, VK_SUCCESS);
 }
+
+TEST_F(TestsMechanism, profile_cache_dir) {
+    TEST_DESCRIPTION("Test loading a profile file through the profile cache");
+
+    const std::string cache_dir_path = TEST_BINARY_PATH "/profiles_cache";
+    std::filesystem::remove_all(cache_dir_path);
+
+    const char* profile_file_data = JSON_TEST_FILES_PATH "VP_LUNARG_test_device_extensions.json";
+    const char* profile_name_data = "VP_LUNARG_test_device_extensions";
+    const char* profile_cache_dir_data = cache_dir_path.c_str();
+    VkBool32 emulate_portability_data = VK_FALSE;
+    const std::vector<const char*> simulate_capabilities = {"SIMULATE_EXTENSIONS_BIT"};
+
+    std::vector<VkLayerSettingEXT> settings = {
+        {kLayerName, kLayerSettingsProfileFile, VK_LAYER_SETTING_TYPE_STRING_EXT, 1, &profile_file_data},
+        {kLayerName, kLayerSettingsProfileName, VK_LAYER_SETTING_TYPE_STRING_EXT, 1, &profile_name_data},
+        {kLayerName, kLayerSettingsProfileCacheDir, VK_LAYER_SETTING_TYPE_STRING_EXT, 1, &profile_cache_dir_data},
+        {kLayerName, kLayerSettingsEmulatePortability, VK_LAYER_SETTING_TYPE_BOOL32_EXT, 1, &emulate_portability_data},
+        {kLayerName, kLayerSettingsSimulateCapabilities, VK_LAYER_SETTING_TYPE_STRING_EXT, static_cast<uint32_t>(simulate_capabilities.size()), &simulate_capabilities[0]}};
+
+    // The first instance writes the cache entry, the second instance reads it
+    for (int i = 0; i < 2; ++i) {
+        profiles_test::VulkanInstanceBuilder inst_builder;
+        VkResult err = inst_builder.init(settings);
+        ASSERT_EQ(err, VK_SUCCESS);
+
+        VkPhysicalDevice gpu;
+        err = inst_builder.getPhysicalDevice(profiles_test::MODE_PROFILE, &gpu);
+        if (err != VK_SUCCESS) {
+            printf("Profile not supported on device, skipping test.\n");
+            inst_builder.reset();
+            return;
+        }
+
+        uint32_t cache_file_count = 0;
+        for (const auto& entry : std::filesystem::directory_iterator(cache_dir_path)) {
+            if (entry.path().extension() == ".profile_cache") {
+                ++cache_file_count;
+            }
+        }
+        EXPECT_EQ(1, cache_file_count);
+
+        uint32_t extCount = 0;
+        VkResult result = vkEnumerateDeviceExtensionProperties(gpu, nullptr, &extCount, nullptr);
+        ASSERT_EQ(result, VK_SUCCESS);
+        EXPECT_EQ(1, extCount);
+
+        std::vector<VkExtensionProperties> ext(extCount);
+        result = vkEnumerateDeviceExtensionProperties(gpu, nullptr, &extCount, ext.data());
+        ASSERT_EQ(result, VK_SUCCESS);
+        EXPECT_STREQ("VK_KHR_maintenance3", ext[0].extensionName);
+
+        inst_builder.reset();
+    }
+
+    std::filesystem::remove_all(cache_dir_path);
+}
+
+TEST_F(TestsMechanism, selecting_profile_dirs_many_files) {
+    TEST_DESCRIPTION("Test selecting a profile from a profiles dir with many profile files");
+
+    const std::string profile_dirs_path = TEST_BINARY_PATH "/profiles_many_files";
+    std::filesystem::remove_all(profile_dirs_path);
+    std::filesystem::create_directories(profile_dirs_path);
+
+    const int profile_file_count = 512;
+    for (int i = 0; i < profile_file_count; ++i) {
+        char profile_name[64];
+        snprintf(profile_name, sizeof(profile_name), "VP_LUNARG_test_many_files_%03d", i);
+
+        std::ofstream file(profile_dirs_path + "/" + profile_name + ".json");
+        file << "{\n"
+                "    \"$schema\": \"https://schema.khronos.org/vulkan/profiles-0.8.0-204.json#\",\n"
+                "    \"capabilities\": {\n"
+                "        \"baseline\": {\n"
+                "            \"extensions\": {\n"
+                "                \"VK_KHR_maintenance3\": 1\n"
+                "            }\n"
+                "        }\n"
+                "    },\n"
+                "    \"profiles\": {\n"
+                "        \"" << profile_name << "\": {\n"
+                "            \"version\": 1,\n"
+                "            \"api-version\": \"1.0.198\",\n"
+                "            \"label\": \"Many files\",\n"
+                "            \"description\": \"Unit test file\",\n"
+                "            \"capabilities\": [\n"
+                "                \"baseline\"\n"
+                "            ]\n"
+                "        }\n"
+                "    }\n"
+                "}\n";
+    }
+
+    const char* profile_dirs_data = profile_dirs_path.c_str();
+    const char* profile_name_data = "VP_LUNARG_test_many_files_511";
+    VkBool32 emulate_portability_data = VK_FALSE;
+    const std::vector<const char*> simulate_capabilities = {"SIMULATE_EXTENSIONS_BIT"};
+
+    // Load the profile files sequentially then in parallel
+    for (VkBool32 profile_parallel_loading_data : {VK_FALSE, VK_TRUE}) {
+        std::vector<VkLayerSettingEXT> settings = {
+            {kLayerName, kLayerSettingsProfileDirs, VK_LAYER_SETTING_TYPE_STRING_EXT, 1, &profile_dirs_data},
+            {kLayerName, kLayerSettingsProfileName, VK_LAYER_SETTING_TYPE_STRING_EXT, 1, &profile_name_data},
+            {kLayerName, kLayerSettingsProfileParallelLoading, VK_LAYER_SETTING_TYPE_BOOL32_EXT, 1, &profile_parallel_loading_data},
+            {kLayerName, kLayerSettingsEmulatePortability, VK_LAYER_SETTING_TYPE_BOOL32_EXT, 1, &emulate_portability_data},
+            {kLayerName, kLayerSettingsSimulateCapabilities, VK_LAYER_SETTING_TYPE_STRING_EXT, static_cast<uint32_t>(simulate_capabilities.size()), &simulate_capabilities[0]}};
+
+        profiles_test::VulkanInstanceBuilder inst_builder;
+        VkResult err = inst_builder.init(settings);
+        ASSERT_EQ(err, VK_SUCCESS);
+
+        VkPhysicalDevice gpu;
+        err = inst_builder.getPhysicalDevice(profiles_test::MODE_PROFILE, &gpu);
+        if (err != VK_SUCCESS) {
+            printf("Profile not supported on device, skipping test.\n");
+            inst_builder.reset();
+            break;
+        }
+
+        uint32_t extCount = 0;
+        VkResult result = vkEnumerateDeviceExtensionProperties(gpu, nullptr, &extCount, nullptr);
+        ASSERT_EQ(result, VK_SUCCESS);
+        EXPECT_EQ(1, extCount);
+
+        std::vector<VkExtensionProperties> ext(extCount);
+        result = vkEnumerateDeviceExtensionProperties(gpu, nullptr, &extCount, ext.data());
+        ASSERT_EQ(result, VK_SUCCESS);
+        EXPECT_STREQ("VK_KHR_maintenance3", ext[0].extensionName);
+
+        inst_builder.reset();
+    }
+
+    std::filesystem::remove_all(profile_dirs_path);
+}
+
+#if defined(__linux__)
+TEST_F(TestsMechanism, profile_hot_reload) {
+    TEST_DESCRIPTION("Test reloading a modified profile file without recreating the instance");
+
+    const std::string profile_dirs_path = TEST_BINARY_PATH "/profiles_hot_reload";
+    std::filesystem::remove_all(profile_dirs_path);
+    std::filesystem::create_directories(profile_dirs_path);
+
+    const std::string profile_file_path = profile_dirs_path + "/VP_LUNARG_test_hot_reload.json";
+    const auto write_profile_file = [&](const char* extension_name) {
+        // Replace the file like most editors do, with a rename of a new file
+        const std::string tmp_file_path = profile_file_path + ".tmp";
+        {
+            std::ofstream file(tmp_file_path);
+            file << "{\n"
+                    "    \"$schema\": \"https://schema.khronos.org/vulkan/profiles-0.8.0-204.json#\",\n"
+                    "    \"capabilities\": {\n"
+                    "        \"baseline\": {\n"
+                    "            \"extensions\": {\n"
+                    "                \"" << extension_name << "\": 1\n"
+                    "            }\n"
+                    "        }\n"
+                    "    },\n"
+                    "    \"profiles\": {\n"
+                    "        \"VP_LUNARG_test_hot_reload\": {\n"
+                    "            \"version\": 1,\n"
+                    "            \"api-version\": \"1.0.198\",\n"
+                    "            \"label\": \"Hot reload\",\n"
+                    "            \"description\": \"Unit test file\",\n"
+                    "            \"capabilities\": [\n"
+                    "                \"baseline\"\n"
+                    "            ]\n"
+                    "        }\n"
+                    "    }\n"
+                    "}\n";
+        }
+        std::filesystem::rename(tmp_file_path, profile_file_path);
+    };
+
+    const auto get_extension_name = [](VkPhysicalDevice gpu) -> std::string {
+        uint32_t extCount = 0;
+        VkResult result = vkEnumerateDeviceExtensionProperties(gpu, nullptr, &extCount, nullptr);
+        if (result != VK_SUCCESS || extCount != 1) {
+            return std::string();
+        }
+
+        VkExtensionProperties ext = {};
+        result = vkEnumerateDeviceExtensionProperties(gpu, nullptr, &extCount, &ext);
+        return result == VK_SUCCESS ? ext.extensionName : std::string();
+    };
+
+    const auto get_reloaded_extension_name = [&](VkPhysicalDevice gpu, const char* previous_extension_name) -> std::string {
+        std::string extension_name;
+        for (int i = 0; i < 100; ++i) {
+            extension_name = get_extension_name(gpu);
+            if (extension_name != previous_extension_name) {
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
+        return extension_name;
+    };
+
+    write_profile_file("VK_KHR_maintenance3");
+
+    const char* profile_dirs_data = profile_dirs_path.c_str();
+    const char* profile_name_data = "VP_LUNARG_test_hot_reload";
+    VkBool32 profile_hot_reload_data = VK_TRUE;
+    VkBool32 emulate_portability_data = VK_FALSE;
+    const std::vector<const char*> simulate_capabilities = {"SIMULATE_EXTENSIONS_BIT"};
+
+    std::vector<VkLayerSettingEXT> settings = {
+        {kLayerName, kLayerSettingsProfileDirs, VK_LAYER_SETTING_TYPE_STRING_EXT, 1, &profile_dirs_data},
+        {kLayerName, kLayerSettingsProfileName, VK_LAYER_SETTING_TYPE_STRING_EXT, 1, &profile_name_data},
+        {kLayerName, kLayerSettingsProfileHotReload, VK_LAYER_SETTING_TYPE_BOOL32_EXT, 1, &profile_hot_reload_data},
+        {kLayerName, kLayerSettingsEmulatePortability, VK_LAYER_SETTING_TYPE_BOOL32_EXT, 1, &emulate_portability_data},
+        {kLayerName, kLayerSettingsSimulateCapabilities, VK_LAYER_SETTING_TYPE_STRING_EXT, static_cast<uint32_t>(simulate_capabilities.size()), &simulate_capabilities[0]}};
+
+    profiles_test::VulkanInstanceBuilder inst_builder;
+    VkResult err = inst_builder.init(settings);
+    ASSERT_EQ(err, VK_SUCCESS);
+
+    VkPhysicalDevice gpu;
+    err = inst_builder.getPhysicalDevice(profiles_test::MODE_PROFILE, &gpu);
+    if (err != VK_SUCCESS) {
+        printf("Profile not supported on device, skipping test.\n");
+    } else {
+        EXPECT_EQ("VK_KHR_maintenance3", get_extension_name(gpu));
+
+        write_profile_file("VK_KHR_maintenance1");
+        EXPECT_EQ("VK_KHR_maintenance1", get_reloaded_extension_name(gpu, "VK_KHR_maintenance3"));
+
+        // A file that fails to parse keeps the previous profiles, and a later valid file is still reloaded
+        {
+            std::ofstream file(profile_file_path, std::ios::trunc);
+            file << "{ \"$schema\": ";
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+        EXPECT_EQ("VK_KHR_maintenance1", get_extension_name(gpu));
+
+        write_profile_file("VK_KHR_maintenance2");
+        EXPECT_EQ("VK_KHR_maintenance2", get_reloaded_extension_name(gpu, "VK_KHR_maintenance1"));
+    }
+
+    inst_builder.reset();
+
+    std::filesystem::remove_all(profile_dirs_path);
+}
+#endif
+
+TEST_F(TestsMechanism, concurrent_queries) {
+    TEST_DESCRIPTION("Test querying the physical device capabilities from multiple threads");
+
+    const char* profile_file_data = JSON_TEST_FILES_PATH "VP_LUNARG_test_capabilities.json";
+    const char* profile_name_data = "VP_LUNARG_test_capabilities_or";
+    VkBool32 emulate_portability_data = VK_TRUE;
+    const std::vector<const char*> simulate_capabilities = {"SIMULATE_MAX_ENUM"};
+
+    std::vector<VkLayerSettingEXT> settings = {
+        {kLayerName, kLayerSettingsProfileFile, VK_LAYER_SETTING_TYPE_STRING_EXT, 1, &profile_file_data},
+        {kLayerName, kLayerSettingsProfileName, VK_LAYER_SETTING_TYPE_STRING_EXT, 1, &profile_name_data},
+        {kLayerName, kLayerSettingsEmulatePortability, VK_LAYER_SETTING_TYPE_BOOL32_EXT, 1, &emulate_portability_data},
+        {kLayerName, kLayerSettingsSimulateCapabilities, VK_LAYER_SETTING_TYPE_STRING_EXT, static_cast<uint32_t>(simulate_capabilities.size()), &simulate_capabilities[0]}};
+
+    profiles_test::VulkanInstanceBuilder inst_builder;
+    VkResult err = inst_builder.init(settings);
+    ASSERT_EQ(err, VK_SUCCESS);
+
+    VkPhysicalDevice gpu;
+    err = inst_builder.getPhysicalDevice(profiles_test::MODE_PROFILE, &gpu);
+    if (err != VK_SUCCESS) {
+        printf("Profile not supported on device, skipping test.\n");
+        return;
+    }
+
+    VkPhysicalDeviceProperties reference_properties{};
+    vkGetPhysicalDeviceProperties(gpu, &reference_properties);
+
+    uint32_t reference_extension_count = 0;
+    vkEnumerateDeviceExtensionProperties(gpu, nullptr, &reference_extension_count, nullptr);
+
+    std::vector<std::thread> threads;
+    std::vector<int> mismatches(8, 0);
+    for (std::size_t i = 0, n = mismatches.size(); i < n; ++i) {
+        threads.emplace_back([&, i]() {
+            for (int j = 0; j < 1000; ++j) {
+                VkPhysicalDeviceProperties properties{};
+                vkGetPhysicalDeviceProperties(gpu, &properties);
+
+                VkPhysicalDeviceFeatures2 features{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2};
+                vkGetPhysicalDeviceFeatures2(gpu, &features);
+
+                VkFormatProperties format_properties{};
+                vkGetPhysicalDeviceFormatProperties(gpu, VK_FORMAT_R8G8B8A8_UNORM, &format_properties);
+
+                uint32_t extension_count = 0;
+                vkEnumerateDeviceExtensionProperties(gpu, nullptr, &extension_count, nullptr);
+
+                if (properties.limits.maxImageDimension2D != reference_properties.limits.maxImageDimension2D ||
+                    properties.apiVersion != reference_properties.apiVersion || extension_count != reference_extension_count) {
+                    ++mismatches[i];
+                }
+            }
+        });
+    }
+
+    for (std::size_t i = 0, n = threads.size(); i < n; ++i) {
+        threads[i].join();
+    }
+
+    for (std::size_t i = 0, n = mismatches.size(); i < n; ++i) {
+        EXPECT_EQ(0, mismatches[i]);
+    }
+}
+
+TEST_F(TestsMechanism, concurrent_instances) {
+    TEST_DESCRIPTION("Test creating and destroying instances from multiple threads while querying another instance");
+
+    // Set once, the environment can't be modified while the other threads create instances
+    profiles_test::setEnvironmentSetting("VK_LAYER_PATH", TEST_BINARY_PATH);
+
+    const char* profile_file_data = JSON_TEST_FILES_PATH "VP_LUNARG_test_capabilities.json";
+    const char* profile_name_data = "VP_LUNARG_test_capabilities_or";
+    const std::vector<const char*> simulate_capabilities = {"SIMULATE_MAX_ENUM"};
+
+    std::vector<VkLayerSettingEXT> settings = {
+        {kLayerName, kLayerSettingsProfileFile, VK_LAYER_SETTING_TYPE_STRING_EXT, 1, &profile_file_data},
+        {kLayerName, kLayerSettingsProfileName, VK_LAYER_SETTING_TYPE_STRING_EXT, 1, &profile_name_data},
+        {kLayerName, kLayerSettingsSimulateCapabilities, VK_LAYER_SETTING_TYPE_STRING_EXT, static_cast<uint32_t>(simulate_capabilities.size()), &simulate_capabilities[0]}};
+
+    VkLayerSettingsCreateInfoEXT layer_settings_create_info{VK_STRUCTURE_TYPE_LAYER_SETTINGS_CREATE_INFO_EXT, nullptr,
+                                                            static_cast<uint32_t>(settings.size()), &settings[0]};
+
+    std::vector<const char*> layer_names = {kLayerName};
+    std::vector<const char*> extension_names = {VK_EXT_LAYER_SETTINGS_EXTENSION_NAME};
+
+    VkApplicationInfo app_info{profiles_test::GetDefaultApplicationInfo()};
+
+    VkInstanceCreateInfo inst_create_info = {};
+    inst_create_info.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+    inst_create_info.pNext = &layer_settings_create_info;
+#ifdef __APPLE__
+    extension_names.push_back(VK_KHR_PORTABILITY_ENUMERATION_EXTENSION_NAME);
+    inst_create_info.flags |= VK_INSTANCE_CREATE_ENUMERATE_PORTABILITY_BIT_KHR;
+#endif
+    inst_create_info.pApplicationInfo = &app_info;
+    inst_create_info.enabledLayerCount = static_cast<uint32_t>(layer_names.size());
+    inst_create_info.ppEnabledLayerNames = layer_names.data();
+    inst_create_info.enabledExtensionCount = static_cast<uint32_t>(extension_names.size());
+    inst_create_info.ppEnabledExtensionNames = extension_names.data();
+
+    // Query an instance while the other instances are created and destroyed
+    VkInstance queried_instance = VK_NULL_HANDLE;
+    VkResult err = vkCreateInstance(&inst_create_info, nullptr, &queried_instance);
+    ASSERT_EQ(err, VK_SUCCESS);
+
+    uint32_t queried_gpu_count = 1;
+    VkPhysicalDevice queried_gpu = VK_NULL_HANDLE;
+    err = vkEnumeratePhysicalDevices(queried_instance, &queried_gpu_count, &queried_gpu);
+    ASSERT_TRUE(err == VK_SUCCESS || err == VK_INCOMPLETE);
+
+    VkPhysicalDeviceProperties queried_properties{};
+    if (queried_gpu != VK_NULL_HANDLE) {
+        vkGetPhysicalDeviceProperties(queried_gpu, &queried_properties);
+    }
+
+    std::atomic<bool> running{true};
+    int query_mismatches = 0;
+    std::thread query_thread([&]() {
+        while (queried_gpu != VK_NULL_HANDLE && running) {
+            VkPhysicalDeviceProperties properties{};
+            vkGetPhysicalDeviceProperties(queried_gpu, &properties);
+            if (properties.apiVersion != queried_properties.apiVersion) {
+                ++query_mismatches;
+            }
+        }
+    });
+
+    std::vector<std::thread> threads;
+    std::vector<VkResult> results(8, VK_SUCCESS);
+    for (std::size_t i = 0, n = results.size(); i < n; ++i) {
+        threads.emplace_back([&, i]() {
+            for (int j = 0; j < 20 && results[i] == VK_SUCCESS; ++j) {
+                VkInstance instance = VK_NULL_HANDLE;
+                results[i] = vkCreateInstance(&inst_create_info, nullptr, &instance);
+                if (results[i] != VK_SUCCESS) {
+                    break;
+                }
+
+                uint32_t gpu_count = 0;
+                results[i] = vkEnumeratePhysicalDevices(instance, &gpu_count, nullptr);
+                std::vector<VkPhysicalDevice> gpus(gpu_count);
+                if (results[i] == VK_SUCCESS && gpu_count > 0) {
+                    results[i] = vkEnumeratePhysicalDevices(instance, &gpu_count, gpus.data());
+                }
+
+                for (std::size_t k = 0, m = gpus.size(); k < m && results[i] == VK_SUCCESS; ++k) {
+                    VkPhysicalDeviceProperties properties{};
+                    vkGetPhysicalDeviceProperties(gpus[k], &properties);
+                }
+
+                vkDestroyInstance(instance, nullptr);
+            }
+        });
+    }
+
+    for (std::size_t i = 0, n = threads.size(); i < n; ++i) {
+        threads[i].join();
+    }
+
+    running = false;
+    query_thread.join();
+    vkDestroyInstance(queried_instance, nullptr);
+
+    for (std::size_t i = 0, n = results.size(); i < n; ++i) {
+        EXPECT_EQ(VK_SUCCESS, results[i]);
+    }
+    EXPECT_EQ(0, query_mismatches);
+}
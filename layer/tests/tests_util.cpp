@@ -21,6 +21,20 @@
 
 #include <gtest/gtest.h>
 #include "profiles_test_helper.h"
+#include "../profiles_queue_families.h"
+#include "../profiles_util.h"
+#include "../profiles_async_log.h"
+
+#include <json/json.h>
+
+#include <cstdio>
+#include <limits>
+#include <sstream>
+#include <thread>
+
+#if !defined(_WIN32)
+#include <unistd.h>
+#endif
 
 TEST(TestsUtil, DebugAction) {
     std::vector<std::string> strings = GetDebugActionStrings(DEBUG_ACTION_MAX_ENUM);
@@ -29,6 +43,7 @@ TEST(TestsUtil, DebugAction) {
     EXPECT_STREQ("DEBUG_ACTION_STDOUT_BIT", strings[1].c_str());
     EXPECT_STREQ("DEBUG_ACTION_OUTPUT_BIT", strings[2].c_str());
     EXPECT_STREQ("DEBUG_ACTION_BREAKPOINT_BIT", strings[3].c_str());
+    EXPECT_STREQ("DEBUG_ACTION_MISMATCH_FILE_BIT", strings[4].c_str());
 
     DebugActionFlags flags = GetDebugActionFlags(strings);
 
@@ -36,6 +51,47 @@ TEST(TestsUtil, DebugAction) {
     EXPECT_TRUE(flags & DEBUG_ACTION_STDOUT_BIT);
     EXPECT_TRUE(flags & DEBUG_ACTION_OUTPUT_BIT);
     EXPECT_TRUE(flags & DEBUG_ACTION_BREAKPOINT_BIT);
+    EXPECT_TRUE(flags & DEBUG_ACTION_MISMATCH_FILE_BIT);
+}
+
+TEST(TestsUtil, JsonValue) {
+    EXPECT_STREQ("true", GetJsonValue(true).c_str());
+    EXPECT_STREQ("false", GetJsonValue(false).c_str());
+    EXPECT_STREQ("16384", GetJsonValue(16384u).c_str());
+    EXPECT_STREQ("-8", GetJsonValue(-8).c_str());
+    EXPECT_STREQ("18446744073709551615", GetJsonValue(UINT64_MAX).c_str());
+    EXPECT_STREQ("0.125", GetJsonValue(0.125f).c_str());
+    EXPECT_STREQ("0.1", GetJsonValue(0.1f).c_str());
+    EXPECT_STREQ("-256", GetJsonValue(-256.0f).c_str());
+    EXPECT_STREQ("null", GetJsonValue(std::numeric_limits<float>::quiet_NaN()).c_str());
+    EXPECT_STREQ("null", GetJsonValue(std::numeric_limits<float>::infinity()).c_str());
+    EXPECT_STREQ("null", GetJsonValue(-std::numeric_limits<float>::infinity()).c_str());
+}
+
+TEST(TestsUtil, MismatchRecord) {
+    const std::string record = FormatMismatchRecord("GPU \"0\"\\\t\x01", "VkPhysicalDeviceLimits", "maxSamplerLodBias", "greater", true,
+                                                    GetJsonValue(15.5f), GetJsonValue(std::numeric_limits<float>::infinity()));
+    ASSERT_FALSE(record.empty());
+    EXPECT_EQ('\n', record.back());
+    EXPECT_EQ(record.size() - 1, record.find('\n'));  // A single line
+
+    Json::CharReaderBuilder builder;
+    builder["strictRoot"] = true;
+    builder["allowSpecialFloats"] = false;
+    std::unique_ptr<Json::CharReader> reader(builder.newCharReader());
+
+    Json::Value root;
+    std::string errors;
+    ASSERT_TRUE(reader->parse(record.data(), record.data() + record.size() - 1, &root, &errors)) << errors;
+    ASSERT_TRUE(root.isObject());
+    EXPECT_EQ(7, root.size());
+    EXPECT_STREQ("GPU \"0\"\\\t\x01", root["device"].asCString());
+    EXPECT_STREQ("VkPhysicalDeviceLimits", root["struct"].asCString());
+    EXPECT_STREQ("maxSamplerLodBias", root["member"].asCString());
+    EXPECT_STREQ("greater", root["comparison"].asCString());
+    EXPECT_TRUE(root["modifiable"].asBool());
+    EXPECT_EQ(15.5, root["profile_value"].asDouble());
+    EXPECT_TRUE(root["device_value"].isNull());
 }
 
 static std::vector<std::string> GetDebugReportStrings(DebugReportFlags flags) {
@@ -139,3 +195,263 @@ TEST(TestsUtil, DefaultFeatureValues) {
 
     EXPECT_EQ(DEFAULT_FEATURE_VALUES_DEVICE, GetDefaultFeatureValues("POUET"));
 }
+
+TEST(TestsUtil, AssignQueueFamilies) {
+    // Device queue family 0 supports both profile queue families, 1 only the first one
+    QueueFamilyMatrix matrix(3, 2);
+    matrix.Set(0, 0, true);
+    matrix.Set(0, 1, true);
+    matrix.Set(1, 0, true);
+
+    std::vector<std::size_t> assignment;
+    EXPECT_TRUE(AssignQueueFamilies(matrix, &assignment));
+    ASSERT_EQ(3, assignment.size());
+    EXPECT_EQ(1, assignment[0]);
+    EXPECT_EQ(0, assignment[1]);
+    EXPECT_EQ(2, assignment[2]);
+
+    // Both profile queue families only match the same device queue family
+    QueueFamilyMatrix conflict(3, 2);
+    conflict.Set(1, 0, true);
+    conflict.Set(1, 1, true);
+    EXPECT_FALSE(AssignQueueFamilies(conflict, &assignment));
+}
+
+TEST(TestsUtil, AssignQueueFamilies16) {
+    // Each profile queue family matches a single device queue family, in the reverse order, which is the last permutation
+    const std::size_t count = 16;
+    QueueFamilyMatrix matrix(count, count);
+    for (std::size_t i = 0; i < count; ++i) {
+        matrix.Set(i, count - 1 - i, true);
+    }
+
+    std::vector<std::size_t> assignment;
+    EXPECT_TRUE(AssignQueueFamilies(matrix, &assignment));
+    ASSERT_EQ(count, assignment.size());
+    for (std::size_t i = 0; i < count; ++i) {
+        EXPECT_EQ(count - 1 - i, assignment[i]);
+    }
+
+    matrix.Set(count - 1, 0, false);
+    EXPECT_FALSE(AssignQueueFamilies(matrix, &assignment));
+}
+
+TEST(TestsUtil, HandleRegistry) {
+    HandleRegistry<uint64_t, const int> registry;
+    EXPECT_FALSE(registry.Find(1));
+
+    registry.Insert(1, std::make_shared<const int>(10));
+    registry.Insert(2, std::make_shared<const int>(20));
+
+    std::shared_ptr<const int> object = std::make_shared<const int>(30);
+    std::weak_ptr<const int> released = object;
+    registry.Insert(3, std::move(object));
+    EXPECT_EQ(0, registry.retired_count());
+
+    {
+        // A replaced or removed object remains valid while it is referenced
+        const auto replaced = registry.Find(3);
+        ASSERT_TRUE(replaced);
+        registry.Insert(3, std::make_shared<const int>(31));
+        EXPECT_EQ(30, *replaced);
+        EXPECT_EQ(31, *registry.Find(3));
+        registry.Erase(3);
+        EXPECT_FALSE(registry.Find(3));
+        EXPECT_EQ(30, *replaced);
+        EXPECT_EQ(20, *registry.Find(2));
+        EXPECT_EQ(2, registry.retired_count());
+        EXPECT_FALSE(released.expired());
+    }
+
+    // Released with the last reference
+    EXPECT_EQ(0, registry.retired_count());
+    EXPECT_TRUE(released.expired());
+
+    // Released by the modification when no lookup is in flight
+    object = std::make_shared<const int>(40);
+    released = object;
+    registry.Insert(4, std::move(object));
+    registry.Erase(4);
+    EXPECT_EQ(0, registry.retired_count());
+    EXPECT_TRUE(released.expired());
+
+    registry.Erase(1);
+    registry.Erase(2);
+    EXPECT_FALSE(registry.Find(2));
+    EXPECT_EQ(0, registry.retired_count());
+
+    // Lookups of a handle concurrent with the replacements of its object and the insertions of other handles
+    registry.Insert(1, std::make_shared<const int>(0));
+    std::atomic<bool> stop{false};
+    std::atomic<int> failures{0};
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; ++i) {
+        threads.emplace_back([&]() {
+            int previous = 0;
+            while (!stop) {
+                const auto value = registry.Find(1);
+                if (!value || *value < previous) {
+                    ++failures;
+                    break;
+                }
+                previous = *value;
+            }
+        });
+    }
+    for (int i = 1; i < 1000; ++i) {
+        registry.Insert(1, std::make_shared<const int>(i));
+        registry.Insert(static_cast<uint64_t>(i) + 1, std::make_shared<const int>(i));
+        registry.Erase(static_cast<uint64_t>(i) + 1);
+    }
+    stop = true;
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(0, failures);
+    EXPECT_EQ(999, *registry.Find(1));
+    EXPECT_EQ(0, registry.retired_count());
+}
+
+static std::string ReadFileContent(FILE *file) {
+    std::string content;
+    std::rewind(file);
+    char buffer[4096];
+    for (std::size_t size = 0; (size = std::fread(buffer, 1, sizeof(buffer), file)) > 0;) {
+        content.append(buffer, size);
+    }
+    return content;
+}
+
+TEST(TestsUtil, AsyncLogWriterConcurrentPush) {
+    FILE *file = std::tmpfile();
+    ASSERT_NE(nullptr, file);
+
+    const int thread_count = 8;
+    const int message_count = 100;
+    std::vector<std::vector<int>> accepted(thread_count);
+    {
+        AsyncLogWriter writer(false, file);
+
+        std::vector<std::thread> threads;
+        for (int t = 0; t < thread_count; ++t) {
+            threads.emplace_back([&, t]() {
+                for (int i = 0; i < message_count; ++i) {
+                    const std::string message = std::to_string(t) + " " + std::to_string(i) + "\n";
+                    if (writer.Push(message.c_str())) {
+                        accepted[t].push_back(i);
+                    }
+                }
+            });
+        }
+        for (std::thread &thread : threads) {
+            thread.join();
+        }
+
+        std::size_t accepted_count = 0;
+        for (const std::vector<int> &messages : accepted) {
+            accepted_count += messages.size();
+        }
+        EXPECT_EQ(static_cast<uint64_t>(thread_count * message_count), accepted_count + writer.dropped());
+
+        // Once flushed, the accepted messages of each thread are all written, in their push order
+        writer.Flush();
+
+        std::vector<std::vector<int>> written(thread_count);
+        std::istringstream content(ReadFileContent(file));
+        int t = 0;
+        int i = 0;
+        while (content >> t >> i) {
+            ASSERT_GE(t, 0);
+            ASSERT_LT(t, thread_count);
+            written[t].push_back(i);
+        }
+        EXPECT_EQ(accepted, written);
+    }
+
+    std::fclose(file);
+}
+
+TEST(TestsUtil, AsyncLogWriterFlush) {
+    FILE *file = std::tmpfile();
+    ASSERT_NE(nullptr, file);
+
+    {
+        AsyncLogWriter writer(false, file);
+
+        EXPECT_TRUE(writer.Push("first\n"));
+        writer.Flush();
+        EXPECT_EQ("first\n", ReadFileContent(file));
+
+        EXPECT_TRUE(writer.Push("second\n"));
+        EXPECT_TRUE(writer.Push("third\n"));
+        writer.Flush();
+        EXPECT_EQ("first\nsecond\nthird\n", ReadFileContent(file));
+    }
+
+    std::fclose(file);
+}
+
+TEST(TestsUtil, AsyncLogWriterShutdown) {
+    FILE *file = std::tmpfile();
+    ASSERT_NE(nullptr, file);
+
+    // The pending messages are written by the destructor, without Flush()
+    std::string expected;
+    {
+        AsyncLogWriter writer(false, file);
+        for (int i = 0; i < 100; ++i) {
+            const std::string message = std::to_string(i) + "\n";
+            if (writer.Push(message.c_str())) {
+                expected += message;
+            }
+        }
+    }
+    EXPECT_EQ(expected, ReadFileContent(file));
+
+    std::fclose(file);
+}
+
+#if !defined(_WIN32)
+TEST(TestsUtil, AsyncLogWriterOverflow) {
+    int fds[2] = {-1, -1};
+    ASSERT_EQ(0, pipe(fds));
+    FILE *file = fdopen(fds[1], "w");
+    ASSERT_NE(nullptr, file);
+
+    const std::string message = std::string(1000, 'x') + "\n";
+    std::size_t accepted = 0;
+    std::size_t rejected = 0;
+
+    std::string received;
+    std::thread reader;
+    {
+        AsyncLogWriter writer(false, file);
+
+        // Nothing reads the pipe yet: once it is full, the writer thread blocks and the ring buffer fills up
+        for (int i = 0; i < 100000 && rejected < 10; ++i) {
+            if (writer.Push(message.c_str())) {
+                ++accepted;
+            } else {
+                ++rejected;
+            }
+        }
+        EXPECT_EQ(10u, rejected);
+        EXPECT_EQ(rejected, writer.dropped());
+
+        reader = std::thread([&]() {
+            char buffer[4096];
+            for (ssize_t size = 0; (size = read(fds[0], buffer, sizeof(buffer))) > 0;) {
+                received.append(buffer, static_cast<std::size_t>(size));
+            }
+        });
+
+        writer.Flush();
+    }
+
+    std::fclose(file);
+    reader.join();
+    close(fds[0]);
+
+    EXPECT_EQ(accepted * message.size(), received.size());
+}
+#endif
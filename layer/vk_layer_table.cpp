@@ -19,30 +19,234 @@
  * Author: Tobin Ehlis <tobin@lunarg.com>
  */
 #include <assert.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
 #include <sstream>
 #include <iomanip>
 #include <unordered_map>
+#include <vector>
 #include <vulkan/utility/vk_dispatch_table.h>
 #include "vulkan/vk_layer.h"
 #include "vk_layer_table.h"
-static device_table_map tableMap;
-static instance_table_map tableInstanceMap;
+
+/* Dispatch key to dispatch table registry, the lookups are lock-free so that the layer entry points don't need a lock to find
+ * the next layer. The registry is an open addressed table of atomic slots, the insertions and removals are serialized.
+ * A slot key is never cleared: a removed table leaves its key in the slot with a null table, so that the probe sequences of the
+ * other keys are preserved, and the slot is reused by the next insertion. The slots are rehashed into a new array, without the
+ * removed keys, when the used slots reach half of the capacity.
+ *
+ * A lookup in flight may still read a replaced slot array or a removed table, so they are retired and only released by a
+ * later insertion or removal once no lookup is in flight. The lookups are counted on counters shared by a subset of the
+ * threads. The table of an object is only removed once the object is destroyed, so no call of the object still uses it. */
+template <typename T>
+class DispatchTableRegistry {
+   public:
+    DispatchTableRegistry() : current_(new Slots(kMinCapacity)) { slots_.store(current_.get(), std::memory_order_relaxed); }
+
+    ~DispatchTableRegistry() {
+        for (std::size_t i = 0; i < current_->capacity; ++i) {
+            delete current_->slots[i].table.load(std::memory_order_relaxed);
+        }
+    }
+
+    T *Find(dispatch_key key) const {
+        ReaderCount &reader = readers_[ReaderShard()];
+        reader.count.fetch_add(1, std::memory_order_seq_cst);
+
+        const Slots *slots = slots_.load(std::memory_order_seq_cst);
+        T *table = nullptr;
+        for (std::size_t i = Hash(key, slots->capacity), probe = 0; probe < slots->capacity;
+             i = (i + 1) & (slots->capacity - 1), ++probe) {
+            const dispatch_key slot_key = slots->slots[i].key.load(std::memory_order_acquire);
+            if (slot_key == key) {
+                table = slots->slots[i].table.load(std::memory_order_acquire);
+                break;
+            } else if (slot_key == nullptr) {
+                break;
+            }
+        }
+
+        reader.count.fetch_sub(1, std::memory_order_release);
+        return table;
+    }
+
+    // Insert a new table for the key, or return nullptr if the key already has a table
+    T *Insert(dispatch_key key) {
+        std::lock_guard<std::mutex> lock(write_lock_);
+
+        Slot *slot = FindInsertSlot(key);
+        if (slot == nullptr) {
+            return nullptr;
+        }
+
+        if (slot->key.load(std::memory_order_relaxed) == nullptr && (used_count_ + 1) * 2 > current_->capacity) {
+            // Twice the live tables, so that the rehashed slots are at most a quarter used
+            Rehash(std::max(kMinCapacity, NextPowerOfTwo((table_count_ + 1) * 4)));
+            slot = FindInsertSlot(key);
+        }
+
+        if (slot->key.load(std::memory_order_relaxed) == nullptr) {
+            ++used_count_;
+        }
+        ++table_count_;
+
+        T *table = new T{};
+        slot->table.store(table, std::memory_order_release);
+        slot->key.store(key, std::memory_order_release);
+
+        ReleaseRetired();
+        return table;
+    }
+
+    void Erase(dispatch_key key) {
+        std::lock_guard<std::mutex> lock(write_lock_);
+
+        const std::size_t capacity = current_->capacity;
+        for (std::size_t i = Hash(key, capacity), probe = 0; probe < capacity; i = (i + 1) & (capacity - 1), ++probe) {
+            Slot &slot = current_->slots[i];
+            const dispatch_key slot_key = slot.key.load(std::memory_order_relaxed);
+            if (slot_key == key) {
+                T *table = slot.table.exchange(nullptr, std::memory_order_acq_rel);
+                if (table != nullptr) {
+                    retired_tables_.emplace_back(table);
+                    --table_count_;
+                }
+                break;
+            } else if (slot_key == nullptr) {
+                break;
+            }
+        }
+
+        ReleaseRetired();
+    }
+
+   private:
+    static constexpr std::size_t kMinCapacity = 64;  // A power of two
+    static const std::size_t kReaderShardCount = 16;
+
+    static std::size_t Hash(dispatch_key key, std::size_t capacity) {
+        // Dispatch keys are pointers to the loader dispatch tables, drop the alignment bits and mix the remaining bits
+        const std::uint64_t value = static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(key) >> 4);
+        return static_cast<std::size_t>((value * 0x9E3779B97F4A7C15ull) >> 32) & (capacity - 1);
+    }
+
+    static std::size_t NextPowerOfTwo(std::size_t value) {
+        std::size_t result = 1;
+        while (result < value) {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    static std::size_t ReaderShard() {
+        static std::atomic<std::size_t> next_shard{0};
+        static thread_local const std::size_t shard = next_shard.fetch_add(1, std::memory_order_relaxed) % kReaderShardCount;
+        return shard;
+    }
+
+    struct Slot {
+        std::atomic<dispatch_key> key{nullptr};
+        std::atomic<T *> table{nullptr};
+    };
+
+    struct Slots {
+        explicit Slots(std::size_t capacity) : capacity(capacity), slots(new Slot[capacity]) {}
+
+        const std::size_t capacity;
+        std::unique_ptr<Slot[]> slots;
+    };
+
+    // Lookups in flight of the threads of a shard, on its own cache line so that threads of other shards don't contend on it
+    struct alignas(64) ReaderCount {
+        std::atomic<uint32_t> count{0};
+    };
+
+    // Slot of the key, or the first free slot of its probe sequence. Returns nullptr if the key already has a table.
+    Slot *FindInsertSlot(dispatch_key key) {
+        Slot *free_slot = nullptr;
+        const std::size_t capacity = current_->capacity;
+        for (std::size_t i = Hash(key, capacity), probe = 0; probe < capacity; i = (i + 1) & (capacity - 1), ++probe) {
+            Slot &slot = current_->slots[i];
+            const dispatch_key slot_key = slot.key.load(std::memory_order_relaxed);
+            if (slot_key == key) {
+                return slot.table.load(std::memory_order_relaxed) != nullptr ? nullptr : &slot;
+            } else if (slot_key == nullptr) {
+                return free_slot != nullptr ? free_slot : &slot;
+            } else if (free_slot == nullptr && slot.table.load(std::memory_order_relaxed) == nullptr) {
+                free_slot = &slot;
+            }
+        }
+        // The used slots are at most half of the capacity, a probe sequence always reaches an empty slot
+        assert(free_slot != nullptr);
+        return free_slot;
+    }
+
+    // Called with write_lock_ held
+    void Rehash(std::size_t capacity) {
+        std::unique_ptr<Slots> slots(new Slots(capacity));
+        for (std::size_t i = 0; i < current_->capacity; ++i) {
+            T *table = current_->slots[i].table.load(std::memory_order_relaxed);
+            if (table == nullptr) {
+                continue;
+            }
+            const dispatch_key key = current_->slots[i].key.load(std::memory_order_relaxed);
+            std::size_t j = Hash(key, capacity);
+            while (slots->slots[j].key.load(std::memory_order_relaxed) != nullptr) {
+                j = (j + 1) & (capacity - 1);
+            }
+            slots->slots[j].table.store(table, std::memory_order_relaxed);
+            slots->slots[j].key.store(key, std::memory_order_relaxed);
+        }
+
+        slots_.store(slots.get(), std::memory_order_seq_cst);
+        retired_slots_.push_back(std::move(current_));
+        current_ = std::move(slots);
+        used_count_ = table_count_;
+    }
+
+    // Called with write_lock_ held. A lookup that starts after the counters are read finds the published slots, so the
+    // retired slots and tables are unreachable once all the counters are read as zero.
+    void ReleaseRetired() {
+        if (retired_slots_.empty() && retired_tables_.empty()) {
+            return;
+        }
+        for (const ReaderCount &reader : readers_) {
+            if (reader.count.load(std::memory_order_seq_cst) != 0) {
+                return;
+            }
+        }
+        retired_slots_.clear();
+        retired_tables_.clear();
+    }
+
+    std::atomic<const Slots *> slots_{nullptr};
+    std::unique_ptr<Slots> current_;  // Owner of the published slots, guarded by write_lock_
+    std::size_t used_count_ = 0;      // Slots with a key, including the removed tables
+    std::size_t table_count_ = 0;
+    std::vector<std::unique_ptr<Slots>> retired_slots_;
+    std::vector<std::unique_ptr<T>> retired_tables_;
+    mutable ReaderCount readers_[kReaderShardCount];
+    std::mutex write_lock_;
+};
+
+static DispatchTableRegistry<VkuDeviceDispatchTable> device_tables;
+static DispatchTableRegistry<VkuInstanceDispatchTable> instance_tables;
 
 dispatch_key get_dispatch_key(const void *object) { return (dispatch_key) * (VkuDeviceDispatchTable **)object; }
 
-// Map lookup must be thread safe
 VkuDeviceDispatchTable *device_dispatch_table(void *object) {
-    dispatch_key key = get_dispatch_key(object);
-    device_table_map::const_iterator it = tableMap.find((void *)key);
-    assert(it != tableMap.end() && "Not able to find device dispatch entry");
-    return it->second.get();
+    VkuDeviceDispatchTable *table = device_tables.Find(get_dispatch_key(object));
+    assert(table != nullptr && "Not able to find device dispatch entry");
+    return table;
 }
 
 VkuInstanceDispatchTable *instance_dispatch_table(void *object) {
-    dispatch_key key = get_dispatch_key(object);
-    instance_table_map::const_iterator it = tableInstanceMap.find((void *)key);
-    assert(it != tableInstanceMap.end() && "Not able to find instance dispatch entry");
-    return it->second.get();
+    VkuInstanceDispatchTable *table = instance_tables.Find(get_dispatch_key(object));
+    assert(table != nullptr && "Not able to find instance dispatch entry");
+    return table;
 }
 
 void destroy_dispatch_table(device_table_map &map, dispatch_key key) {
@@ -59,9 +263,9 @@ void destroy_dispatch_table(instance_table_map &map, dispatch_key key) {
     }
 }
 
-void destroy_device_dispatch_table(dispatch_key key) { destroy_dispatch_table(tableMap, key); }
+void destroy_device_dispatch_table(dispatch_key key) { device_tables.Erase(key); }
 
-void destroy_instance_dispatch_table(dispatch_key key) { destroy_dispatch_table(tableInstanceMap, key); }
+void destroy_instance_dispatch_table(dispatch_key key) { instance_tables.Erase(key); }
 
 VkuDeviceDispatchTable *get_dispatch_table(device_table_map &map, void *object) {
     dispatch_key key = get_dispatch_key(object);
@@ -102,6 +306,14 @@ VkLayerDeviceCreateInfo *get_chain_info(const VkDeviceCreateInfo *pCreateInfo, V
  *    Device -> CommandBuffer or Queue
  * If use the object themselves as key to map then implies Create entrypoints have to be intercepted
  * and a new key inserted into map */
+static void InitInstanceDispatchTable(VkInstance instance, VkuInstanceDispatchTable *pTable, const PFN_vkGetInstanceProcAddr gpa) {
+    vkuInitInstanceDispatchTable(instance, pTable, gpa);
+
+    // Setup func pointers that are required but not externally exposed.  These won't be added to the instance dispatch table by
+    // default.
+    pTable->GetPhysicalDeviceProcAddr = (PFN_GetPhysicalDeviceProcAddr)gpa(instance, "vk_layerGetPhysicalDeviceProcAddr");
+}
+
 VkuInstanceDispatchTable *initInstanceTable(VkInstance instance, const PFN_vkGetInstanceProcAddr gpa, instance_table_map &map) {
     VkuInstanceDispatchTable *pTable;
     dispatch_key key = get_dispatch_key(instance);
@@ -115,17 +327,22 @@ VkuInstanceDispatchTable *initInstanceTable(VkInstance instance, const PFN_vkGet
         return it->second.get();
     }
 
-    vkuInitInstanceDispatchTable(instance, pTable, gpa);
-
-    // Setup func pointers that are required but not externally exposed.  These won't be added to the instance dispatch table by
-    // default.
-    pTable->GetPhysicalDeviceProcAddr = (PFN_GetPhysicalDeviceProcAddr)gpa(instance, "vk_layerGetPhysicalDeviceProcAddr");
+    InitInstanceDispatchTable(instance, pTable, gpa);
 
     return pTable;
 }
 
 VkuInstanceDispatchTable *initInstanceTable(VkInstance instance, const PFN_vkGetInstanceProcAddr gpa) {
-    return initInstanceTable(instance, gpa, tableInstanceMap);
+    dispatch_key key = get_dispatch_key(instance);
+    VkuInstanceDispatchTable *pTable = instance_tables.Insert(key);
+    if (pTable == nullptr) {
+        return instance_tables.Find(key);
+    }
+
+    // The table is published before being initialized, the instance isn't returned to the application yet
+    InitInstanceDispatchTable(instance, pTable, gpa);
+
+    return pTable;
 }
 
 VkuDeviceDispatchTable *initDeviceTable(VkDevice device, const PFN_vkGetDeviceProcAddr gpa, device_table_map &map) {
@@ -147,7 +364,16 @@ VkuDeviceDispatchTable *initDeviceTable(VkDevice device, const PFN_vkGetDevicePr
 }
 
 VkuDeviceDispatchTable *initDeviceTable(VkDevice device, const PFN_vkGetDeviceProcAddr gpa) {
-    return initDeviceTable(device, gpa, tableMap);
+    dispatch_key key = get_dispatch_key(device);
+    VkuDeviceDispatchTable *pTable = device_tables.Insert(key);
+    if (pTable == nullptr) {
+        return device_tables.Find(key);
+    }
+
+    // The table is published before being initialized, the device isn't returned to the application yet
+    vkuInitDeviceDispatchTable(device, pTable, gpa);
+
+    return pTable;
 }
 
 // Convert integer API version to a string
@@ -74,10 +74,16 @@ DESCRIPTION_HEADER = '''
 INCLUDES_HEADER = '''
 #include "profiles.h"
 #include "profiles_util.h"
+#include "profiles_async_log.h"
 #include "profiles_json.h"
+#include "profiles_queue_families.h"
 #include "profiles_settings.h"
 #include <algorithm>
+#include <array>
+#include <bitset>
 #include <filesystem>
+#include <memory>
+#include <type_traits>
 
 namespace fs = std::filesystem;
 '''
@@ -122,14 +128,98 @@ const uint32_t kDeviceExtensionPropertiesCount = static_cast<uint32_t>(kDeviceEx
 GLOBAL_VARS = '''
 // Global variables //////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-uint32_t requested_version = 0;
 bool device_has_astc_hdr = false;
 bool device_has_astc = false;
 bool device_has_etc2 = false;
 bool device_has_bc = false;
 bool device_has_pvrtc = false;
 
-std::recursive_mutex global_lock;  // Enforce thread-safety for this layer.
+std::recursive_mutex global_lock;  // Serialize the layer state changes, the physical device queries don't take it.
+'''
+
+EXTENSION_SET = '''
+// Set of extensions: the extensions known by the layer are stored as a bitset and a spec version array indexed by ExtensionIndex,
+// the extensions unknown by the layer, exposed by a more recent driver, are stored in an array.
+class ExtensionSet {
+   public:
+    bool Has(ExtensionIndex index) const { return known_[index]; }
+
+    bool Has(const char *extension_name) const {
+        const ExtensionIndex index = GetExtensionIndex(extension_name);
+        if (index != EXTENSION_INDEX_COUNT) {
+            return known_[index];
+        }
+        return FindUnknown(extension_name) != unknown_.end();
+    }
+
+    // Like std::unordered_map::insert(), an extension already in the set is not replaced
+    void Insert(const VkExtensionProperties &extension) {
+        const ExtensionIndex index = GetExtensionIndex(extension.extensionName);
+        if (index != EXTENSION_INDEX_COUNT) {
+            if (!known_[index]) {
+                known_.set(index);
+                spec_versions_[index] = extension.specVersion;
+            }
+        } else if (FindUnknown(extension.extensionName) == unknown_.end()) {
+            unknown_.push_back(extension);
+        }
+    }
+
+    void Erase(const char *extension_name) {
+        const ExtensionIndex index = GetExtensionIndex(extension_name);
+        if (index != EXTENSION_INDEX_COUNT) {
+            known_.reset(index);
+        } else {
+            const auto iter = FindUnknown(extension_name);
+            if (iter != unknown_.end()) {
+                unknown_.erase(iter);
+            }
+        }
+    }
+
+    void Clear() {
+        known_.reset();
+        unknown_.clear();
+    }
+
+    std::size_t Size() const { return known_.count() + unknown_.size(); }
+
+    VkResult Enumerate(uint32_t *pCount, VkExtensionProperties *pProperties) const {
+        assert(pCount);
+        const uint32_t count = static_cast<uint32_t>(Size());
+        if (!pProperties) {
+            *pCount = count;
+            return VK_SUCCESS;
+        }
+
+        const uint32_t copy_count = std::min(*pCount, count);
+        uint32_t written = 0;
+        for (std::size_t i = 0; i < EXTENSION_INDEX_COUNT && written < copy_count; ++i) {
+            if (known_[i]) {
+                strncpy(pProperties[written].extensionName, kExtensionNames[i], VK_MAX_EXTENSION_NAME_SIZE);
+                pProperties[written].specVersion = spec_versions_[i];
+                ++written;
+            }
+        }
+        for (std::size_t i = 0, n = unknown_.size(); i < n && written < copy_count; ++i) {
+            pProperties[written++] = unknown_[i];
+        }
+
+        *pCount = copy_count;
+        return copy_count == count ? VK_SUCCESS : VK_INCOMPLETE;
+    }
+
+   private:
+    std::vector<VkExtensionProperties>::const_iterator FindUnknown(const char *extension_name) const {
+        return std::find_if(unknown_.begin(), unknown_.end(), [extension_name](const VkExtensionProperties &extension) {
+            return strcmp(extension.extensionName, extension_name) == 0;
+        });
+    }
+
+    std::bitset<EXTENSION_INDEX_COUNT> known_;
+    std::array<uint32_t, EXTENSION_INDEX_COUNT> spec_versions_{};
+    std::vector<VkExtensionProperties> unknown_;
+};
 '''
 
 PHYSICAL_DEVICE_DATA_BEGIN = '''
@@ -137,63 +227,85 @@ PHYSICAL_DEVICE_DATA_BEGIN = '''
 
 class PhysicalDeviceData {
    public:
-    // Create a new PDD element during vkCreateInstance(), and preserve in map, indexed by physical_device.
-    static PhysicalDeviceData &Create(VkPhysicalDevice pd, VkInstance instance) {
-        assert(pd != VK_NULL_HANDLE);
+    typedef HandleRegistry<VkPhysicalDevice, const PhysicalDeviceData> Registry;
+
+    // Create a new PDD element during vkEnumeratePhysicalDevices(). The PDD is populated by the caller, then published with Store().
+    static std::shared_ptr<PhysicalDeviceData> Create(VkInstance instance, VkPhysicalDevice pd, ProfileLayerSettings *layer_settings,
+                                                      uint32_t requested_version) {
         assert(instance != VK_NULL_HANDLE);
-        assert(!Find(pd));  // Verify this instance does not already exist.
+        assert(pd != VK_NULL_HANDLE);
+        assert(layer_settings != nullptr);
+
+        return std::make_shared<PhysicalDeviceData>(instance, pd, layer_settings, requested_version);
+    }
+
+    // Publish a populated PDD, replacing the previous PDD of the physical device.
+    static void Store(VkPhysicalDevice pd, std::shared_ptr<const PhysicalDeviceData> pdd) {
+        assert(pd != VK_NULL_HANDLE);
+        assert(pdd != nullptr);
 
-        const auto result = map().emplace(pd, instance);
-        assert(result.second);  // true=insertion, false=replacement
-        auto iter = result.first;
-        PhysicalDeviceData *pdd = &iter->second;
-        assert(Find(pd) == pdd);  // Verify we get the same instance we just inserted.
-        return *pdd;
+        registry().Insert(pd, std::move(pdd));
     }
 
     static void Destroy(const VkPhysicalDevice pd) {
-        map().erase(pd);
+        registry().Erase(pd);
+    }
+
+    // Find a PDD without taking the global lock, or an empty reference if doesn't exist. A PDD replaced by a hot reload
+    // remains valid while the reference is held.
+    static Registry::Ref Find(VkPhysicalDevice pd) {
+        return registry().Find(pd);
     }
 
-    // Find a PDD from our map, or nullptr if doesn't exist.
-    static PhysicalDeviceData *Find(VkPhysicalDevice pd) {
-        const auto iter = map().find(pd);
-        return (iter != map().end()) ? &iter->second : nullptr;
+    static bool HasExtension(const PhysicalDeviceData *pdd, ExtensionIndex extension) {
+        return pdd->device_extensions_.Has(extension);
     }
 
-    static bool HasExtension(PhysicalDeviceData *pdd, const char *extension_name) {
-        return pdd->device_extensions_.count(extension_name) > 0;
+    static bool HasExtension(const PhysicalDeviceData *pdd, const char *extension_name) {
+        return pdd->device_extensions_.Has(extension_name);
     }
 
     static bool HasSimulatedExtension(VkPhysicalDevice pd, const char *extension_name) {
-        return HasSimulatedExtension(Find(pd), extension_name);
+        return HasSimulatedExtension(Find(pd).get(), extension_name);
+    }
+
+    static bool HasSimulatedExtension(const PhysicalDeviceData *pdd, ExtensionIndex extension) {
+        return pdd->simulation_extensions_.Has(extension);
     }
 
-    static bool HasSimulatedExtension(PhysicalDeviceData *pdd, const char *extension_name) {
-        return pdd->simulation_extensions_.count(extension_name) > 0;
+    static bool HasSimulatedExtension(const PhysicalDeviceData *pdd, const char *extension_name) {
+        return pdd->simulation_extensions_.Has(extension_name);
     }
 
     static bool HasSimulatedOrRealExtension(VkPhysicalDevice pd, const char *extension_name) {
-        return HasSimulatedOrRealExtension(Find(pd), extension_name);
+        return HasSimulatedOrRealExtension(Find(pd).get(), extension_name);
+    }
+
+    static bool HasSimulatedOrRealExtension(const PhysicalDeviceData *pdd, ExtensionIndex extension) {
+        return HasSimulatedExtension(pdd, extension) || HasExtension(pdd, extension);
     }
 
-    static bool HasSimulatedOrRealExtension(PhysicalDeviceData *pdd, const char *extension_name) {
+    static bool HasSimulatedOrRealExtension(const PhysicalDeviceData *pdd, const char *extension_name) {
         return HasSimulatedExtension(pdd, extension_name) || HasExtension(pdd, extension_name);
     }
 
-    uint32_t GetEffectiveVersion() {
-        return requested_version < physical_device_properties_.apiVersion ? requested_version
-                                                                          : physical_device_properties_.apiVersion;
+    uint32_t GetEffectiveVersion() const {
+        return requested_version_ < physical_device_properties_.apiVersion ? requested_version_
+                                                                           : physical_device_properties_.apiVersion;
 
     }
 
     VkInstance instance() const { return instance_; }
 
-    MapOfVkExtensionProperties device_extensions_;
+    VkPhysicalDevice physical_device() const { return physical_device_; }
+
+    ProfileLayerSettings *layer_settings() const { return layer_settings_; }
+
+    ExtensionSet device_extensions_;
     MapOfVkFormatProperties device_formats_;
     MapOfVkFormatProperties3 device_formats_3_;
     ArrayOfVkQueueFamilyProperties device_queue_family_properties_;
-    MapOfVkExtensionProperties simulation_extensions_;
+    ExtensionSet simulation_extensions_;
     VkPhysicalDeviceProperties physical_device_properties_;
     VkPhysicalDeviceFeatures physical_device_features_;
     VkPhysicalDeviceMemoryProperties physical_device_memory_properties_;
@@ -201,9 +313,32 @@ class PhysicalDeviceData {
     VkSurfaceCapabilitiesKHR surface_capabilities_;
     MapOfVkFormatProperties map_of_format_properties_;
     MapOfVkFormatProperties3 map_of_format_properties_3_;
-    MapOfVkExtensionProperties map_of_extension_properties_;
+    ExtensionSet map_of_extension_properties_;
+    ArrayOfVkExtensionProperties enumerated_extensions_;  // Sorted by name, returned by vkEnumerateDeviceExtensionProperties
+    std::vector<bool> exposed_pnext_structs_;  // Indexed by GetPNextStructIndex(), set by InitExposedPNextStructs()
     ArrayOfVkQueueFamilyProperties arrayof_queue_family_properties_;
 
+    // Simulated properties of each format, loaded on the first query of the format
+    struct FormatTableEntry {
+        std::once_flag loaded;
+        VkFormatProperties properties{};
+        VkFormatProperties3 properties_3{};
+        bool excluded{false};
+        bool simulating_unsupported_features{false};
+    };
+    mutable std::vector<FormatTableEntry> format_table_;  // Indexed by GetFormatIndex(), sized by InitFormatTable()
+    std::vector<VkFormat> excluded_formats_;
+
+    // Thread safe, returns nullptr for a format unknown by the layer
+    const FormatTableEntry *GetFormatTableEntry(VkFormat format) const;
+
+    // Query the device format properties only for the formats used by the profile
+    void LoadDeviceFormat(VkFormat format);
+    void QueryDeviceFormat(VkFormat format, VkFormatProperties *properties, VkFormatProperties3 *properties_3) const;
+
+    // Results of vkGetPhysicalDeviceImageFormatProperties, a reloaded profile creates a new PhysicalDeviceData and cache
+    mutable ImageFormatCache image_format_cache_;
+
     bool vulkan_1_1_properties_written_;
     bool vulkan_1_2_properties_written_;
     bool vulkan_1_3_properties_written_;
@@ -214,7 +349,8 @@ class PhysicalDeviceData {
 '''
 
 PHYSICAL_DEVICE_DATA_CONSTRUCTOR_BEGIN = '''
-    PhysicalDeviceData(VkInstance instance) : instance_(instance) {
+    PhysicalDeviceData(VkInstance instance, VkPhysicalDevice pd, ProfileLayerSettings *layer_settings, uint32_t requested_version)
+        : instance_(instance), physical_device_(pd), layer_settings_(layer_settings), requested_version_(requested_version) {
         physical_device_properties_ = {};
         physical_device_features_ = {};
         physical_device_memory_properties_ = {};
@@ -234,12 +370,16 @@ PHYSICAL_DEVICE_DATA_END = '''    }
     PhysicalDeviceData &operator=(const PhysicalDeviceData &) = delete;
   private:
 
+    void LoadFormatTableEntry(VkFormat format, FormatTableEntry *entry) const;
+
     const VkInstance instance_;
+    const VkPhysicalDevice physical_device_;
+    ProfileLayerSettings *const layer_settings_;
+    const uint32_t requested_version_;
 
-    typedef std::unordered_map<VkPhysicalDevice, PhysicalDeviceData> Map;
-    static Map& map() {
-        static Map map_;
-        return map_;
+    static Registry &registry() {
+        static Registry registry_;
+        return registry_;
     }
 };
 
@@ -250,9 +390,14 @@ JSON_LOADER_BEGIN = '''
 
 class JsonLoader {
    public:
+    typedef HandleRegistry<VkInstance, JsonLoader> Registry;
+
     JsonLoader()
         : layer_settings{},
+          requested_version(0),
           pdd_(nullptr),
+          struct_name_(""),
+          default_profile_file_(profiles_files_.end()),
           profile_api_version_(0),
           excluded_extensions_(),
           excluded_formats_()
@@ -260,50 +405,86 @@ class JsonLoader {
     JsonLoader(const JsonLoader &) = delete;
     JsonLoader &operator=(const JsonLoader &rhs) = delete;
 
-    static JsonLoader &Create() {
-        VkInstance temporary = VK_NULL_HANDLE;
-        const auto result = profile_map().emplace(std::piecewise_construct, std::make_tuple(temporary), std::make_tuple());
-        assert(result.second);  // true=insertion, false=replacement
-        auto iter = result.first;
-        JsonLoader *profile = &iter->second;
-        return *profile;
+    // Create a JsonLoader during vkCreateInstance(), owned by the caller until the instance is created and it is stored.
+    static std::shared_ptr<JsonLoader> Create() {
+        return std::make_shared<JsonLoader>();
     }
 
-    static void Store(VkInstance instance) {
-        auto nh = profile_map().extract(VK_NULL_HANDLE);
-        nh.key() = instance;
-        profile_map().insert(std::move(nh));
+    static void Store(VkInstance instance, std::shared_ptr<JsonLoader> json_loader) {
+        assert(instance != VK_NULL_HANDLE);
+        registry().Insert(instance, std::move(json_loader));
     }
 
-    static JsonLoader *Find(VkInstance instance) {
-        const auto iter = profile_map().find(instance);
-        return (iter != profile_map().end()) ? &iter->second : nullptr;
+    static Registry::Ref Find(VkInstance instance) {
+        return registry().Find(instance);
     }
 
     static void Destroy(VkInstance instance) {
-        profile_map().erase(instance);
+        registry().Erase(instance);
     }
 
     void LogFoundProfiles();
-    const Json::Value& FindRootFromProfileName(const std::string& profile_name) const;
+    const Json::Value& FindRootFromProfileName(const std::string& profile_name);
     VkResult LoadProfilesDatabase();
     VkResult LoadFile(const std::string& filename);
     void ReadProfileApiVersion();
     VkResult LoadDevice(const char* device_name, PhysicalDeviceData *pdd);
     VkResult ReadProfile(const char* device_name, const Json::Value& root, const std::vector<std::vector<std::string>> &capabilities, bool requested_profile, bool enable_warnings);
     uint32_t GetProfileApiVersion() const { return profile_api_version_; }
-    void CollectProfiles(const std::string& profile_name, std::vector<std::string>& results) const;
+    void CollectProfiles(const std::string& profile_name, std::vector<std::string>& results);
+    void WatchProfiles(VkInstance instance);
+    void StopWatchingProfiles();
+    static void ReloadProfiles(VkInstance instance);
 
     ProfileLayerSettings layer_settings;
+    uint32_t requested_version;
 
    private:
     PhysicalDeviceData *pdd_;
+    const char *struct_name_;  // Structure loaded by GetStruct, for the mismatch records
+
+    // Profile files are indexed by LoadProfilesDatabase and only parsed when one of their profiles is used
+    struct ProfileFile {
+        std::vector<std::string> profiles;
+        Json::Value root;
+        bool parsed{false};
+    };
+
+    typedef std::map<std::string, ProfileFile> ProfileFiles;
+    ProfileFiles profiles_files_;
+
+    // Profile name to the first file, in file path order, providing the profile
+    std::unordered_map<std::string, ProfileFiles::iterator> profiles_index_;
+    ProfileFiles::iterator default_profile_file_;
+
+    // Device independent part of the requested profile and its required profiles, resolved once for all the physical devices
+    struct ResolvedProfile {
+        std::string name;
+        const Json::Value *root{nullptr};
+        std::vector<std::vector<std::string>> capabilities;
+        bool valid_schema{false};
+        VkResult schema_result{VK_SUCCESS};
+    };
 
-    std::map<std::string, Json::Value> profiles_file_roots_;
+    std::vector<ResolvedProfile> resolved_profiles_;
+    bool profiles_resolved_{false};
 
     std::uint32_t profile_api_version_;
     std::vector<std::string> excluded_extensions_;
     std::vector<std::string> excluded_formats_;
+    std::unique_ptr<FileWatcher> profiles_watcher_;
+
+    // Profile files and the state derived from them, set aside by ReloadProfiles until the modified files are loaded
+    struct ProfilesState {
+        ProfileFiles files;
+        std::vector<ResolvedProfile> resolved_profiles;
+        bool profiles_resolved{false};
+        std::uint32_t profile_api_version{0};
+        std::vector<std::string> excluded_extensions;
+        std::vector<std::string> excluded_formats;
+    };
+
+    void SwapProfilesState(ProfilesState &state);
 
     struct Extension {
         std::string name;
@@ -328,26 +509,31 @@ class JsonLoader {
     bool GetQueueFamilyProperties(const char* device_name, const Json::Value &qf_props, QueueFamilyProperties *dest);
     bool OrderQueueFamilyProperties(ArrayOfVkQueueFamilyProperties *qfp);
     void AddPromotedExtensions(uint32_t api_level);
+    VkResult AddFile(const std::string& filename, bool indexed, ProfileFileIndex& index, const std::string& errs);
+    VkResult ValidateFiles(const std::vector<std::string>& filenames);
+    VkResult ParseFile(const std::string& filename, ProfileFile& file, const JsonValidator *validator);
+    void BuildProfilesIndex();
+    const std::vector<ResolvedProfile>& ResolveProfiles();
 '''
 
 JSON_LOADER_END = '''
-    typedef std::unordered_map<VkInstance, JsonLoader> ProfileMap;
-    static ProfileMap& profile_map() {
-        static ProfileMap profile_map_;
-        return profile_map_;
+    static Registry &registry() {
+        static Registry registry_;
+        return registry_;
     }
 };
 '''
 
 WARN_FUNCTIONS = '''
-    static bool WarnIfNotEqualFloat(ProfileLayerSettings *layer_settings, bool enable_warnings, const char* device_name, const char *cap_name, const float new_value, const float old_value, const bool not_modifiable) {
+    static bool WarnIfNotEqualFloat(ProfileLayerSettings *layer_settings, bool enable_warnings, const char* device_name, const char *struct_name, const char *cap_name, const float new_value, const float old_value, const bool not_modifiable) {
         if (std::abs(new_value - old_value) > 0.0001f) {
             if (enable_warnings) {
+                LOG_MISMATCH(layer_settings, device_name, struct_name, cap_name, "not_equal", !not_modifiable, new_value, old_value);
                 if (not_modifiable) {
-                    LogMessage(layer_settings, DEBUG_REPORT_WARNING_BIT,
+                    LOG_MESSAGE(layer_settings, DEBUG_REPORT_WARNING_BIT,
                         "'%s' is not modifiable but the profile value (%3.2f) is different from the device (%s) value (%3.2f)\\n", cap_name, new_value, device_name, old_value);
                 } else {
-                    LogMessage(layer_settings, DEBUG_REPORT_WARNING_BIT,
+                    LOG_MESSAGE(layer_settings, DEBUG_REPORT_WARNING_BIT,
                         "'%s' profile value (%3.2f) is different from the device (%s) supported value (%3.2f)\\n", cap_name, new_value, device_name, old_value);
                 }
             }
@@ -356,14 +542,16 @@ WARN_FUNCTIONS = '''
         return false;
     }
 
-    static bool WarnIfNotEqualBool(ProfileLayerSettings *layer_settings, bool enable_warnings, const char* device_name, const char *cap_name, const bool new_value, const bool old_value, const bool not_modifiable) {
+    static bool WarnIfNotEqualBool(ProfileLayerSettings *layer_settings, bool enable_warnings, const char* device_name, const char *struct_name, const char *cap_name, const bool new_value, const bool old_value, const bool not_modifiable) {
         if (new_value != old_value) {
             if (enable_warnings) {
                 if (not_modifiable) {
-                    LogMessage(layer_settings, DEBUG_REPORT_WARNING_BIT,
+                    LOG_MISMATCH(layer_settings, device_name, struct_name, cap_name, "not_equal", !not_modifiable, new_value, old_value);
+                    LOG_MESSAGE(layer_settings, DEBUG_REPORT_WARNING_BIT,
                         "'%s' is not modifiable but the profile value (%s) is different from the device (%s) value (%s)\\n", cap_name, new_value ? "true" : "false", device_name, old_value ? "true" : "false");
                 } else if (new_value) {
-                    LogMessage(layer_settings, DEBUG_REPORT_WARNING_BIT,
+                    LOG_MISMATCH(layer_settings, device_name, struct_name, cap_name, "not_equal", !not_modifiable, new_value, old_value);
+                    LOG_MESSAGE(layer_settings, DEBUG_REPORT_WARNING_BIT,
                         "'%s' profile value is enabled in the profile, but the device (%s) does not support it\\n", cap_name, device_name);
                 }
             }
@@ -372,14 +560,15 @@ WARN_FUNCTIONS = '''
         return false;
     }
 
-    static bool WarnIfNotEqualEnum(ProfileLayerSettings *layer_settings, bool enable_warnings, const char* device_name, const char *cap_name, const uint32_t new_value, const uint32_t old_value, const bool not_modifiable) {
+    static bool WarnIfNotEqualEnum(ProfileLayerSettings *layer_settings, bool enable_warnings, const char* device_name, const char *struct_name, const char *cap_name, const uint32_t new_value, const uint32_t old_value, const bool not_modifiable) {
         if (new_value != old_value) {
             if (enable_warnings) {
+                LOG_MISMATCH(layer_settings, device_name, struct_name, cap_name, "not_equal", !not_modifiable, new_value, old_value);
                 if (not_modifiable) {
-                    LogMessage(layer_settings, DEBUG_REPORT_WARNING_BIT,
+                    LOG_MESSAGE(layer_settings, DEBUG_REPORT_WARNING_BIT,
                         "'%s' is not modifiable but the profile value (%" PRIu32 ") is different from the device (%s) value (%" PRIu32 ")\\n", cap_name, new_value, device_name, old_value);
                 } else {
-                    LogMessage(layer_settings, DEBUG_REPORT_WARNING_BIT,
+                    LOG_MESSAGE(layer_settings, DEBUG_REPORT_WARNING_BIT,
                         "'%s' profile value (%" PRIu32 ") is different from the device (%s) value (%" PRIu32 ")\\n", cap_name, new_value, device_name, old_value);
                 }
             }
@@ -388,14 +577,15 @@ WARN_FUNCTIONS = '''
         return false;
     }
 
-    static bool WarnIfNotEqual(ProfileLayerSettings *layer_settings, bool enable_warnings, const char* device_name, const char *cap_name, const uint32_t new_value, const uint32_t old_value, const bool not_modifiable) {
+    static bool WarnIfNotEqual(ProfileLayerSettings *layer_settings, bool enable_warnings, const char* device_name, const char *struct_name, const char *cap_name, const uint32_t new_value, const uint32_t old_value, const bool not_modifiable) {
         if (new_value != old_value) {
             if (enable_warnings) {
+                LOG_MISMATCH(layer_settings, device_name, struct_name, cap_name, "not_equal", !not_modifiable, new_value, old_value);
                 if (not_modifiable) {
-                    LogMessage(layer_settings, DEBUG_REPORT_WARNING_BIT,
+                    LOG_MESSAGE(layer_settings, DEBUG_REPORT_WARNING_BIT,
                         "'%s' is not modifiable but the profile value (%" PRIu32 ") is different from the device (%s) value (%" PRIu32 ")\\n", cap_name, new_value, device_name, old_value);
                 } else {
-                    LogMessage(layer_settings, DEBUG_REPORT_WARNING_BIT,
+                    LOG_MESSAGE(layer_settings, DEBUG_REPORT_WARNING_BIT,
                         "'%s' profile value (%" PRIu32 ") is different from the device (%s) value (%" PRIu32 ")\\n", cap_name, new_value, device_name, old_value);
                 }
             }
@@ -404,14 +594,15 @@ WARN_FUNCTIONS = '''
         return false;
     }
 
-    static bool WarnIfNotEqual32u(ProfileLayerSettings *layer_settings, bool enable_warnings, const char* device_name, const char *cap_name, const uint32_t new_value, const uint32_t old_value, const bool not_modifiable) {
+    static bool WarnIfNotEqual32u(ProfileLayerSettings *layer_settings, bool enable_warnings, const char* device_name, const char *struct_name, const char *cap_name, const uint32_t new_value, const uint32_t old_value, const bool not_modifiable) {
         if (new_value != old_value) {
             if (enable_warnings) {
+                LOG_MISMATCH(layer_settings, device_name, struct_name, cap_name, "not_equal", !not_modifiable, new_value, old_value);
                 if (not_modifiable) {
-                    LogMessage(layer_settings, DEBUG_REPORT_WARNING_BIT,
+                    LOG_MESSAGE(layer_settings, DEBUG_REPORT_WARNING_BIT,
                         "'%s' is not modifiable but the profile value (%" PRIu32 ") is different from the device (%s) value (%" PRIu32 ")\\n", cap_name, new_value, device_name, old_value);
                 } else {
-                    LogMessage(layer_settings, DEBUG_REPORT_WARNING_BIT,
+                    LOG_MESSAGE(layer_settings, DEBUG_REPORT_WARNING_BIT,
                         "'%s' profile value (%" PRIu32 ") is different from the device (%s) value (%" PRIu32 ")\\n", cap_name, new_value, device_name, old_value);
                 }
             }
@@ -420,14 +611,15 @@ WARN_FUNCTIONS = '''
         return false;
     }
 
-    static bool WarnIfNotEqual(ProfileLayerSettings *layer_settings, bool enable_warnings, const char* device_name, const char *cap_name, const int32_t new_value, const int32_t old_value, const bool not_modifiable) {
+    static bool WarnIfNotEqual(ProfileLayerSettings *layer_settings, bool enable_warnings, const char* device_name, const char *struct_name, const char *cap_name, const int32_t new_value, const int32_t old_value, const bool not_modifiable) {
         if (new_value != old_value) {
             if (enable_warnings) {
+                LOG_MISMATCH(layer_settings, device_name, struct_name, cap_name, "not_equal", !not_modifiable, new_value, old_value);
                 if (not_modifiable) {
-                    LogMessage(layer_settings, DEBUG_REPORT_WARNING_BIT,
+                    LOG_MESSAGE(layer_settings, DEBUG_REPORT_WARNING_BIT,
                         "'%s' is not modifiable but the profile value (%" PRIi32 ") is different from the device (%s) value (%" PRIi32 ")\\n", cap_name, new_value, device_name, old_value);
                 } else {
-                    LogMessage(layer_settings, DEBUG_REPORT_WARNING_BIT,
+                    LOG_MESSAGE(layer_settings, DEBUG_REPORT_WARNING_BIT,
                         "'%s' profile value (%" PRIi32 ") is different from the device (%s) value (%" PRIi32 ")\\n", cap_name, new_value, device_name, old_value);
                 }
             }
@@ -436,14 +628,15 @@ WARN_FUNCTIONS = '''
         return false;
     }
 
-    static bool WarnIfNotEqual64u(ProfileLayerSettings *layer_settings, bool enable_warnings, const char* device_name, const char *cap_name, const uint64_t new_value, const uint64_t old_value, const bool not_modifiable) {
+    static bool WarnIfNotEqual64u(ProfileLayerSettings *layer_settings, bool enable_warnings, const char* device_name, const char *struct_name, const char *cap_name, const uint64_t new_value, const uint64_t old_value, const bool not_modifiable) {
         if (new_value != old_value) {
             if (enable_warnings) {
+                LOG_MISMATCH(layer_settings, device_name, struct_name, cap_name, "not_equal", !not_modifiable, new_value, old_value);
                 if (not_modifiable) {
-                    LogMessage(layer_settings, DEBUG_REPORT_WARNING_BIT,
+                    LOG_MESSAGE(layer_settings, DEBUG_REPORT_WARNING_BIT,
                         "'%s' is not modifiable but the profile value (%" PRIu64 ") is different from the device (%s) value (%" PRIu64 ")\\n", cap_name, new_value, device_name, old_value);
                 } else {
-                    LogMessage(layer_settings, DEBUG_REPORT_WARNING_BIT,
+                    LOG_MESSAGE(layer_settings, DEBUG_REPORT_WARNING_BIT,
                         "'%s' profile value (%" PRIu64 ") is different from the device (%s) value (%" PRIu64 ")\\n", cap_name, new_value, device_name, old_value);
                 }
             }
@@ -452,14 +645,15 @@ WARN_FUNCTIONS = '''
         return false;
     }
 
-    static bool WarnIfNotEquali64(ProfileLayerSettings *layer_settings, bool enable_warnings, const char* device_name, const char *cap_name, const int64_t new_value, const int64_t old_value, const bool not_modifiable) {
+    static bool WarnIfNotEquali64(ProfileLayerSettings *layer_settings, bool enable_warnings, const char* device_name, const char *struct_name, const char *cap_name, const int64_t new_value, const int64_t old_value, const bool not_modifiable) {
         if (new_value != old_value) {
             if (enable_warnings) {
+                LOG_MISMATCH(layer_settings, device_name, struct_name, cap_name, "not_equal", !not_modifiable, new_value, old_value);
                 if (not_modifiable) {
-                    LogMessage(layer_settings, DEBUG_REPORT_WARNING_BIT,
+                    LOG_MESSAGE(layer_settings, DEBUG_REPORT_WARNING_BIT,
                         "'%s' is not modifiable but the profile value (%" PRIi64 ") is different from the device (%s) value (%" PRIi64 ")\\n", cap_name, new_value, device_name, old_value);
                 } else {
-                    LogMessage(layer_settings, DEBUG_REPORT_WARNING_BIT,
+                    LOG_MESSAGE(layer_settings, DEBUG_REPORT_WARNING_BIT,
                         "'%s' profile value (%" PRIi64 ") is different from the device (%s) value (%" PRIi64 ")\\n", cap_name, new_value, device_name, old_value);
                 }
             }
@@ -468,14 +662,15 @@ WARN_FUNCTIONS = '''
         return false;
     }
 
-    static bool WarnIfNotEqualSizet(ProfileLayerSettings *layer_settings, bool enable_warnings, const char* device_name, const char *cap_name, const size_t new_value, const size_t old_value, const bool not_modifiable) {
+    static bool WarnIfNotEqualSizet(ProfileLayerSettings *layer_settings, bool enable_warnings, const char* device_name, const char *struct_name, const char *cap_name, const size_t new_value, const size_t old_value, const bool not_modifiable) {
         if (new_value != old_value) {
             if (enable_warnings) {
+                LOG_MISMATCH(layer_settings, device_name, struct_name, cap_name, "not_equal", !not_modifiable, new_value, old_value);
                 if (not_modifiable) {
-                    LogMessage(layer_settings, DEBUG_REPORT_WARNING_BIT,
+                    LOG_MESSAGE(layer_settings, DEBUG_REPORT_WARNING_BIT,
                         "'%s' is not modifiable but the profile value (%" PRIuLEAST64 ") is different from the device (%s) value (%" PRIuLEAST64 ")\\n", cap_name, new_value, device_name, old_value);
                 } else {
-                    LogMessage(layer_settings, DEBUG_REPORT_WARNING_BIT,
+                    LOG_MESSAGE(layer_settings, DEBUG_REPORT_WARNING_BIT,
                         "'%s' profile value (%" PRIuLEAST64 ") is different from the device (%s) value (%" PRIuLEAST64 ")\\n", cap_name, new_value, device_name, old_value);
                 }
             }
@@ -484,14 +679,15 @@ WARN_FUNCTIONS = '''
         return false;
     }
 
-    static bool WarnIfMissingBit(ProfileLayerSettings *layer_settings, bool enable_warnings, const char* device_name, const char *cap_name, const uint32_t new_value, const uint32_t old_value, const bool not_modifiable) {
+    static bool WarnIfMissingBit(ProfileLayerSettings *layer_settings, bool enable_warnings, const char* device_name, const char *struct_name, const char *cap_name, const uint32_t new_value, const uint32_t old_value, const bool not_modifiable) {
         if ((old_value | new_value) != old_value) {
             if (enable_warnings) {
+                LOG_MISMATCH(layer_settings, device_name, struct_name, cap_name, "missing_bits", !not_modifiable, new_value, old_value);
                 if (not_modifiable) {
-                    LogMessage(layer_settings, DEBUG_REPORT_WARNING_BIT,
+                    LOG_MESSAGE(layer_settings, DEBUG_REPORT_WARNING_BIT,
                         "'%s' is not modifiable but the profile value (%" PRIu32 ") is different from the device (%s) value (%" PRIu32 ")\\n", cap_name, new_value, device_name, old_value);
                 } else {
-                    LogMessage(layer_settings, DEBUG_REPORT_WARNING_BIT,
+                    LOG_MESSAGE(layer_settings, DEBUG_REPORT_WARNING_BIT,
                         "'%s' profile value (%" PRIu32 ") has bits set that the device (%s) value (%" PRIu32 ") does not\\n", cap_name, new_value, device_name, old_value);
                 }
             }
@@ -500,12 +696,11 @@ WARN_FUNCTIONS = '''
         return false;
     }
 
-    static bool WarnIfGreater(ProfileLayerSettings *layer_settings, bool enable_warnings, const char* device_name, const char *cap_name, const uint64_t new_value, const uint64_t old_value, const bool not_modifiable) {
-        (void)not_modifiable;
-
+    static bool WarnIfGreater(ProfileLayerSettings *layer_settings, bool enable_warnings, const char* device_name, const char *struct_name, const char *cap_name, const uint64_t new_value, const uint64_t old_value, const bool not_modifiable) {
         if (new_value > old_value) {
             if (enable_warnings) {
-                LogMessage(layer_settings, DEBUG_REPORT_WARNING_BIT,
+                LOG_MISMATCH(layer_settings, device_name, struct_name, cap_name, "greater", !not_modifiable, new_value, old_value);
+                LOG_MESSAGE(layer_settings, DEBUG_REPORT_WARNING_BIT,
                     "'%s' profile value (%" PRIu64 ") is greater than device (%s) value (%" PRIu64 ")\\n", cap_name, new_value, device_name, old_value);
             }
             return true;
@@ -513,12 +708,11 @@ WARN_FUNCTIONS = '''
         return false;
     }
 
-    static bool WarnIfGreaterSizet(ProfileLayerSettings *layer_settings, bool enable_warnings, const char* device_name, const char *cap_name, const size_t new_value, const size_t old_value, const bool not_modifiable) {
-        (void)not_modifiable;
-
+    static bool WarnIfGreaterSizet(ProfileLayerSettings *layer_settings, bool enable_warnings, const char* device_name, const char *struct_name, const char *cap_name, const size_t new_value, const size_t old_value, const bool not_modifiable) {
         if (new_value > old_value) {
             if (enable_warnings) {
-                LogMessage(layer_settings, DEBUG_REPORT_WARNING_BIT,
+                LOG_MISMATCH(layer_settings, device_name, struct_name, cap_name, "greater", !not_modifiable, new_value, old_value);
+                LOG_MESSAGE(layer_settings, DEBUG_REPORT_WARNING_BIT,
                     "'%s' profile value (%" PRIuLEAST64 ") is greater than device (%s) value (%" PRIuLEAST64 ")\\n", cap_name, new_value, device_name, old_value);
             }
             return true;
@@ -526,12 +720,11 @@ WARN_FUNCTIONS = '''
         return false;
     }
 
-    static bool WarnIfGreaterFloat(ProfileLayerSettings *layer_settings, bool enable_warnings, const char* device_name, const char *cap_name, const float new_value, const float old_value, const bool not_modifiable) {
-        (void)not_modifiable;
-
+    static bool WarnIfGreaterFloat(ProfileLayerSettings *layer_settings, bool enable_warnings, const char* device_name, const char *struct_name, const char *cap_name, const float new_value, const float old_value, const bool not_modifiable) {
         if (new_value > old_value) {
             if (enable_warnings) {
-                LogMessage(layer_settings, DEBUG_REPORT_WARNING_BIT,
+                LOG_MISMATCH(layer_settings, device_name, struct_name, cap_name, "greater", !not_modifiable, new_value, old_value);
+                LOG_MESSAGE(layer_settings, DEBUG_REPORT_WARNING_BIT,
                     "'%s' profile value (%3.2f) is greater than device (%s) value (%3.2f)\\n", cap_name, new_value, device_name, old_value);
             }
             return true;
@@ -539,12 +732,11 @@ WARN_FUNCTIONS = '''
         return false;
     }
 
-    static bool WarnIfLesser(ProfileLayerSettings *layer_settings, bool enable_warnings, const char* device_name, const char *cap_name, const uint64_t new_value, const uint64_t old_value, const bool not_modifiable) {
-        (void)not_modifiable;
-
+    static bool WarnIfLesser(ProfileLayerSettings *layer_settings, bool enable_warnings, const char* device_name, const char *struct_name, const char *cap_name, const uint64_t new_value, const uint64_t old_value, const bool not_modifiable) {
         if (new_value < old_value) {
             if (enable_warnings) {
-                LogMessage(layer_settings, DEBUG_REPORT_WARNING_BIT,
+                LOG_MISMATCH(layer_settings, device_name, struct_name, cap_name, "lesser", !not_modifiable, new_value, old_value);
+                LOG_MESSAGE(layer_settings, DEBUG_REPORT_WARNING_BIT,
                 "'%s' profile value (%" PRIu64 ") is lesser than device (%s) value (%" PRIu64 ")\\n", cap_name, new_value, device_name, old_value);
             }
             return true;
@@ -552,12 +744,11 @@ WARN_FUNCTIONS = '''
         return false;
     }
 
-    static bool WarnIfLesserSizet(ProfileLayerSettings *layer_settings, bool enable_warnings, const char* device_name, const char *cap_name, const size_t new_value, const size_t old_value, const bool not_modifiable) {
-        (void)not_modifiable;
-
+    static bool WarnIfLesserSizet(ProfileLayerSettings *layer_settings, bool enable_warnings, const char* device_name, const char *struct_name, const char *cap_name, const size_t new_value, const size_t old_value, const bool not_modifiable) {
         if (new_value < old_value) {
             if (enable_warnings) {
-                LogMessage(layer_settings, DEBUG_REPORT_WARNING_BIT,
+                LOG_MISMATCH(layer_settings, device_name, struct_name, cap_name, "lesser", !not_modifiable, new_value, old_value);
+                LOG_MESSAGE(layer_settings, DEBUG_REPORT_WARNING_BIT,
                     "'%s' profile value (%" PRIuLEAST64 ") is lesser than device (%s) value (%" PRIuLEAST64 ")\\n", cap_name, new_value, device_name, old_value);
             }
             return true;
@@ -565,12 +756,11 @@ WARN_FUNCTIONS = '''
         return false;
     }
 
-    static bool WarnIfLesserFloat(ProfileLayerSettings *layer_settings, bool enable_warnings, const char* device_name, const char *cap_name, const float new_value, const float old_value, const bool not_modifiable) {
-        (void)not_modifiable;
-
+    static bool WarnIfLesserFloat(ProfileLayerSettings *layer_settings, bool enable_warnings, const char* device_name, const char *struct_name, const char *cap_name, const float new_value, const float old_value, const bool not_modifiable) {
         if (new_value < old_value) {
             if (enable_warnings) {
-                LogMessage(layer_settings, DEBUG_REPORT_WARNING_BIT,
+                LOG_MISMATCH(layer_settings, device_name, struct_name, cap_name, "lesser", !not_modifiable, new_value, old_value);
+                LOG_MESSAGE(layer_settings, DEBUG_REPORT_WARNING_BIT,
                     "'%s' profile value (%3.2f) is lesser than device (%s) value (%3.2f)\\n", cap_name, new_value, device_name, old_value);
             }
             return true;
@@ -580,8 +770,9 @@ WARN_FUNCTIONS = '''
 '''
 
 GET_VALUE_FUNCTIONS = '''
+    template <typename WarnFunc = std::nullptr_t>
     bool GetValue(const char* device_name, const Json::Value &parent, const std::string &member, const char *name, float *dest, bool not_modifiable, bool requested_profile,
-                  std::function<bool(ProfileLayerSettings *, bool, const char *, const char *, float, float, bool)> warn_func = nullptr) {
+                  WarnFunc warn_func = nullptr) {
         if (member != name) {
             return true;
         }
@@ -596,8 +787,8 @@ GET_VALUE_FUNCTIONS = '''
         }
         bool valid = true;
         const float new_value = value.asFloat();
-        if (warn_func) {
-            if (warn_func(&layer_settings, requested_profile, device_name, name, new_value, *dest, not_modifiable)) {
+        if constexpr (!std::is_null_pointer<WarnFunc>::value) {
+            if (warn_func(&layer_settings, requested_profile, device_name, struct_name_, name, new_value, *dest, not_modifiable)) {
                 valid = false;
             }
         }
@@ -608,8 +799,9 @@ GET_VALUE_FUNCTIONS = '''
         return valid;
     }
 
+    template <typename WarnFunc = std::nullptr_t>
     bool GetValue(const char* device_name, const Json::Value &parent, const std::string &member, const char *name, uint8_t *dest, bool not_modifiable, bool requested_profile,
-                  std::function<bool(ProfileLayerSettings *, bool, const char *, const char *, uint8_t, uint8_t, bool)> warn_func = nullptr) {
+                  WarnFunc warn_func = nullptr) {
         if (member != name) {
             return true;
         }
@@ -622,8 +814,8 @@ GET_VALUE_FUNCTIONS = '''
         bool valid = true;
         if (value.isBool()) {
             const bool new_value = value.asBool();
-            if (warn_func) {
-                if (warn_func(&layer_settings, requested_profile, device_name, name, new_value, *dest, not_modifiable)) {
+            if constexpr (!std::is_null_pointer<WarnFunc>::value) {
+                if (warn_func(&layer_settings, requested_profile, device_name, struct_name_, name, new_value, *dest, not_modifiable)) {
                     valid = false;
                 }
             }
@@ -640,8 +832,8 @@ GET_VALUE_FUNCTIONS = '''
             }
         } else if (value.isUInt()) {
             const uint8_t new_value = static_cast<uint8_t>(value.asUInt());
-            if (warn_func) {
-                if (warn_func(&layer_settings, requested_profile, device_name, name, new_value, *dest, not_modifiable)) {
+            if constexpr (!std::is_null_pointer<WarnFunc>::value) {
+                if (warn_func(&layer_settings, requested_profile, device_name, struct_name_, name, new_value, *dest, not_modifiable)) {
                     valid = false;
                 }
             }
@@ -652,8 +844,9 @@ GET_VALUE_FUNCTIONS = '''
         return valid;
     }
 
+    template <typename WarnFunc = std::nullptr_t>
     bool GetValue(const char* device_name, const Json::Value &parent, const std::string &member, const char *name, int32_t *dest, bool not_modifiable, bool requested_profile,
-                  std::function<bool(ProfileLayerSettings *, bool, const char *, const char *, int32_t, int32_t, bool)> warn_func = nullptr) {
+                  WarnFunc warn_func = nullptr) {
         if (member != name) {
             return true;
         }
@@ -668,8 +861,8 @@ GET_VALUE_FUNCTIONS = '''
         }
         bool valid = true;
         const int32_t new_value = value.asInt();
-        if (warn_func) {
-            if (warn_func(&layer_settings, requested_profile, device_name, name, new_value, *dest, not_modifiable)) {
+        if constexpr (!std::is_null_pointer<WarnFunc>::value) {
+            if (warn_func(&layer_settings, requested_profile, device_name, struct_name_, name, new_value, *dest, not_modifiable)) {
                 valid = false;
             }
         }
@@ -680,8 +873,9 @@ GET_VALUE_FUNCTIONS = '''
         return valid;
     }
 
+    template <typename WarnFunc = std::nullptr_t>
     bool GetValue(const char* device_name, const Json::Value &parent, const std::string &member, const char *name, int64_t *dest, bool not_modifiable, bool requested_profile,
-                  std::function<bool(ProfileLayerSettings *, bool, const char *, const char *, int64_t, int64_t, bool)> warn_func = nullptr) {
+                  WarnFunc warn_func = nullptr) {
         if (member != name) {
             return true;
         }
@@ -696,8 +890,8 @@ GET_VALUE_FUNCTIONS = '''
         }
         bool valid = true;
         const int64_t new_value = value.asInt64();
-        if (warn_func) {
-            if (warn_func(&layer_settings, requested_profile, device_name, name, new_value, *dest, not_modifiable)) {
+        if constexpr (!std::is_null_pointer<WarnFunc>::value) {
+            if (warn_func(&layer_settings, requested_profile, device_name, struct_name_, name, new_value, *dest, not_modifiable)) {
                 valid = false;
             }
         }
@@ -708,8 +902,9 @@ GET_VALUE_FUNCTIONS = '''
         return valid;
     }
 
+    template <typename WarnFunc = std::nullptr_t>
     bool GetValue(const char* device_name, const Json::Value &parent, const std::string &member, const char *name, uint32_t *dest, bool not_modifiable, bool requested_profile,
-                  std::function<bool(ProfileLayerSettings *, bool, const char *, const char *, uint32_t, uint32_t, bool)> warn_func = nullptr) {
+                  WarnFunc warn_func = nullptr) {
         if (member != name) {
             return true;
         }
@@ -722,8 +917,8 @@ GET_VALUE_FUNCTIONS = '''
         bool valid = true;
         if (value.isBool()) {
             const bool new_value = value.asBool();
-            if (warn_func) {
-                if (warn_func(&layer_settings, requested_profile, device_name, name, new_value, *dest, not_modifiable)) {
+            if constexpr (!std::is_null_pointer<WarnFunc>::value) {
+                if (warn_func(&layer_settings, requested_profile, device_name, struct_name_, name, new_value, *dest, not_modifiable)) {
                     valid = false;
                 }
             }
@@ -744,8 +939,8 @@ GET_VALUE_FUNCTIONS = '''
             }
         } else if (value.isUInt()) {
             const uint32_t new_value = value.asUInt();
-            if (warn_func) {
-                if (warn_func(&layer_settings, requested_profile, device_name, name, new_value, *dest, not_modifiable)) {
+            if constexpr (!std::is_null_pointer<WarnFunc>::value) {
+                if (warn_func(&layer_settings, requested_profile, device_name, struct_name_, name, new_value, *dest, not_modifiable)) {
                     valid = false;
                 }
             }
@@ -757,8 +952,9 @@ GET_VALUE_FUNCTIONS = '''
         return valid;
     }
 
+    template <typename WarnFunc = std::nullptr_t>
     bool GetValue(const char* device_name, const Json::Value &parent, const std::string &member, const char *name, uint64_t *dest, bool not_modifiable, bool requested_profile,
-                  std::function<bool(ProfileLayerSettings *, bool, const char *, const char *, uint64_t, uint64_t, bool)> warn_func = nullptr) {
+                  WarnFunc warn_func = nullptr) {
         if (member != name) {
             return true;
         }
@@ -773,8 +969,8 @@ GET_VALUE_FUNCTIONS = '''
         }
         bool valid = true;
         const uint64_t new_value = value.asUInt64();
-        if (warn_func) {
-            if (warn_func(&layer_settings, requested_profile, device_name, name, new_value, *dest, not_modifiable)) {
+        if constexpr (!std::is_null_pointer<WarnFunc>::value) {
+            if (warn_func(&layer_settings, requested_profile, device_name, struct_name_, name, new_value, *dest, not_modifiable)) {
                 valid = false;
             }
         }
@@ -785,8 +981,9 @@ GET_VALUE_FUNCTIONS = '''
         return valid;
     }
 
+    template <typename WarnFunc = std::nullptr_t>
     bool GetValue(const char* device_name, const Json::Value &pparent, const std::string &member, const char *name, VkExtent2D *dest, bool not_modifiable, bool requested_profile,
-                  std::function<bool(ProfileLayerSettings *, bool, const char *, const char *, uint32_t, uint32_t, bool)> warn_func = nullptr) {
+                  WarnFunc warn_func = nullptr) {
         if (member != name) {
             return true;
         }
@@ -807,8 +1004,9 @@ GET_VALUE_FUNCTIONS = '''
         return valid;
     }
 
+    template <typename WarnFunc = std::nullptr_t>
     bool GetValue(const char* device_name, const Json::Value &pparent, const std::string &member, const char *name, VkExtent3D *dest, bool not_modifiable, bool requested_profile,
-                  std::function<bool(ProfileLayerSettings *, bool, const char *, const char *, uint32_t, uint32_t, bool)> warn_func = nullptr) {
+                  WarnFunc warn_func = nullptr) {
         if (member != name) {
             return true;
         }
@@ -830,8 +1028,9 @@ GET_VALUE_FUNCTIONS = '''
         return valid;
     }
 
+    template <typename WarnFunc = std::nullptr_t>
     bool GetValueSizet(const char* device_name, const Json::Value &parent, const std::string &member, const char *name, size_t *dest, bool not_modifiable, bool requested_profile,
-                       std::function<bool(ProfileLayerSettings *, bool, const char *, const char *, size_t, size_t, bool)> warn_func = nullptr) {
+                       WarnFunc warn_func = nullptr) {
         if (member != name) {
             return true;
         }
@@ -844,8 +1043,8 @@ GET_VALUE_FUNCTIONS = '''
         bool valid = true;
         if (value.isUInt()) {
             const size_t new_value = value.asUInt();
-            if (warn_func) {
-                if (warn_func(&layer_settings, requested_profile, device_name, name, new_value, *dest, not_modifiable)) {
+            if constexpr (!std::is_null_pointer<WarnFunc>::value) {
+                if (warn_func(&layer_settings, requested_profile, device_name, struct_name_, name, new_value, *dest, not_modifiable)) {
                     valid = false;
                 }
             }
@@ -857,9 +1056,9 @@ GET_VALUE_FUNCTIONS = '''
         return valid;
     }
 
-    template <typename T>  // for Vulkan enum types
+    template <typename T, typename WarnFunc = std::nullptr_t>  // for Vulkan enum types
     bool GetValueFlag(const char* device_name, const Json::Value &parent, const std::string &member, const char *name, T *dest, bool not_modifiable, bool requested_profile,
-                      std::function<bool(ProfileLayerSettings *, bool, const char *, const char *, T, T, bool)> warn_func = nullptr) {
+                      WarnFunc warn_func = nullptr) {
         if (member != name) {
             return true;
         }
@@ -878,7 +1077,7 @@ GET_VALUE_FUNCTIONS = '''
                 }
             }
         }
-        if (WarnIfMissingBit(&layer_settings, requested_profile, device_name, name, new_value, static_cast<uint32_t>(*dest), not_modifiable)) {
+        if (WarnIfMissingBit(&layer_settings, requested_profile, device_name, struct_name_, name, new_value, static_cast<uint32_t>(*dest), not_modifiable)) {
             valid = false;
         }
 
@@ -888,9 +1087,9 @@ GET_VALUE_FUNCTIONS = '''
         return valid;
     }
 
-    template <typename T>  // for Vulkan enum types
+    template <typename T, typename WarnFunc = std::nullptr_t>  // for Vulkan enum types
     bool GetValueEnum(const char* device_name, const Json::Value &parent, const std::string &member, const char *name, T *dest, bool not_modifiable, bool requested_profile,
-                      std::function<bool(ProfileLayerSettings *, bool, const char *, const char *, uint32_t, uint32_t, bool)> warn_func = nullptr) {
+                      WarnFunc warn_func = nullptr) {
         if (member != name) {
             return true;
         }
@@ -905,12 +1104,12 @@ GET_VALUE_FUNCTIONS = '''
         if (value.isString()) {
             new_value = static_cast<T>(VkStringToUint(value.asString()));
         }
-        if (warn_func) {
-            if (warn_func(&layer_settings, requested_profile, device_name, name, new_value, *dest, not_modifiable)) {
+        if constexpr (!std::is_null_pointer<WarnFunc>::value) {
+            if (warn_func(&layer_settings, requested_profile, device_name, struct_name_, name, new_value, *dest, not_modifiable)) {
                 valid = false;
             }
         } else {
-            if (WarnIfNotEqualEnum(&layer_settings, requested_profile, device_name, name, new_value, *dest, not_modifiable)) {
+            if (WarnIfNotEqualEnum(&layer_settings, requested_profile, device_name, struct_name_, name, new_value, *dest, not_modifiable)) {
                 valid = false;
             }
         }
@@ -1104,6 +1303,8 @@ bool JsonLoader::GetFormat(const char *device_name, bool requested_profile, cons
 
     bool valid = true;
 
+    pdd_->LoadDeviceFormat(format);
+
     const VkFormatProperties &device_properties = pdd_->device_formats_[format];
     if (!HasFlags(device_properties.linearTilingFeatures, profile_properties.linearTilingFeatures)) {
         WarnMissingFormatFeatures(&layer_settings, device_name, format_name, "linearTilingFeatures", profile_properties.linearTilingFeatures,
@@ -1143,7 +1344,7 @@ bool JsonLoader::GetFormat(const char *device_name, bool requested_profile, cons
 
 bool JsonLoader::CheckVersionSupport(uint32_t version, const std::string &name) {
     if (pdd_->GetEffectiveVersion() < version) {
-        LogMessage(&layer_settings,
+        LOG_MESSAGE(&layer_settings,
             DEBUG_REPORT_ERROR_BIT,
             "Profile sets %s which is provided by Vulkan version %s, but the current effective API version is %s.\\n",
                      name.c_str(), StringAPIVersion(version).c_str(), StringAPIVersion(pdd_->GetEffectiveVersion()).c_str());
@@ -1155,7 +1356,7 @@ bool JsonLoader::CheckVersionSupport(uint32_t version, const std::string &name)
 JsonLoader::ExtensionSupport JsonLoader::CheckExtensionSupport(const char *extension, const std::string &name) {
     for (const auto &ext : excluded_extensions_) {
         if (ext == extension) {
-            LogMessage(&layer_settings, DEBUG_REPORT_NOTIFICATION_BIT,
+            LOG_MESSAGE(&layer_settings, DEBUG_REPORT_NOTIFICATION_BIT,
                        "Profile requires %s capabilities, but %s is excluded, device values are used.\\n", name.c_str(),
                                 extension);
             return JsonLoader::ExtensionSupport::EXCLUDED;
@@ -1163,7 +1364,7 @@ JsonLoader::ExtensionSupport JsonLoader::CheckExtensionSupport(const char *exten
     }
     if (layer_settings.simulate.capabilities & SIMULATE_EXTENSIONS_BIT) {
         if (!PhysicalDeviceData::HasSimulatedExtension(pdd_, extension)) {
-            LogMessage(&layer_settings, DEBUG_REPORT_ERROR_BIT,
+            LOG_MESSAGE(&layer_settings, DEBUG_REPORT_ERROR_BIT,
                 "Profile requires %s capabilitiess, but %s is not required by the profile, device values are used.\\n",
                          name.c_str(), extension);
             if (layer_settings.log.debug_fail_on_error) {
@@ -1172,7 +1373,7 @@ JsonLoader::ExtensionSupport JsonLoader::CheckExtensionSupport(const char *exten
         }
     } else {
         if (!PhysicalDeviceData::HasExtension(pdd_, extension)) {
-            LogMessage(&layer_settings,
+            LOG_MESSAGE(&layer_settings,
                 DEBUG_REPORT_WARNING_BIT,
                 "Profile requires by %s capabilities, but %s is not supported by the device.\\n", name.c_str(), extension);
         }
@@ -1270,7 +1471,7 @@ bool JsonLoader::GetQueueFamilyProperties(const char* device_name, const Json::V
         supported = true;
         break;
     }
-    if (!supported) {
+    if (!supported && IsLogEnabled(&layer_settings, DEBUG_REPORT_WARNING_BIT)) {
         std::string message =
             format("Device (%s) has no queue family that supports VkQueueFamilyProperties [queueFlags: %s, queueCount: %" PRIu32
                    ", timestampValidBits: %" PRIu32 ", minImageTransferGranularity: [%" PRIu32 ", %" PRIu32 ", %" PRIu32 "]]",
@@ -1310,6 +1511,8 @@ bool JsonLoader::GetQueueFamilyProperties(const char* device_name, const Json::V
         }
         message += ".\\n";
         LogMessage(&layer_settings, DEBUG_REPORT_WARNING_BIT, message.c_str());
+    }
+    if (!supported) {
         valid = false;
     }
 
@@ -1378,44 +1581,42 @@ bool JsonLoader::OrderQueueFamilyProperties(ArrayOfVkQueueFamilyProperties *qfp)
     if (pdd_->device_queue_family_properties_.size() < qfp->size()) {
         return false;
     }
-    // Find all permutations and see if any of them supports profile queue families
-    std::vector<uint32_t> permutations(pdd_->device_queue_family_properties_.size());
-    uint32_t count = static_cast<uint32_t>(permutations.size());
-    for (uint32_t i = 0; i < count; ++i) {
-        permutations[i] = i;
-    }
-    do {
-        bool match = true;
-        for (uint32_t i = 0; i < count; ++i) {
-            if (permutations[i] < qfp->size() &&
-                !QueueFamilyAndExtensionsMatch(pdd_->device_queue_family_properties_[i], (*qfp)[permutations[i]])) {
-                match = false;
-                break;
-            }
+
+    const std::size_t device_count = pdd_->device_queue_family_properties_.size();
+    const std::size_t profile_count = qfp->size();
+
+    QueueFamilyMatrix matrix(device_count, profile_count);
+    for (std::size_t i = 0; i < device_count; ++i) {
+        for (std::size_t j = 0; j < profile_count; ++j) {
+            matrix.Set(i, j, QueueFamilyAndExtensionsMatch(pdd_->device_queue_family_properties_[i], (*qfp)[j]));
         }
-        if (match) {
-            // Empty queue families at the end are not needed
-            while (permutations[count - 1] >= qfp->size()) {
-                --count;
-            }
-            ArrayOfVkQueueFamilyProperties ordered;
-            for (uint32_t i = 0; i < count; ++i) {
-                if (permutations[i] < qfp->size()) {
-                    ordered.push_back((*qfp)[permutations[i]]);
-                } else {
-                    ordered.push_back(QueueFamilyProperties());
-                }
-            }
-            *qfp = ordered;
-            for (uint32_t i = 0; i < count; ++i) {
-                CopyUnsetQueueFamilyProperties(&pdd_->device_queue_family_properties_[i], &(*qfp)[i]);
-            }
-            return true;
+    }
+
+    std::vector<std::size_t> assignment;
+    if (!AssignQueueFamilies(matrix, &assignment)) {
+        LOG_MESSAGE(&layer_settings, DEBUG_REPORT_WARNING_BIT,
+                   "Device supports all individual profile queue families, but not all of them simultaneously.\\n");
+        return false;
+    }
+
+    // Empty queue families at the end are not needed
+    std::size_t count = device_count;
+    while (assignment[count - 1] == profile_count) {
+        --count;
+    }
+    ArrayOfVkQueueFamilyProperties ordered;
+    for (std::size_t i = 0; i < count; ++i) {
+        if (assignment[i] < profile_count) {
+            ordered.push_back((*qfp)[assignment[i]]);
+        } else {
+            ordered.push_back(QueueFamilyProperties());
         }
-    } while (std::next_permutation(permutations.begin(), permutations.end()));
-    LogMessage(&layer_settings, DEBUG_REPORT_WARNING_BIT,
-               "Device supports all individual profile queue families, but not all of them simultaneously.\\n");
-    return false;
+    }
+    *qfp = ordered;
+    for (std::size_t i = 0; i < count; ++i) {
+        CopyUnsetQueueFamilyProperties(&pdd_->device_queue_family_properties_[i], &(*qfp)[i]);
+    }
+    return true;
 }
 '''
 
@@ -1450,7 +1651,7 @@ VkResult JsonLoader::ReadProfile(const char *device_name, const Json::Value& roo
             const auto &properties = cap_definision["properties"];
 
             if (VK_API_VERSION_PATCH(this->profile_api_version_) > VK_API_VERSION_PATCH(pdd_->physical_device_properties_.apiVersion)) {
-                LogMessage(&layer_settings, DEBUG_REPORT_WARNING_BIT,
+                LOG_MESSAGE(&layer_settings, DEBUG_REPORT_WARNING_BIT,
                     "Profile apiVersion (%" PRIu32 ".%" PRIu32 ".%" PRIu32 ") is greater than the device apiVersion (%" PRIu32 ".%" PRIu32 ".%" PRIu32 ").\\n",
                         VK_API_VERSION_MAJOR(this->profile_api_version_),
                         VK_API_VERSION_MINOR(this->profile_api_version_),
@@ -1464,29 +1665,26 @@ VkResult JsonLoader::ReadProfile(const char *device_name, const Json::Value& roo
             if (layer_settings.simulate.capabilities & SIMULATE_EXTENSIONS_BIT) {
                 const auto &extensions = cap_definision["extensions"];
 
-                pdd_->map_of_extension_properties_.reserve(extensions.size());
                 for (const auto &e : extensions.getMemberNames()) {
                     VkExtensionProperties extension;
                     strcpy(extension.extensionName, e.c_str());
                     extension.specVersion = static_cast<uint32_t>(extensions[e].asInt());
 
-                    bool found = pdd_->map_of_extension_properties_.count(e) > 0;
+                    bool found = pdd_->map_of_extension_properties_.Has(e.c_str());
 
                     if (IsInstanceExtension(e.c_str())) {
-                        LogMessage(&layer_settings, DEBUG_REPORT_NOTIFICATION_BIT,
+                        LOG_MESSAGE(&layer_settings, DEBUG_REPORT_NOTIFICATION_BIT,
                             "Required %s extension is an instance extension. The Profiles layer can't override instance extension, the extension is ignored.\\n", e.c_str());
                     }
 
                     if (!found) {
-                        bool supported_on_device = pdd_->device_extensions_.count(e) > 0;
+                        bool supported_on_device = pdd_->device_extensions_.Has(e.c_str());
 
                         if (!supported_on_device) {
                             failed = true;
                         }
-                        pdd_->map_of_extension_properties_.insert({e, extension});
-                        if (!PhysicalDeviceData::HasSimulatedExtension(pdd_, extension.extensionName)) {
-                            pdd_->simulation_extensions_.insert({e, extension});
-                        }
+                        pdd_->map_of_extension_properties_.Insert(extension);
+                        pdd_->simulation_extensions_.Insert(extension);
                     }
                 }
             }
@@ -1574,17 +1772,17 @@ VkResult JsonLoader::ReadProfile(const char *device_name, const Json::Value& roo
 
     if (requested_profile) {
         if (properties_api_version != 0) {
-            LogMessage(&layer_settings, DEBUG_REPORT_NOTIFICATION_BIT,
+            LOG_MESSAGE(&layer_settings, DEBUG_REPORT_NOTIFICATION_BIT,
                 "- VkPhysicalDeviceProperties API version: %" PRIu32 ".%" PRIu32 ".%" PRIu32 ". Using the API version specified by the profile VkPhysicalDeviceProperties structure.\\n",
                 VK_API_VERSION_MAJOR(properties_api_version), VK_API_VERSION_MINOR(properties_api_version), VK_API_VERSION_PATCH(properties_api_version));
         } else if (layer_settings.simulate.capabilities & SIMULATE_API_VERSION_BIT) {
-            LogMessage(&layer_settings, DEBUG_REPORT_NOTIFICATION_BIT,
+            LOG_MESSAGE(&layer_settings, DEBUG_REPORT_NOTIFICATION_BIT,
                 "- VkPhysicalDeviceProperties API version: %" PRIu32 ".%" PRIu32 ".%" PRIu32". Using the API version specified by the profile.\\n",
                 VK_API_VERSION_MAJOR(this->profile_api_version_), VK_API_VERSION_MINOR(this->profile_api_version_), VK_API_VERSION_PATCH(this->profile_api_version_));
 
             pdd_->physical_device_properties_.apiVersion = this->profile_api_version_;
         } else {
-            LogMessage(&layer_settings, DEBUG_REPORT_NOTIFICATION_BIT,
+            LOG_MESSAGE(&layer_settings, DEBUG_REPORT_NOTIFICATION_BIT,
                 "- VkPhysicalDeviceProperties API version: %" PRIu32 ".%" PRIu32 ".%" PRIu32 ". Using the device version.\\n",
                     VK_API_VERSION_MAJOR(pdd_->physical_device_properties_.apiVersion),
                     VK_API_VERSION_MINOR(pdd_->physical_device_properties_.apiVersion),
@@ -1603,57 +1801,149 @@ VkResult JsonLoader::LoadFile(const std::string& filename) {
     if (filename.empty()) {
         return VK_SUCCESS;
     }
-    std::ifstream json_file(filename);
-    if (!json_file) {
-        LogMessage(&layer_settings, DEBUG_REPORT_ERROR_BIT, "Fail to open file \\"%s\\"\\n", filename.c_str());
+
+    ProfileFileIndex index;
+    std::string errs;
+    const bool indexed = IndexProfileFile(filename, &index, &errs);
+
+    VkResult result = AddFile(filename, indexed, index, errs);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+
+    return ValidateFiles({filename});
+}
+
+VkResult JsonLoader::AddFile(const std::string& filename, bool indexed, ProfileFileIndex& index, const std::string& errs) {
+    if (!indexed) {
+        LOG_MESSAGE(&layer_settings, DEBUG_REPORT_ERROR_BIT, "Fail to parse file \\"%s\\" {\\n%s}\\n", filename.c_str(), errs.c_str());
         return VK_SUCCESS;
     }
 
-    Json::Value root = Json::nullValue;
-    Json::CharReaderBuilder builder;
-    std::string errs;
-    bool success = Json::parseFromStream(builder, json_file, &root, &errs);
-    if (!success) {
-        LogMessage(&layer_settings, DEBUG_REPORT_ERROR_BIT, "Fail to parse file \\"%s\\" {\\n%s}\\n", filename.c_str(), errs.c_str());
+    if (index.schema.find("https://schema.khronos.org/vulkan/profiles") == std::string::npos) {
         return VK_SUCCESS;
     }
-    json_file.close();
 
-    if (root.type() != Json::objectValue) {
-        LogMessage(&layer_settings, DEBUG_REPORT_ERROR_BIT, "Json document root is not an object in file \\"%s\\"\\n", filename.c_str());
+    LOG_MESSAGE(&layer_settings, DEBUG_REPORT_NOTIFICATION_BIT, "Loading \\"%s\\"\\n", filename.c_str());
+
+    ProfileFile& file = this->profiles_files_[filename];
+    file.profiles = std::move(index.profiles);
+    file.root = Json::nullValue;
+    file.parsed = false;
+
+    return VK_SUCCESS;
+}
+
+VkResult JsonLoader::ValidateFiles(const std::vector<std::string>& filenames) {
+    if (!layer_settings.simulate.profile_validation) {
         return VK_SUCCESS;
     }
 
-    const Json::Value& schema_node = root["$schema"];
-    if (schema_node == Json::Value::nullSingleton()) {
+    // Schema validation requires the whole document, parse the files immediately
+    std::vector<ProfileFiles::iterator> files;
+    for (const std::string& filename : filenames) {
+        const auto it = this->profiles_files_.find(filename);
+        if (it != this->profiles_files_.end() && !it->second.parsed) {
+            files.push_back(it);
+        }
+    }
+    if (files.empty()) {
         return VK_SUCCESS;
     }
 
-    const std::string &schema = schema_node.asCString();
-    if (schema.find("https://schema.khronos.org/vulkan/profiles") == std::string::npos) {
+    JsonValidator validator;
+    const bool schema_found = validator.Init();
+    if (!schema_found) {
+        LOG_MESSAGE(&layer_settings, DEBUG_REPORT_WARNING_BIT,
+            "%s could not find the profile schema file to validate the profile files. This operation requires the Vulkan SDK to be installed. Skipping profile file validation.",
+            kLayerName);
+    }
+
+    // Each file is parsed and validated independently, only the file entries are written
+    std::vector<VkResult> results(files.size(), VK_SUCCESS);
+    const auto parse = [&](std::size_t i) {
+        results[i] = ParseFile(files[i]->first, files[i]->second, schema_found ? &validator : nullptr);
+    };
+    if (layer_settings.simulate.profile_parallel_loading && files.size() > 1) {
+        ParallelFor(files.size(), parse);
+    } else {
+        for (std::size_t i = 0, n = files.size(); i < n; ++i) {
+            parse(i);
+        }
+    }
+
+    VkResult result = VK_SUCCESS;
+    for (std::size_t i = 0, n = files.size(); i < n; ++i) {
+        if (files[i]->second.root.isNull()) {
+            this->profiles_files_.erase(files[i]);
+        }
+        if (result == VK_SUCCESS) {
+            result = results[i];
+        }
+    }
+
+    return result;
+}
+
+VkResult JsonLoader::ParseFile(const std::string& filename, ProfileFile& file, const JsonValidator *validator) {
+    assert(!file.parsed);
+
+    file.parsed = true;
+
+    const std::string &cache_dir = layer_settings.simulate.profile_cache_dir;
+
+    // Take the stamp before reading the file: if the file changes while it is parsed, the cache entry gets the
+    // stamp of the older version and is discarded by the next load instead of shadowing the new version.
+    ProfileFileStamp stamp = {};
+    const bool use_cache = !cache_dir.empty() && GetProfileFileStamp(filename, &stamp);
+
+    Json::Value root = Json::nullValue;
+    const bool cached = use_cache && LoadProfileCache(cache_dir, filename, stamp, kVersionProfilesImplementation, &root);
+    if (cached) {
+        LOG_MESSAGE(&layer_settings, DEBUG_REPORT_DEBUG_BIT, "Using cached \\"%s\\"\\n", filename.c_str());
+    } else {
+        FileBuffer json_file(filename);
+        if (!json_file.is_open()) {
+            LOG_MESSAGE(&layer_settings, DEBUG_REPORT_ERROR_BIT, "Fail to open file \\"%s\\"\\n", filename.c_str());
+            file.profiles.clear();
+            return VK_SUCCESS;
+        }
+
+        std::string errs;
+        bool success = ParseJson(json_file.data(), json_file.data() + json_file.size(), &root, &errs);
+        if (!success) {
+            LOG_MESSAGE(&layer_settings, DEBUG_REPORT_ERROR_BIT, "Fail to parse file \\"%s\\" {\\n%s}\\n", filename.c_str(), errs.c_str());
+            file.profiles.clear();
+            return VK_SUCCESS;
+        }
+    }
+
+    if (root.type() != Json::objectValue) {
+        LOG_MESSAGE(&layer_settings, DEBUG_REPORT_ERROR_BIT, "Json document root is not an object in file \\"%s\\"\\n", filename.c_str());
+        file.profiles.clear();
         return VK_SUCCESS;
     }
 
-    LogMessage(&layer_settings, DEBUG_REPORT_NOTIFICATION_BIT, "Loading \\"%s\\"\\n", filename.c_str());
+    std::string validation_errors;
+    if (validator != nullptr && !validator->Check(root, &validation_errors)) {
+        LOG_MESSAGE(&layer_settings, DEBUG_REPORT_ERROR_BIT,
+            "%s is not a valid JSON profile file.\\n%s", filename.c_str(), validation_errors.c_str());
+        file.profiles.clear();
+        if (layer_settings.log.debug_fail_on_error) {
+            return VK_ERROR_INITIALIZATION_FAILED;
+        } else {
+            return VK_SUCCESS;
+        }
+    }
 
-    if (layer_settings.simulate.profile_validation) {
-        JsonValidator validator;
-        if (!validator.Init()) {
-            LogMessage(&layer_settings, DEBUG_REPORT_WARNING_BIT,
-                "%s could not find the profile schema file to validate filename. This operation requires the Vulkan SDK to be installed. Skipping profile file validation.",
-                kLayerName, filename.c_str());
-        } else if (!validator.Check(root)) {
-            LogMessage(&layer_settings, DEBUG_REPORT_ERROR_BIT,
-                "%s is not a valid JSON profile file.", filename.c_str());
-            if (layer_settings.log.debug_fail_on_error) {
-                return VK_ERROR_INITIALIZATION_FAILED;
-            } else {
-                return VK_SUCCESS;
-            }
+    if (!cached && use_cache) {
+        if (!StoreProfileCache(cache_dir, filename, stamp, kVersionProfilesImplementation, root)) {
+            LOG_MESSAGE(&layer_settings, DEBUG_REPORT_WARNING_BIT, "Fail to write the \\"%s\\" cache entry in \\"%s\\"\\n",
+                filename.c_str(), cache_dir.c_str());
         }
     }
 
-    this->profiles_file_roots_.insert(std::pair(filename, root));
+    file.root = std::move(root);
 
     return VK_SUCCESS;
 }
@@ -1666,14 +1956,15 @@ VkResult JsonLoader::LoadProfilesDatabase() {
         }
     }
 
+    std::vector<std::string> filenames;
     for (std::size_t i = 0, n = layer_settings.simulate.profile_dirs.size(); i < n; ++i) {
         const std::string& path = layer_settings.simulate.profile_dirs[i];
 
         if (fs::is_regular_file(path)) {
-            this->LoadFile(path);
+            filenames.push_back(path);
             continue;
         }
-        
+
         for (const auto& entry : fs::directory_iterator(path)) {
             if (fs::is_directory(entry.path())) {
                 continue;
@@ -1684,13 +1975,34 @@ VkResult JsonLoader::LoadProfilesDatabase() {
                 continue;
             }
 
-            VkResult result = this->LoadFile(file_path);
-            if (result != VK_SUCCESS) {
-                continue;
-            }
+            filenames.push_back(file_path);
+        }
+    }
+
+    if (layer_settings.simulate.profile_parallel_loading && filenames.size() > 1) {
+        // Index the files concurrently, then add them in their original order so that logging and
+        // duplicated profile names resolution are identical to the sequential loading.
+        std::vector<ProfileFileIndex> indices(filenames.size());
+        std::vector<std::string> errors(filenames.size());
+        std::unique_ptr<bool[]> indexed(new bool[filenames.size()]);
+
+        ParallelFor(filenames.size(), [&](std::size_t i) {
+            indexed[i] = IndexProfileFile(filenames[i], &indices[i], &errors[i]);
+        });
+
+        for (std::size_t i = 0, n = filenames.size(); i < n; ++i) {
+            this->AddFile(filenames[i], indexed[i], indices[i], errors[i]);
+        }
+
+        this->ValidateFiles(filenames);
+    } else {
+        for (const std::string& filename : filenames) {
+            this->LoadFile(filename);
         }
     }
 
+    BuildProfilesIndex();
+
     LogFoundProfiles();
 
     ReadProfileApiVersion();
@@ -1699,59 +2011,87 @@ VkResult JsonLoader::LoadProfilesDatabase() {
 }
 
 void JsonLoader::LogFoundProfiles() {
-    for (const auto& root : this->profiles_file_roots_) {
-        LogMessage(&layer_settings, DEBUG_REPORT_NOTIFICATION_BIT, "Profiles found in \'%s\' file:\\n", root.first.c_str());
-
-        const Json::Value &profiles = root.second["profiles"];
+    for (const auto& file : this->profiles_files_) {
+        LOG_MESSAGE(&layer_settings, DEBUG_REPORT_NOTIFICATION_BIT, "Profiles found in \'%s\' file:\\n", file.first.c_str());
 
-        for (const std::string &profile : profiles.getMemberNames()) {
-            LogMessage(&layer_settings, DEBUG_REPORT_NOTIFICATION_BIT, "- %s\\n", profile.c_str());
+        for (const std::string &profile : file.second.profiles) {
+            LOG_MESSAGE(&layer_settings, DEBUG_REPORT_NOTIFICATION_BIT, "- %s\\n", profile.c_str());
         }
     }
 }
 
-const Json::Value& JsonLoader::FindRootFromProfileName(const std::string& profile_name) const {
-    for (const auto& root : this->profiles_file_roots_) {
-        const Json::Value &profiles = root.second["profiles"];
+void JsonLoader::BuildProfilesIndex() {
+    this->profiles_index_.clear();
+    this->default_profile_file_ = this->profiles_files_.end();
+
+    for (auto it = this->profiles_files_.begin(), end = this->profiles_files_.end(); it != end; ++it) {
+        if (it->second.profiles.empty()) {
+            continue;
+        }
+        if (this->default_profile_file_ == end) {
+            this->default_profile_file_ = it;
+        }
+        for (const std::string &profile : it->second.profiles) {
+            this->profiles_index_.emplace(profile, it);  // The first file providing the profile takes precedence
+        }
+    }
+}
 
-        for (const auto &profile : profiles.getMemberNames()) {
-            if (profile_name.empty() || profile_name == "${VP_DEFAULT}" || profile == profile_name) {
-                return root.second;
+const Json::Value& JsonLoader::FindRootFromProfileName(const std::string& profile_name) {
+    for (;;) {
+        ProfileFiles::iterator file = this->profiles_files_.end();
+        if (profile_name.empty() || profile_name == "${VP_DEFAULT}") {
+            file = this->default_profile_file_;
+        } else {
+            const auto it = this->profiles_index_.find(profile_name);
+            if (it != this->profiles_index_.end()) {
+                file = it->second;
             }
         }
+
+        if (file == this->profiles_files_.end()) {
+            return Json::Value::nullSingleton();
+        }
+
+        if (!file->second.parsed) {
+            ParseFile(file->first, file->second, nullptr);
+        }
+        if (!file->second.root.isNull()) {
+            return file->second.root;
+        }
+
+        // The file failed to parse and its profiles were dropped, search the next files
+        BuildProfilesIndex();
+    }
+}
+
+static const Json::Value& FindProfile(const Json::Value& root, const std::string& profile_name) {
+    const Json::Value &profiles = root["profiles"];
+    if (!profiles.isObject() || profiles.empty()) {
+        return Json::Value::nullSingleton();
+    }
+
+    if (!profile_name.empty() && profile_name != "${VP_DEFAULT}") {
+        const Json::Value *profile = profiles.find(profile_name.data(), profile_name.data() + profile_name.size());
+        if (profile != nullptr) {
+            return *profile;
+        }
     }
 
-    return Json::Value::nullSingleton();
+    return *profiles.begin(); // Systematically load the first and default profile when the profile is not found
 }
 
 void JsonLoader::ReadProfileApiVersion() {
     const std::string &profile_name = layer_settings.simulate.profile_name;
-    const Json::Value &profiles = FindRootFromProfileName(profile_name)["profiles"];
-    bool found_profile = false;
-    for (const auto &profile : profiles.getMemberNames()) {
-        if (profile_name.empty() || profile_name == "${VP_DEFAULT}" || profile == profile_name) {
-            const std::string version_string = profiles[profile]["api-version"].asCString();
-
-            uint32_t api_major = 0;
-            uint32_t api_minor = 0;
-            uint32_t api_patch = 0;
-            std::sscanf(version_string.c_str(), "%u.%u.%u", &api_major, &api_minor, &api_patch);
-            profile_api_version_ = VK_MAKE_API_VERSION(0, api_major, api_minor, api_patch);
-            found_profile = true;
-            break;
-        }
-    }
-    if (!found_profile) {
-        for (const auto &profile : profiles.getMemberNames()) {
-            const std::string version_string = profiles[profile]["api-version"].asCString();
+    const Json::Value &profile = FindProfile(FindRootFromProfileName(profile_name), profile_name);
+    if (profile != Json::Value::nullSingleton()) {
+        const std::string version_string = profile["api-version"].asCString();
 
-            uint32_t api_major = 0;
-            uint32_t api_minor = 0;
-            uint32_t api_patch = 0;
-            std::sscanf(version_string.c_str(), "%u.%u.%u", &api_major, &api_minor, &api_patch);
-            profile_api_version_ = VK_MAKE_API_VERSION(0, api_major, api_minor, api_patch);
-            break; // Systematically load the first and default profile when the profile is not found
-        }
+        uint32_t api_major = 0;
+        uint32_t api_minor = 0;
+        uint32_t api_patch = 0;
+        std::sscanf(version_string.c_str(), "%u.%u.%u", &api_major, &api_minor, &api_patch);
+        profile_api_version_ = VK_MAKE_API_VERSION(0, api_major, api_minor, api_patch);
     }
 
     for (const auto& extension : layer_settings.simulate.exclude_device_extensions) {
@@ -1764,27 +2104,94 @@ void JsonLoader::ReadProfileApiVersion() {
     }
 }
 
-void JsonLoader::CollectProfiles(const std::string& profile_name, std::vector<std::string>& results) const {
+void JsonLoader::CollectProfiles(const std::string& profile_name, std::vector<std::string>& results) {
     const auto &root = FindRootFromProfileName(profile_name);
 
     if (root != Json::Value::nullSingleton()) {
-        const Json::Value &profiles = root["profiles"];
-        std::vector<std::vector<std::string>> capabilities;
+        const Json::Value *profile = root["profiles"].find(profile_name.data(), profile_name.data() + profile_name.size());
+        if (profile != nullptr) {
+            const auto &required_profiles = (*profile)["profiles"];
+
+            for (const auto &required_profile : required_profiles) {
+                this->CollectProfiles(required_profile.asString().c_str(), results);
+            }
+        }
+    }
+
+    results.push_back(profile_name);
+}
 
-        for (const auto &profile : profiles.getMemberNames()) {
-            if (profile == profile_name) {
-                const auto &required_profiles = profiles[profile]["profiles"];
+const std::vector<JsonLoader::ResolvedProfile>& JsonLoader::ResolveProfiles() {
+    if (this->profiles_resolved_) {
+        return this->resolved_profiles_;
+    }
+    this->profiles_resolved_ = true;
 
-                for (const auto &required_profile : required_profiles) {
-                    this->CollectProfiles(required_profile.asString().c_str(), results);
-                }
+    std::vector<std::string> required_profiles;
+    CollectProfiles(layer_settings.simulate.profile_name, required_profiles);
+
+    // LoadDevice stops at the first profile not found or not valid, so the resolution stops there too
+    for (const std::string& profile_name : required_profiles) {
+        this->resolved_profiles_.push_back(ResolvedProfile());
+        ResolvedProfile &resolved = this->resolved_profiles_.back();
+        resolved.name = profile_name;
+
+        const auto& root = FindRootFromProfileName(resolved.name);
+        if (root == Json::Value::nullSingleton()) {
+            break;
+        }
+        resolved.root = &root;
 
-                break;  // load a single profile
+        const auto &caps = FindProfile(root, resolved.name)["capabilities"];
+        for (const auto &cap : caps) {
+            std::vector<std::string> cap_variants;
+            if (cap.isArray()) {
+                for (const auto &cap_variant : cap) {
+                    cap_variants.push_back(cap_variant.asString());
+                }
+            } else {
+                cap_variants.push_back(cap.asString());
             }
+            resolved.capabilities.push_back(cap_variants);
+        }
+
+        if (resolved.capabilities.empty()) {
+            break;
+        }
+
+        const Json::Value schema_value = root["$schema"];
+        if (!schema_value.isString()) {
+            LOG_MESSAGE(&layer_settings, DEBUG_REPORT_ERROR_BIT, "JSON element \\"$schema\\" is not a string\\n");
+            resolved.schema_result = layer_settings.log.debug_fail_on_error ? VK_ERROR_INITIALIZATION_FAILED : VK_SUCCESS;
+            break;
+        }
+
+        const std::string schema = schema_value.asCString();
+        if (schema.find(SCHEMA_URI_BASE) == std::string::npos) {
+            LOG_MESSAGE(&layer_settings, DEBUG_REPORT_ERROR_BIT, "Document schema \\"%s\\" not supported by %s\\n", schema.c_str(), kLayerName);
+            resolved.schema_result = layer_settings.log.debug_fail_on_error ? VK_ERROR_INITIALIZATION_FAILED : VK_SUCCESS;
+            break;
+        }
+
+        const std::size_t size_schema = schema.size();
+        const std::size_t size_base = std::strlen(SCHEMA_URI_BASE);
+        const std::size_t size_version = std::strlen(".json#");
+        const std::string version = schema.substr(size_base, size_schema - size_base - size_version);
+
+        uint32_t version_major = 0;
+        uint32_t version_minor = 0;
+        uint32_t version_patch = 0;
+        std::sscanf(version.c_str(), "%u.%u.%u", &version_major, &version_minor, &version_patch);
+        if (VK_HEADER_VERSION < version_patch) {
+            LOG_MESSAGE(&layer_settings, DEBUG_REPORT_WARNING_BIT,
+                "%s is built against Vulkan Header %d but the profile is written against Vulkan Header %d.\\n\\t- All newer capabilities in the profile will be ignored by the layer.\\n",
+                kLayerName, VK_HEADER_VERSION, version_patch);
         }
+
+        resolved.valid_schema = true;
     }
 
-    results.push_back(profile_name);
+    return this->resolved_profiles_;
 }
 
 VkResult JsonLoader::LoadDevice(const char* device_name, PhysicalDeviceData *pdd) {
@@ -1792,114 +2199,46 @@ VkResult JsonLoader::LoadDevice(const char* device_name, PhysicalDeviceData *pdd
 
     const std::string &requested_profile_name = layer_settings.simulate.profile_name;
 
-    if (this->profiles_file_roots_.empty() && (requested_profile_name.empty() || requested_profile_name == "${VP_DEFAULT}")) {
+    if (this->profiles_files_.empty() && (requested_profile_name.empty() || requested_profile_name == "${VP_DEFAULT}")) {
         return VK_SUCCESS;
     }
 
     VkResult result = VK_SUCCESS;
 
-    std::vector<std::string> required_profiles;
-    CollectProfiles(requested_profile_name, required_profiles);
+    const std::vector<ResolvedProfile> &resolved_profiles = ResolveProfiles();
 
-    for (const std::string& profile_name : required_profiles) {
-        const auto& root = FindRootFromProfileName(profile_name);
+    for (const ResolvedProfile& resolved : resolved_profiles) {
+        const std::string &profile_name = resolved.name;
 
-        if (root == Json::Value::nullSingleton()) {
+        if (resolved.root == nullptr) {
             if (requested_profile_name == profile_name) {
-                LogMessage(&layer_settings, DEBUG_REPORT_ERROR_BIT, "- \'%s\' profile not found.\\n", profile_name.c_str());
+                LOG_MESSAGE(&layer_settings, DEBUG_REPORT_ERROR_BIT, "- \'%s\' profile not found.\\n", profile_name.c_str());
             } else {
-                LogMessage(&layer_settings, DEBUG_REPORT_ERROR_BIT, "- \'%s\' profile required by \'%s\' not found.\\n", profile_name.c_str(), requested_profile_name.c_str());
+                LOG_MESSAGE(&layer_settings, DEBUG_REPORT_ERROR_BIT, "- \'%s\' profile required by \'%s\' not found.\\n", profile_name.c_str(), requested_profile_name.c_str());
             }
 
             result = VK_ERROR_UNKNOWN;
         } else {
             if (requested_profile_name == profile_name) {
-                LogMessage(&layer_settings, DEBUG_REPORT_NOTIFICATION_BIT, "- Overriding device capabilities with the \'%s\' profile capabilities.\\n", profile_name.c_str());
+                LOG_MESSAGE(&layer_settings, DEBUG_REPORT_NOTIFICATION_BIT, "- Overriding device capabilities with the \'%s\' profile capabilities.\\n", profile_name.c_str());
             } else {
-                LogMessage(&layer_settings, DEBUG_REPORT_NOTIFICATION_BIT, "- Overriding device capabilities with the \'%s\' profile capabilities required by the requested \'%s\' profile.\\n", profile_name.c_str(), requested_profile_name.c_str());
-            }
-
-            const Json::Value &profiles = root["profiles"];
-            std::vector<std::vector<std::string>> capabilities;
-
-            bool found_profile = false;
-            for (const auto &profile : profiles.getMemberNames()) {
-                if (profile_name.empty() || profile_name == "${VP_DEFAULT}" || profile == profile_name) {
-                    const auto &caps = profiles[profile]["capabilities"];
-
-                    for (const auto &cap : caps) {
-                        std::vector<std::string> cap_variants;
-                        if (cap.isArray()) {
-                            for (const auto &cap_variant : cap) {
-                                cap_variants.push_back(cap_variant.asString());
-                            }
-                        } else {
-                            cap_variants.push_back(cap.asString());
-                        }
-                        capabilities.push_back(cap_variants);
-                    }
-
-                    found_profile = true;
-                    break;  // load a single profile
-                }
-            }
-            if (!found_profile) {
-                for (const auto &profile : profiles.getMemberNames()) {
-                    const auto &caps = profiles[profile]["capabilities"];
-
-                    for (const auto &cap : caps) {
-                        std::vector<std::string> cap_variants;
-                        if (cap.isArray()) {
-                            for (const auto &cap_variant : cap) {
-                                cap_variants.push_back(cap_variant.asString());
-                            }
-                        } else {
-                            cap_variants.push_back(cap.asString());
-                        }
-                        capabilities.push_back(cap_variants);
-                    }
-
-                    break; // Systematically load the first and default profile
-                }
+                LOG_MESSAGE(&layer_settings, DEBUG_REPORT_NOTIFICATION_BIT, "- Overriding device capabilities with the \'%s\' profile capabilities required by the requested \'%s\' profile.\\n", profile_name.c_str(), requested_profile_name.c_str());
             }
 
-            if (capabilities.empty()) {
+            if (resolved.capabilities.empty()) {
                 return VK_SUCCESS;
             }
 
-            const Json::Value schema_value = root["$schema"];
-            if (!schema_value.isString()) {
-                LogMessage(&layer_settings, DEBUG_REPORT_ERROR_BIT, "JSON element \\"$schema\\" is not a string\\n");
-                return layer_settings.log.debug_fail_on_error ? VK_ERROR_INITIALIZATION_FAILED : VK_SUCCESS;
-            }
-
-            const std::string schema = schema_value.asCString();
-            if (schema.find(SCHEMA_URI_BASE) == std::string::npos) {
-                LogMessage(&layer_settings, DEBUG_REPORT_ERROR_BIT, "Document schema \\"%s\\" not supported by %s\\n", schema.c_str(), kLayerName);
-                return layer_settings.log.debug_fail_on_error ? VK_ERROR_INITIALIZATION_FAILED : VK_SUCCESS;
-            }
-
-            const std::size_t size_schema = schema.size();
-            const std::size_t size_base = std::strlen(SCHEMA_URI_BASE);
-            const std::size_t size_version = std::strlen(".json#");
-            const std::string version = schema.substr(size_base, size_schema - size_base - size_version);
-
-            uint32_t version_major = 0;
-            uint32_t version_minor = 0;
-            uint32_t version_patch = 0;
-            std::sscanf(version.c_str(), "%u.%u.%u", &version_major, &version_minor, &version_patch);
-            if (VK_HEADER_VERSION < version_patch) {
-                LogMessage(&layer_settings, DEBUG_REPORT_WARNING_BIT,
-                    "%s is built against Vulkan Header %d but the profile is written against Vulkan Header %d.\\n\\t- All newer capabilities in the profile will be ignored by the layer.\\n",
-                    kLayerName, VK_HEADER_VERSION, version_patch);
+            if (!resolved.valid_schema) {
+                return resolved.schema_result;
             }
 
             VkResult tmp_result = VK_SUCCESS;
             if (layer_settings.simulate.capabilities & SIMULATE_EXTENSIONS_BIT) {
-                pdd_->simulation_extensions_.clear();
+                pdd_->simulation_extensions_.Clear();
             }
 
-            tmp_result = ReadProfile(device_name, root, capabilities, requested_profile_name == profile_name, required_profiles.size() == 1);
+            tmp_result = ReadProfile(device_name, *resolved.root, resolved.capabilities, requested_profile_name == profile_name, resolved_profiles.size() == 1);
             if (tmp_result != VK_SUCCESS) {
                 result = tmp_result;
             }
@@ -1915,6 +2254,15 @@ VkResult JsonLoader::LoadDevice(const char* device_name, PhysicalDeviceData *pdd
 '''
 
 GET_DEFINES = '''
+// FNV-1a hash of a JSON member name, generated GetFeature, GetProperty and GetStruct switch on it instead of comparing every name
+static constexpr uint32_t HashMemberName(const char *name) {
+    uint32_t result = 2166136261u;
+    for (; *name != '\\0'; ++name) {
+        result = (result ^ static_cast<uint8_t>(*name)) * 16777619u;
+    }
+    return result;
+}
+
 #define GET_VALUE(member, name, not_modifiable, requested_profile) GetValue(device_name, parent, member, #name, &dest->name, not_modifiable, requested_profile)
 #define GET_ARRAY(member, name, not_modifiable) GetArray(device_name, parent, member, #name, dest->name, not_modifiable)
 
@@ -1945,7 +2293,7 @@ GET_UNDEFINE = '''
 INSTANCE_FUNCTIONS = '''
 // Generic layer dispatch table setup, see [LALI].
 static VkResult LayerSetupCreateInstance(const VkInstanceCreateInfo *pCreateInfo, const VkAllocationCallbacks *pAllocator,
-                                         VkInstance *pInstance) {
+                                         VkInstance *pInstance, std::shared_ptr<JsonLoader> json_loader) {
     VkLayerInstanceCreateInfo *chain_info = get_chain_info(pCreateInfo, VK_LAYER_LINK_INFO);
     assert(chain_info->u.pLayerInfo);
 
@@ -1959,34 +2307,37 @@ static VkResult LayerSetupCreateInstance(const VkInstanceCreateInfo *pCreateInfo
     VkResult result = fp_create_instance(pCreateInfo, pAllocator, pInstance);
     if (result == VK_SUCCESS) {
         initInstanceTable(*pInstance, fp_get_instance_proc_addr);
-        JsonLoader::Store(*pInstance);
+        json_loader->WatchProfiles(*pInstance);
+        JsonLoader::Store(*pInstance, std::move(json_loader));
     }
     return result;
 }
 
 VKAPI_ATTR VkResult VKAPI_CALL CreateInstance(const VkInstanceCreateInfo *pCreateInfo, const VkAllocationCallbacks *pAllocator,
                                               VkInstance *pInstance) {
-    JsonLoader &json_loader = JsonLoader::Create();
+    // Each vkCreateInstance() call has its own JsonLoader, only stored in the JsonLoader registry once the instance is created
+    std::shared_ptr<JsonLoader> json_loader = JsonLoader::Create();
 
-    ProfileLayerSettings *layer_settings = &json_loader.layer_settings;
+    ProfileLayerSettings *layer_settings = &json_loader->layer_settings;
 
     InitProfilesLayerSettings(pCreateInfo, pAllocator, layer_settings);
 
-    LogMessage(layer_settings, DEBUG_REPORT_DEBUG_BIT, "CreateInstance\\n");
-    LogMessage(layer_settings, DEBUG_REPORT_DEBUG_BIT, "JsonCpp version %s\\n", JSONCPP_VERSION_STRING);
-    LogMessage(layer_settings, DEBUG_REPORT_NOTIFICATION_BIT, "%s version %d.%d.%d\\n", kLayerName, kVersionProfilesMajor,
+    LOG_MESSAGE(layer_settings, DEBUG_REPORT_DEBUG_BIT, "CreateInstance\\n");
+    LOG_MESSAGE(layer_settings, DEBUG_REPORT_DEBUG_BIT, "JsonCpp version %s\\n", JSONCPP_VERSION_STRING);
+    LOG_MESSAGE(layer_settings, DEBUG_REPORT_NOTIFICATION_BIT, "%s version %d.%d.%d\\n", kLayerName, kVersionProfilesMajor,
                                                        kVersionProfilesMinor, kVersionProfilesPatch);
 
-    VkResult result = json_loader.LoadProfilesDatabase();
+    VkResult result = json_loader->LoadProfilesDatabase();
     if (result != VK_SUCCESS) {
         return result;
     }
 
     const VkApplicationInfo *app_info = pCreateInfo->pApplicationInfo;
+    uint32_t &requested_version = json_loader->requested_version;
     requested_version = (app_info && app_info->apiVersion) ? app_info->apiVersion : VK_API_VERSION_1_0;
     if (VK_API_VERSION_MAJOR(requested_version) > VK_API_VERSION_MAJOR(VK_HEADER_VERSION_COMPLETE) ||
         VK_API_VERSION_MINOR(requested_version) > VK_API_VERSION_MINOR(VK_HEADER_VERSION_COMPLETE)) {
-        LogMessage(layer_settings, DEBUG_REPORT_ERROR_BIT, "The Vulkan application requested a Vulkan %s instance but the %s was build "
+        LOG_MESSAGE(layer_settings, DEBUG_REPORT_ERROR_BIT, "The Vulkan application requested a Vulkan %s instance but the %s was build "
                                                     "against %s. Please, update the layer.\\n",
                                                     StringAPIVersion(requested_version).c_str(), kLayerName,
                                                     StringAPIVersion(VK_HEADER_VERSION_COMPLETE).c_str());
@@ -1998,19 +2349,19 @@ VKAPI_ATTR VkResult VKAPI_CALL CreateInstance(const VkInstanceCreateInfo *pCreat
 
     bool changed_version = false;
     if (!layer_settings->simulate.profile_file.empty() || !layer_settings->simulate.profile_dirs.empty()) {
-        const uint32_t profile_api_version = json_loader.GetProfileApiVersion();
+        const uint32_t profile_api_version = json_loader->GetProfileApiVersion();
         if (VK_API_VERSION_MAJOR(requested_version) < VK_API_VERSION_MAJOR(profile_api_version) ||
             VK_API_VERSION_MINOR(requested_version) < VK_API_VERSION_MINOR(profile_api_version)) {
             if (layer_settings->simulate.capabilities & SIMULATE_API_VERSION_BIT) {
                 if (layer_settings->simulate.profile_name.empty()) {
-                    LogMessage(layer_settings,
+                    LOG_MESSAGE(layer_settings,
                         DEBUG_REPORT_NOTIFICATION_BIT,
                         "The Vulkan application requested a Vulkan %s instance but the selected %s file requires %s. The "
                                  "application requested instance version is overridden to %s.\\n",
                                  StringAPIVersion(requested_version).c_str(), layer_settings->simulate.profile_file.c_str(),
                                  StringAPIVersion(profile_api_version).c_str(), StringAPIVersion(profile_api_version).c_str());
                 } else {
-                    LogMessage(layer_settings,
+                    LOG_MESSAGE(layer_settings,
                         DEBUG_REPORT_NOTIFICATION_BIT,
                         "The Vulkan application requested a Vulkan %s instance but the selected %s profile requires %s. "
                                  "The application requested instance version is overridden to %s.\\n",
@@ -2021,14 +2372,14 @@ VKAPI_ATTR VkResult VKAPI_CALL CreateInstance(const VkInstanceCreateInfo *pCreat
                 changed_version = true;
             } else {
                 if (layer_settings->simulate.profile_name.empty()) {
-                    LogMessage(layer_settings,
+                    LOG_MESSAGE(layer_settings,
                         DEBUG_REPORT_WARNING_BIT,
                         "The Vulkan application requested a Vulkan %s instance but the selected %s file requires %s. The "
                                  "profile may not be initialized correctly which will produce unexpected warning messages.\\n",
                                  StringAPIVersion(requested_version).c_str(), layer_settings->simulate.profile_file.c_str(),
                                  StringAPIVersion(profile_api_version).c_str());
                 } else {
-                    LogMessage(layer_settings,
+                    LOG_MESSAGE(layer_settings,
                         DEBUG_REPORT_WARNING_BIT,
                         "The Vulkan application requested a Vulkan %s instance but the selected %s profile requires %s. "
                                  "The profile may not be initialized correctly which will produce unexpected warning messages.\\n",
@@ -2054,11 +2405,11 @@ VKAPI_ATTR VkResult VKAPI_CALL CreateInstance(const VkInstanceCreateInfo *pCreat
         }
     }
     if (!changed_version && get_physical_device_properties2_active) {
-        return LayerSetupCreateInstance(pCreateInfo, pAllocator, pInstance);
+        return LayerSetupCreateInstance(pCreateInfo, pAllocator, pInstance, std::move(json_loader));
     }
 
     if (!get_physical_device_properties2_active) {
-        LogMessage(layer_settings, DEBUG_REPORT_NOTIFICATION_BIT,
+        LOG_MESSAGE(layer_settings, DEBUG_REPORT_NOTIFICATION_BIT,
                    "The Profiles Layer requires the %s extension, but it was not included in "
                             "VkInstanceCreateInfo::ppEnabledExtensionNames, adding the extension.\\n",
                             VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
@@ -2117,16 +2468,21 @@ VKAPI_ATTR VkResult VKAPI_CALL CreateInstance(const VkInstanceCreateInfo *pCreat
         create_info.enabledExtensionCount = pCreateInfo->enabledExtensionCount;
         create_info.ppEnabledExtensionNames = pCreateInfo->ppEnabledExtensionNames;
     }
-    return LayerSetupCreateInstance(&create_info, pAllocator, pInstance);
+    return LayerSetupCreateInstance(&create_info, pAllocator, pInstance, std::move(json_loader));
 }
 
 VKAPI_ATTR void VKAPI_CALL DestroyInstance(VkInstance instance, const VkAllocationCallbacks *pAllocator) {
     if (instance) {
+        const auto json_loader = JsonLoader::Find(instance);
+
+        // The watcher thread may be waiting for the global lock to reload the profiles, stop it before locking
+        json_loader->StopWatchingProfiles();
+
         std::lock_guard<std::recursive_mutex> lock(global_lock);
 
-        ProfileLayerSettings* layer_settings = &JsonLoader::Find(instance)->layer_settings;
+        ProfileLayerSettings* layer_settings = &json_loader->layer_settings;
 
-        LogMessage(layer_settings, DEBUG_REPORT_DEBUG_BIT, "DestroyInstance\\n");
+        LOG_MESSAGE(layer_settings, DEBUG_REPORT_DEBUG_BIT, "DestroyInstance\\n");
 
         {
             const auto dt = instance_dispatch_table(instance);
@@ -2136,20 +2492,185 @@ VKAPI_ATTR void VKAPI_CALL DestroyInstance(VkInstance instance, const VkAllocati
                 return dt->EnumeratePhysicalDevices(instance, count, results);
             });
             assert(!err);
-            if (!err)
-                for (const auto pd : physical_devices) PhysicalDeviceData::Destroy(pd);
+            if (!err) {
+                for (const auto pd : physical_devices) {
+#if !defined(NDEBUG)
+                    const auto pdd = PhysicalDeviceData::Find(pd);
+                    if (pdd != nullptr) {
+                        LOG_MESSAGE(layer_settings, DEBUG_REPORT_DEBUG_BIT,
+                                   "- Image format properties cache: %" PRIu64 " hits, %" PRIu64 " misses\\n",
+                                   pdd->image_format_cache_.hits(), pdd->image_format_cache_.misses());
+                    }
+#endif
+                    PhysicalDeviceData::Destroy(pd);
+                }
+            }
 
             dt->DestroyInstance(instance, pAllocator);
         }
         destroy_instance_dispatch_table(get_dispatch_key(instance));
 
+        if (layer_settings->log.async_writer) {
+            // Once flushed, the ring buffer has room for the report of the dropped messages
+            LogFlush(layer_settings);
+            const uint64_t dropped = layer_settings->log.async_writer->dropped();
+            if (dropped > 0) {
+                LOG_MESSAGE(layer_settings, DEBUG_REPORT_WARNING_BIT,
+                           "%" PRIu64 " log messages were dropped, the asynchronous log buffer was full.\\n", dropped);
+            }
+        }
+        // Closed now rather than by the JsonLoader destructor, which only runs once no reference to the JsonLoader is held
+        LogClose(layer_settings);
+
         JsonLoader::Destroy(instance);
     }
 }
 '''
 
+PNEXT_STRUCT = '''
+struct PNextStruct {
+    VkStructureType sType;
+    std::size_t size;
+    const void *(*data)(const PhysicalDeviceData *physicalDeviceData);
+    bool (*exposed)(const PhysicalDeviceData *physicalDeviceData);
+};
+'''
+
+FILL_PNEXT_CHAIN = '''
+static const EnumIndex &GetPNextStructIndex() {
+    static const EnumIndex index([]() {
+        std::vector<VkStructureType> types;
+        for (const PNextStruct &pnext_struct : GetPNextStructList()) {
+            types.push_back(pnext_struct.sType);
+        }
+        return types;
+    }());
+    return index;
+}
+
+// The PNextStruct of each sType, indexed by GetPNextStructIndex(). The holes of the index have a zero size.
+static const std::vector<PNextStruct> &GetPNextStructs() {
+    static const std::vector<PNextStruct> structs = []() {
+        const EnumIndex &index = GetPNextStructIndex();
+        std::vector<PNextStruct> table(index.size(), PNextStruct{});
+        for (const PNextStruct &pnext_struct : GetPNextStructList()) {
+            table[index.Find(pnext_struct.sType)] = pnext_struct;
+        }
+        return table;
+    }();
+    return structs;
+}
+
+// Resolve once which structs the simulated device exposes, after the profile is loaded
+static void InitExposedPNextStructs(PhysicalDeviceData &pdd) {
+    const std::vector<PNextStruct> &structs = GetPNextStructs();
+
+    pdd.exposed_pnext_structs_.assign(structs.size(), false);
+    for (std::size_t i = 0, n = structs.size(); i < n; ++i) {
+        if (structs[i].size > 0 && structs[i].exposed(&pdd)) {
+            pdd.exposed_pnext_structs_[i] = true;
+        }
+    }
+}
+
+// Whether FillPNextChain() overrides the whole struct, in which case the driver values are not needed
+static bool IsPNextStructFilled(const PhysicalDeviceData *physicalDeviceData, VkStructureType sType) {
+    // VK_KHR_portability_subset is a special case since it can also be emulated by the Profiles layer.
+    if (sType == VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PORTABILITY_SUBSET_PROPERTIES_KHR) {
+        return PhysicalDeviceData::HasSimulatedExtension(physicalDeviceData, EXTENSION_INDEX_VK_KHR_PORTABILITY_SUBSET) ||
+               physicalDeviceData->layer_settings()->simulate.emulate_portability;
+    }
+
+    const std::size_t i = GetPNextStructIndex().Find(sType);
+    return i < physicalDeviceData->exposed_pnext_structs_.size() && physicalDeviceData->exposed_pnext_structs_[i];
+}
+
+void FillPNextChain(const PhysicalDeviceData *physicalDeviceData, void *place) {
+    ProfileLayerSettings *layer_settings = physicalDeviceData->layer_settings();
+    const EnumIndex &index = GetPNextStructIndex();
+    const std::vector<PNextStruct> &structs = GetPNextStructs();
+
+    while (place) {
+        VkBaseOutStructure *structure = (VkBaseOutStructure *)place;
+        VkBaseOutStructure *pNext = structure->pNext;
+
+        if (IsPNextStructFilled(physicalDeviceData, structure->sType)) {
+            if (structure->sType == VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PORTABILITY_SUBSET_PROPERTIES_KHR) {
+                VkPhysicalDevicePortabilitySubsetPropertiesKHR *psp = (VkPhysicalDevicePortabilitySubsetPropertiesKHR *)place;
+                *psp = physicalDeviceData->physical_device_portability_subset_properties_;
+                if (layer_settings->portability.vertexAttributeAccessBeyondStride) {
+                    psp->minVertexInputBindingStrideAlignment = layer_settings->portability.minVertexInputBindingStrideAlignment;
+                }
+            } else {
+                // Fill the struct with the PhysicalDeviceData values since the simulated device exposes it
+                const std::size_t i = index.Find(structure->sType);
+                memcpy(structure, structs[i].data(physicalDeviceData), structs[i].size);
+            }
+            structure->pNext = pNext;
+        }
+
+        place = pNext;
+    }
+}
+
+// Query from the driver only the structs of the chain that FillPNextChain() doesn't fill, with the chain temporarily trimmed
+// to them. Returns without calling down the chain when the layer fills every struct.
+static void GetUnfilledPhysicalDeviceProperties2(const PhysicalDeviceData *physicalDeviceData, VkPhysicalDevice physicalDevice,
+                                                 VkPhysicalDeviceProperties2 *pProperties) {
+    bool unfilled = false;
+    for (VkBaseOutStructure *structure = (VkBaseOutStructure *)pProperties->pNext; structure; structure = structure->pNext) {
+        if (!IsPNextStructFilled(physicalDeviceData, structure->sType)) {
+            unfilled = true;
+            break;
+        }
+    }
+    if (!unfilled) {
+        return;
+    }
+
+    std::vector<std::pair<VkBaseOutStructure *, VkBaseOutStructure *>> links;  // Unfilled struct and its original pNext
+    VkPhysicalDeviceProperties2 properties = {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2};
+    VkBaseOutStructure *last = nullptr;
+    for (VkBaseOutStructure *structure = (VkBaseOutStructure *)pProperties->pNext; structure;) {
+        VkBaseOutStructure *pNext = structure->pNext;
+        if (!IsPNextStructFilled(physicalDeviceData, structure->sType)) {
+            links.emplace_back(structure, pNext);
+            if (last) {
+                last->pNext = structure;
+            } else {
+                properties.pNext = structure;
+            }
+            last = structure;
+        }
+        structure = pNext;
+    }
+    last->pNext = nullptr;
+
+    const auto dt = instance_dispatch_table(physicalDevice);
+    dt->GetPhysicalDeviceProperties2(physicalDevice, &properties);
+
+    for (const auto &link : links) {
+        link.first->pNext = link.second;
+    }
+}
+'''
+
 FORMAT_PROPERTIES_PNEXT = '''
-void FillFormatPropertiesPNextChain(PhysicalDeviceData *physicalDeviceData, void *place, VkFormat format) {
+// Whether all the structs of a VkFormatProperties2 pNext chain are filled by the layer from the format table
+static bool IsFormatPropertiesPNextChainCached(const void *place) {
+    while (place) {
+        const VkBaseInStructure *structure = (const VkBaseInStructure *)place;
+        if (structure->sType != VK_STRUCTURE_TYPE_FORMAT_PROPERTIES_3) {
+            return false;
+        }
+        place = structure->pNext;
+    }
+    return true;
+}
+
+void FillFormatPropertiesPNextChain(const PhysicalDeviceData *physicalDeviceData, void *place, VkFormat format) {
+    const PhysicalDeviceData::FormatTableEntry *entry = physicalDeviceData->GetFormatTableEntry(format);
+
     while (place) {
         VkBaseOutStructure *structure = (VkBaseOutStructure *)place;
 
@@ -2158,12 +2679,14 @@ void FillFormatPropertiesPNextChain(PhysicalDeviceData *physicalDeviceData, void
 
         switch (structure->sType) {
             case VK_STRUCTURE_TYPE_FORMAT_PROPERTIES_3: {
-                if (!physicalDeviceData->map_of_format_properties_3_.empty()) {
-                    VkFormatProperties3 *sp = (VkFormatProperties3 *)place;
-                    void *pNext = sp->pNext;
-                    *sp = physicalDeviceData->map_of_format_properties_3_[format];
-                    sp->pNext = pNext;
+                VkFormatProperties3 *sp = (VkFormatProperties3 *)place;
+                void *pNext = sp->pNext;
+                if (entry != nullptr) {
+                    *sp = entry->properties_3;
+                } else if (!physicalDeviceData->map_of_format_properties_3_.empty()) {
+                    *sp = VkFormatProperties3{};
                 }
+                sp->pNext = pNext;
             } break;
             default:
                 break;
@@ -2176,10 +2699,9 @@ void FillFormatPropertiesPNextChain(PhysicalDeviceData *physicalDeviceData, void
 
 GET_PHYSICAL_DEVICE_FEATURES_PROPERTIES_FUNCTIONS = '''
 VKAPI_ATTR void VKAPI_CALL GetPhysicalDeviceProperties(VkPhysicalDevice physicalDevice, VkPhysicalDeviceProperties *pProperties) {
-    std::lock_guard<std::recursive_mutex> lock(global_lock);
     const auto dt = instance_dispatch_table(physicalDevice);
 
-    PhysicalDeviceData *pdd = PhysicalDeviceData::Find(physicalDevice);
+    const auto pdd = PhysicalDeviceData::Find(physicalDevice);
     if (pdd) {
         *pProperties = pdd->physical_device_properties_;
     } else {
@@ -2189,12 +2711,16 @@ VKAPI_ATTR void VKAPI_CALL GetPhysicalDeviceProperties(VkPhysicalDevice physical
 
 VKAPI_ATTR void VKAPI_CALL GetPhysicalDeviceProperties2(VkPhysicalDevice physicalDevice,
                                                         VkPhysicalDeviceProperties2KHR *pProperties) {
-    std::lock_guard<std::recursive_mutex> lock(global_lock);
-    const auto dt = instance_dispatch_table(physicalDevice);
-    dt->GetPhysicalDeviceProperties2(physicalDevice, pProperties);
-    GetPhysicalDeviceProperties(physicalDevice, &pProperties->properties);
-    PhysicalDeviceData *pdd = PhysicalDeviceData::Find(physicalDevice);
-    FillPNextChain(pdd, pProperties->pNext);
+    const auto pdd = PhysicalDeviceData::Find(physicalDevice);
+    if (pdd == nullptr) {
+        const auto dt = instance_dispatch_table(physicalDevice);
+        dt->GetPhysicalDeviceProperties2(physicalDevice, pProperties);
+        return;
+    }
+
+    GetUnfilledPhysicalDeviceProperties2(pdd.get(), physicalDevice, pProperties);
+    pProperties->properties = pdd->physical_device_properties_;
+    FillPNextChain(pdd.get(), pProperties->pNext);
 }
 
 VKAPI_ATTR void VKAPI_CALL GetPhysicalDeviceProperties2KHR(VkPhysicalDevice physicalDevice,
@@ -2203,10 +2729,9 @@ VKAPI_ATTR void VKAPI_CALL GetPhysicalDeviceProperties2KHR(VkPhysicalDevice phys
 }
 
 VKAPI_ATTR void VKAPI_CALL GetPhysicalDeviceFeatures(VkPhysicalDevice physicalDevice, VkPhysicalDeviceFeatures *pFeatures) {
-    std::lock_guard<std::recursive_mutex> lock(global_lock);
     const auto dt = instance_dispatch_table(physicalDevice);
 
-    PhysicalDeviceData *pdd = PhysicalDeviceData::Find(physicalDevice);
+    const auto pdd = PhysicalDeviceData::Find(physicalDevice);
     if (pdd) {
         *pFeatures = pdd->physical_device_features_;
     } else {
@@ -2215,12 +2740,11 @@ VKAPI_ATTR void VKAPI_CALL GetPhysicalDeviceFeatures(VkPhysicalDevice physicalDe
 }
 
 VKAPI_ATTR void VKAPI_CALL GetPhysicalDeviceFeatures2(VkPhysicalDevice physicalDevice, VkPhysicalDeviceFeatures2KHR *pFeatures) {
-    std::lock_guard<std::recursive_mutex> lock(global_lock);
     const auto dt = instance_dispatch_table(physicalDevice);
 
-    PhysicalDeviceData *pdd = PhysicalDeviceData::Find(physicalDevice);
+    const auto pdd = PhysicalDeviceData::Find(physicalDevice);
     if (pdd) {
-        FillPNextChain(pdd, pFeatures->pNext);
+        FillPNextChain(pdd.get(), pFeatures->pNext);
     } else {
         dt->GetPhysicalDeviceFeatures2(physicalDevice, pFeatures);
     }
@@ -2250,40 +2774,23 @@ VKAPI_ATTR VkResult VKAPI_CALL EnumerateInstanceExtensionProperties(const char *
 
 VKAPI_ATTR VkResult VKAPI_CALL EnumerateDeviceExtensionProperties(VkPhysicalDevice physicalDevice, const char *pLayerName,
                                                                   uint32_t *pCount, VkExtensionProperties *pProperties) {
-    VkResult result = VK_SUCCESS;
-    std::lock_guard<std::recursive_mutex> lock(global_lock);
     const auto dt = instance_dispatch_table(physicalDevice);
 
-    uint32_t pCount_copy = *pCount;
-
-    PhysicalDeviceData *pdd = PhysicalDeviceData::Find(physicalDevice);
-    ProfileLayerSettings* layer_settings = &JsonLoader::Find(pdd->instance())->layer_settings;
     if (pLayerName) {
-        if (strcmp(pLayerName, kLayerName) == 0)
-            result = EnumerateProperties(kDeviceExtensionPropertiesCount, kDeviceExtensionProperties.data(), pCount, pProperties);
-        else
-            result = dt->EnumerateDeviceExtensionProperties(physicalDevice, pLayerName, pCount, pProperties);
-    } else if (pdd == nullptr || (!(layer_settings->simulate.capabilities & SIMULATE_EXTENSIONS_BIT) &&
-                                  layer_settings->simulate.exclude_device_extensions.empty())) {
-        result = dt->EnumerateDeviceExtensionProperties(physicalDevice, pLayerName, pCount, pProperties);
-    } else {
-        result = EnumerateExtensions(pdd->simulation_extensions_, pCount, pProperties);
-    }
-
-    if (result == VK_SUCCESS && !pLayerName && layer_settings->simulate.emulate_portability &&
-        !PhysicalDeviceData::HasSimulatedOrRealExtension(physicalDevice, VK_KHR_PORTABILITY_SUBSET_EXTENSION_NAME)) {
-        if (pProperties) {
-            if (pCount_copy >= *pCount + 1) {
-                strncpy(pProperties[*pCount].extensionName, VK_KHR_PORTABILITY_SUBSET_EXTENSION_NAME, VK_MAX_EXTENSION_NAME_SIZE);
-                pProperties[*pCount].specVersion = VK_KHR_PORTABILITY_SUBSET_SPEC_VERSION;
-                *pCount += 1;
-            }
+        if (strcmp(pLayerName, kLayerName) == 0) {
+            return EnumerateProperties(kDeviceExtensionPropertiesCount, kDeviceExtensionProperties.data(), pCount, pProperties);
         } else {
-            *pCount += 1;
+            return dt->EnumerateDeviceExtensionProperties(physicalDevice, pLayerName, pCount, pProperties);
         }
     }
 
-    return result;
+    const auto pdd = PhysicalDeviceData::Find(physicalDevice);
+    if (pdd == nullptr) {
+        return dt->EnumerateDeviceExtensionProperties(physicalDevice, pLayerName, pCount, pProperties);
+    }
+
+    return EnumerateProperties(static_cast<uint32_t>(pdd->enumerated_extensions_.size()), pdd->enumerated_extensions_.data(),
+                               pCount, pProperties);
 }
 '''
 
@@ -2291,11 +2798,10 @@ QUEUE_FAMILY_PROPERTIES_FUNCTIONS = '''
 VKAPI_ATTR void VKAPI_CALL GetPhysicalDeviceQueueFamilyProperties(VkPhysicalDevice physicalDevice,
                                                                   uint32_t *pQueueFamilyPropertyCount,
                                                                   VkQueueFamilyProperties *pQueueFamilyProperties) {
-    std::lock_guard<std::recursive_mutex> lock(global_lock);
     const auto dt = instance_dispatch_table(physicalDevice);
 
     // Are there JSON overrides, or should we call down to return the original values?
-    PhysicalDeviceData *pdd = PhysicalDeviceData::Find(physicalDevice);
+    const auto pdd = PhysicalDeviceData::Find(physicalDevice);
     const uint32_t src_count = (pdd) ? static_cast<uint32_t>(pdd->arrayof_queue_family_properties_.size()) : 0;
     if (src_count == 0) {
         dt->GetPhysicalDeviceQueueFamilyProperties(physicalDevice, pQueueFamilyPropertyCount, pQueueFamilyProperties);
@@ -2318,11 +2824,10 @@ VKAPI_ATTR void VKAPI_CALL GetPhysicalDeviceQueueFamilyProperties(VkPhysicalDevi
 VKAPI_ATTR void VKAPI_CALL GetPhysicalDeviceQueueFamilyProperties2KHR(VkPhysicalDevice physicalDevice,
                                                                       uint32_t *pQueueFamilyPropertyCount,
                                                                       VkQueueFamilyProperties2KHR *pQueueFamilyProperties2) {
-    std::lock_guard<std::recursive_mutex> lock(global_lock);
     const auto dt = instance_dispatch_table(physicalDevice);
 
     // Are there JSON overrides, or should we call down to return the original values?
-    PhysicalDeviceData *pdd = PhysicalDeviceData::Find(physicalDevice);
+    const auto pdd = PhysicalDeviceData::Find(physicalDevice);
     const uint32_t src_count = (pdd) ? static_cast<uint32_t>(pdd->arrayof_queue_family_properties_.size()) : 0;
     if (src_count == 0) {
         dt->GetPhysicalDeviceQueueFamilyProperties2(physicalDevice, pQueueFamilyPropertyCount, pQueueFamilyProperties2);
@@ -2341,7 +2846,7 @@ VKAPI_ATTR void VKAPI_CALL GetPhysicalDeviceQueueFamilyProperties2KHR(VkPhysical
         pQueueFamilyProperties2[i].queueFamilyProperties = src_props[i].properties_2.queueFamilyProperties;
     }
     *pQueueFamilyPropertyCount = copy_count;
-    FillQueueFamilyPropertiesPNextChain(pdd, pQueueFamilyProperties2, copy_count);
+    FillQueueFamilyPropertiesPNextChain(pdd.get(), pQueueFamilyProperties2, copy_count);
 }
 
 VKAPI_ATTR void VKAPI_CALL GetPhysicalDeviceQueueFamilyProperties2(VkPhysicalDevice physicalDevice,
@@ -2354,65 +2859,47 @@ VKAPI_ATTR void VKAPI_CALL GetPhysicalDeviceQueueFamilyProperties2(VkPhysicalDev
 PHYSICAL_DEVICE_FORMAT_FUNCTIONS = '''
 VKAPI_ATTR void VKAPI_CALL GetPhysicalDeviceFormatProperties(VkPhysicalDevice physicalDevice, VkFormat format,
                                                              VkFormatProperties *pFormatProperties) {
-    std::lock_guard<std::recursive_mutex> lock(global_lock);
-    const auto dt = instance_dispatch_table(physicalDevice);
-
-    // Are there JSON overrides, or should we call down to return the original values?
-    PhysicalDeviceData *pdd = PhysicalDeviceData::Find(physicalDevice);
-    ProfileLayerSettings* layer_settings = &JsonLoader::Find(pdd->instance())->layer_settings;
-
-    // Check if Format was excluded
-    for (std::size_t j = 0, m = layer_settings->simulate.exclude_formats.size(); j < m; ++j) {
-        const std::string &excluded_format = layer_settings->simulate.exclude_formats[j];
-        if (excluded_format.empty()) continue;
-
-        if (StringToFormat(excluded_format) == format) {
+    const auto pdd = PhysicalDeviceData::Find(physicalDevice);
+    const PhysicalDeviceData::FormatTableEntry *entry = pdd != nullptr ? pdd->GetFormatTableEntry(format) : nullptr;
+
+    if (entry == nullptr) {
+        // A format unknown by the layer can't be excluded or simulated by a profile
+        const auto dt = instance_dispatch_table(physicalDevice);
+        if (pdd != nullptr && (pdd->layer_settings()->simulate.capabilities & SIMULATE_FORMATS_BIT) &&
+            !pdd->map_of_format_properties_.empty()) {
             *pFormatProperties = VkFormatProperties{};
-            return;
-        }
-    }
-
-    const uint32_t src_count = (pdd) ? static_cast<uint32_t>(pdd->map_of_format_properties_.size()) : 0;
-    if (src_count == 0) {
-        dt->GetPhysicalDeviceFormatProperties(physicalDevice, format, pFormatProperties);
-    } else {
-        VkFormatProperties device_format = {};
-        dt->GetPhysicalDeviceFormatProperties(physicalDevice, format, &device_format);
-        const auto iter = pdd->map_of_format_properties_.find(format);
-
-        if ((layer_settings->simulate.capabilities & SIMULATE_FORMATS_BIT)) {
-            *pFormatProperties = (iter != pdd->map_of_format_properties_.end()) ? iter->second : VkFormatProperties{};
         } else {
-            *pFormatProperties = device_format;
+            dt->GetPhysicalDeviceFormatProperties(physicalDevice, format, pFormatProperties);
         }
+        return;
+    }
 
-        if (IsFormatSupported(*pFormatProperties) && iter != pdd->map_of_format_properties_.end()) {
-            if ((layer_settings->simulate.capabilities & SIMULATE_FORMATS_BIT)) {
-                *pFormatProperties = iter->second;
-            } else {
-                *pFormatProperties = device_format;
-            }
+    *pFormatProperties = entry->properties;
 
-            if (!HasFlags(device_format.linearTilingFeatures, pFormatProperties->linearTilingFeatures) ||
-                !HasFlags(device_format.optimalTilingFeatures, pFormatProperties->optimalTilingFeatures) ||
-                !HasFlags(device_format.bufferFeatures, pFormatProperties->bufferFeatures)) {
-                LogMessage(layer_settings, DEBUG_REPORT_WARNING_BIT,
-                           "format %s is simulating unsupported features!\\n", vkFormatToString(format).c_str());
-            }
-        }
+    if (entry->simulating_unsupported_features) {
+        ProfileLayerSettings *layer_settings = pdd->layer_settings();
+        LOG_MESSAGE(layer_settings, DEBUG_REPORT_WARNING_BIT,
+                   "format %s is simulating unsupported features!\\n", vkFormatToString(format).c_str());
     }
-
-    LogFlush(layer_settings);
 }
 
 VKAPI_ATTR void VKAPI_CALL GetPhysicalDeviceFormatProperties2(VkPhysicalDevice physicalDevice, VkFormat format,
                                                               VkFormatProperties2KHR *pFormatProperties) {
-    std::lock_guard<std::recursive_mutex> lock(global_lock);
     const auto dt = instance_dispatch_table(physicalDevice);
-    dt->GetPhysicalDeviceFormatProperties2(physicalDevice, format, pFormatProperties);
+
+    const auto pdd = PhysicalDeviceData::Find(physicalDevice);
+    if (pdd == nullptr) {
+        dt->GetPhysicalDeviceFormatProperties2(physicalDevice, format, pFormatProperties);
+        return;
+    }
+
+    // Only call down the chain when the application requested structs that aren't in the format table
+    if (pdd->GetFormatTableEntry(format) == nullptr || !IsFormatPropertiesPNextChainCached(pFormatProperties->pNext)) {
+        dt->GetPhysicalDeviceFormatProperties2(physicalDevice, format, pFormatProperties);
+    }
+
     GetPhysicalDeviceFormatProperties(physicalDevice, format, &pFormatProperties->formatProperties);
-    PhysicalDeviceData *pdd = PhysicalDeviceData::Find(physicalDevice);
-    FillFormatPropertiesPNextChain(pdd, pFormatProperties->pNext, format);
+    FillFormatPropertiesPNextChain(pdd.get(), pFormatProperties->pNext, format);
 }
 
 VKAPI_ATTR void VKAPI_CALL GetPhysicalDeviceFormatProperties2KHR(VkPhysicalDevice physicalDevice, VkFormat format,
@@ -2424,28 +2911,39 @@ VKAPI_ATTR VkResult VKAPI_CALL GetPhysicalDeviceImageFormatProperties(VkPhysical
                                                                       VkImageType type, VkImageTiling tiling,
                                                                       VkImageUsageFlags usage, VkImageCreateFlags flags,
                                                                       VkImageFormatProperties *pImageFormatProperties) {
-    std::lock_guard<std::recursive_mutex> lock(global_lock);
     const auto dt = instance_dispatch_table(physicalDevice);
 
-    PhysicalDeviceData *pdd = PhysicalDeviceData::Find(physicalDevice);
-    ProfileLayerSettings* layer_settings = &JsonLoader::Find(pdd->instance())->layer_settings;
+    const auto pdd = PhysicalDeviceData::Find(physicalDevice);
+    if (pdd == nullptr) {
+        return dt->GetPhysicalDeviceImageFormatProperties(physicalDevice, format, type, tiling, usage, flags, pImageFormatProperties);
+    }
+
+    ProfileLayerSettings *layer_settings = pdd->layer_settings();
 
-    // Are there JSON overrides, or should we call down to return the original values?
-    if (!(layer_settings->simulate.capabilities & SIMULATE_FORMATS_BIT)) {
-        return dt->GetPhysicalDeviceImageFormatProperties(physicalDevice, format, type, tiling, usage, flags,
-                                                          pImageFormatProperties);
+    const ImageFormatCache::Key key = {format, type, tiling, usage, flags};
+    VkResult result = VK_SUCCESS;
+    if (pdd->image_format_cache_.Find(key, &result, pImageFormatProperties)) {
+        return result;
     }
 
-    VkFormatProperties fmt_props = {};
-    GetPhysicalDeviceFormatProperties(physicalDevice, format, &fmt_props);
+    // Are there JSON overrides, or should we call down to return the original values?
+    if (layer_settings->simulate.capabilities & SIMULATE_FORMATS_BIT) {
+        VkFormatProperties fmt_props = {};
+        GetPhysicalDeviceFormatProperties(physicalDevice, format, &fmt_props);
 
-    if (!IsFormatSupported(fmt_props)) {
-        *pImageFormatProperties = VkImageFormatProperties{};
-        return VK_ERROR_FORMAT_NOT_SUPPORTED;
+        if (!IsFormatSupported(fmt_props)) {
+            *pImageFormatProperties = VkImageFormatProperties{};
+            pdd->image_format_cache_.Insert(key, VK_ERROR_FORMAT_NOT_SUPPORTED, *pImageFormatProperties);
+            return VK_ERROR_FORMAT_NOT_SUPPORTED;
+        }
     }
 
-    VkResult result =
-        dt->GetPhysicalDeviceImageFormatProperties(physicalDevice, format, type, tiling, usage, flags, pImageFormatProperties);
+    result = dt->GetPhysicalDeviceImageFormatProperties(physicalDevice, format, type, tiling, usage, flags, pImageFormatProperties);
+
+    // Out of memory errors are transient, only the capabilities are cached
+    if (result == VK_SUCCESS || result == VK_ERROR_FORMAT_NOT_SUPPORTED) {
+        pdd->image_format_cache_.Insert(key, result, *pImageFormatProperties);
+    }
 
     return result;
 }
@@ -2453,12 +2951,33 @@ VKAPI_ATTR VkResult VKAPI_CALL GetPhysicalDeviceImageFormatProperties(VkPhysical
 VKAPI_ATTR VkResult VKAPI_CALL GetPhysicalDeviceImageFormatProperties2KHR(
     VkPhysicalDevice physicalDevice, const VkPhysicalDeviceImageFormatInfo2KHR *pImageFormatInfo,
     VkImageFormatProperties2KHR *pImageFormatProperties) {
-    std::lock_guard<std::recursive_mutex> lock(global_lock);
+    // Without extended structures, the query is equivalent to the cached Vulkan 1.0 query
+    if (pImageFormatInfo->pNext == nullptr && pImageFormatProperties->pNext == nullptr) {
+        return GetPhysicalDeviceImageFormatProperties(physicalDevice, pImageFormatInfo->format, pImageFormatInfo->type,
+                                                      pImageFormatInfo->tiling, pImageFormatInfo->usage, pImageFormatInfo->flags,
+                                                      &pImageFormatProperties->imageFormatProperties);
+    }
+
     const auto dt = instance_dispatch_table(physicalDevice);
-    dt->GetPhysicalDeviceImageFormatProperties2(physicalDevice, pImageFormatInfo, pImageFormatProperties);
-    return GetPhysicalDeviceImageFormatProperties(physicalDevice, pImageFormatInfo->format, pImageFormatInfo->type,
-                                                  pImageFormatInfo->tiling, pImageFormatInfo->usage, pImageFormatInfo->flags,
-                                                  &pImageFormatProperties->imageFormatProperties);
+
+    const auto pdd = PhysicalDeviceData::Find(physicalDevice);
+    if (pdd == nullptr) {
+        return dt->GetPhysicalDeviceImageFormatProperties2(physicalDevice, pImageFormatInfo, pImageFormatProperties);
+    }
+
+    ProfileLayerSettings *layer_settings = pdd->layer_settings();
+
+    if (layer_settings->simulate.capabilities & SIMULATE_FORMATS_BIT) {
+        VkFormatProperties fmt_props = {};
+        GetPhysicalDeviceFormatProperties(physicalDevice, pImageFormatInfo->format, &fmt_props);
+
+        if (!IsFormatSupported(fmt_props)) {
+            pImageFormatProperties->imageFormatProperties = VkImageFormatProperties{};
+            return VK_ERROR_FORMAT_NOT_SUPPORTED;
+        }
+    }
+
+    return dt->GetPhysicalDeviceImageFormatProperties2(physicalDevice, pImageFormatInfo, pImageFormatProperties);
 }
 
 VKAPI_ATTR VkResult VKAPI_CALL GetPhysicalDeviceImageFormatProperties2(VkPhysicalDevice physicalDevice,
@@ -2532,6 +3051,135 @@ TRANSFER_UNDEFINE = '''
 #undef TRANSFER_VALUE
 '''
 
+ENUMERATED_EXTENSIONS = '''
+// Build the device extension list once, in a deterministic order, including the emulated VK_KHR_portability_subset
+static void InitEnumeratedExtensions(PhysicalDeviceData &pdd) {
+    ProfileLayerSettings *layer_settings = pdd.layer_settings();
+
+    const bool device_extensions = !(layer_settings->simulate.capabilities & SIMULATE_EXTENSIONS_BIT) &&
+                                   layer_settings->simulate.exclude_device_extensions.empty();
+    const ExtensionSet &extensions = device_extensions ? pdd.device_extensions_ : pdd.simulation_extensions_;
+
+    uint32_t count = 0;
+    extensions.Enumerate(&count, nullptr);
+    pdd.enumerated_extensions_.resize(count);
+    extensions.Enumerate(&count, pdd.enumerated_extensions_.data());
+
+    if (layer_settings->simulate.emulate_portability &&
+        !PhysicalDeviceData::HasSimulatedOrRealExtension(&pdd, EXTENSION_INDEX_VK_KHR_PORTABILITY_SUBSET)) {
+        VkExtensionProperties extension = {};
+        strncpy(extension.extensionName, VK_KHR_PORTABILITY_SUBSET_EXTENSION_NAME, VK_MAX_EXTENSION_NAME_SIZE);
+        extension.specVersion = VK_KHR_PORTABILITY_SUBSET_SPEC_VERSION;
+        pdd.enumerated_extensions_.push_back(extension);
+    }
+
+    std::sort(pdd.enumerated_extensions_.begin(), pdd.enumerated_extensions_.end(),
+              [](const VkExtensionProperties &a, const VkExtensionProperties &b) {
+                  return strcmp(a.extensionName, b.extensionName) < 0;
+              });
+}
+'''
+
+FORMAT_TABLE = '''
+// Size the table of simulated format properties once the profile is loaded, the entries are loaded on first use
+static void InitFormatTable(PhysicalDeviceData &pdd) {
+    ProfileLayerSettings *layer_settings = pdd.layer_settings();
+
+    pdd.excluded_formats_.clear();
+    for (std::size_t j = 0, m = layer_settings->simulate.exclude_formats.size(); j < m; ++j) {
+        const std::string &excluded_format = layer_settings->simulate.exclude_formats[j];
+        if (excluded_format.empty()) continue;
+
+        pdd.excluded_formats_.push_back(StringToFormat(excluded_format));
+    }
+
+    pdd.format_table_ = std::vector<PhysicalDeviceData::FormatTableEntry>(GetFormatIndex().size());
+}
+
+const PhysicalDeviceData::FormatTableEntry *PhysicalDeviceData::GetFormatTableEntry(VkFormat format) const {
+    const std::size_t index = GetFormatIndex().Find(format);
+    if (index >= format_table_.size()) {
+        return nullptr;
+    }
+
+    FormatTableEntry &entry = format_table_[index];
+    std::call_once(entry.loaded, [&]() { LoadFormatTableEntry(format, &entry); });
+    return &entry;
+}
+
+void PhysicalDeviceData::LoadDeviceFormat(VkFormat format) {
+    if (device_formats_.count(format) > 0) {
+        return;
+    }
+
+    QueryDeviceFormat(format, &device_formats_[format], &device_formats_3_[format]);
+}
+
+void PhysicalDeviceData::QueryDeviceFormat(VkFormat format, VkFormatProperties *properties,
+                                           VkFormatProperties3 *properties_3) const {
+    const auto dt = instance_dispatch_table(instance_);
+
+    *properties_3 = {VK_STRUCTURE_TYPE_FORMAT_PROPERTIES_3};
+    VkFormatProperties2 format_properties = {VK_STRUCTURE_TYPE_FORMAT_PROPERTIES_2, properties_3};
+    if (GetEffectiveVersion() >= VK_API_VERSION_1_1) {
+        dt->GetPhysicalDeviceFormatProperties2(physical_device_, format, &format_properties);
+    } else {
+        dt->GetPhysicalDeviceFormatProperties2KHR(physical_device_, format, &format_properties);
+    }
+    *properties = format_properties.formatProperties;
+    properties_3->pNext = nullptr;
+}
+
+void PhysicalDeviceData::LoadFormatTableEntry(VkFormat format, FormatTableEntry *entry) const {
+    const bool simulate_formats = (layer_settings_->simulate.capabilities & SIMULATE_FORMATS_BIT) != 0;
+
+    // Reuse the device format properties queried by the profile loading
+    VkFormatProperties device_format = {};
+    VkFormatProperties3 device_format_3 = {};
+    const auto device_iter = device_formats_.find(format);
+    if (device_iter != device_formats_.end()) {
+        device_format = device_iter->second;
+        device_format_3 = device_formats_3_.at(format);
+    } else {
+        QueryDeviceFormat(format, &device_format, &device_format_3);
+    }
+
+    // The format properties 3 are the device ones unless the profile provides any
+    if (map_of_format_properties_3_.empty()) {
+        entry->properties_3 = device_format_3;
+    } else {
+        const auto iter_3 = map_of_format_properties_3_.find(format);
+        if (iter_3 != map_of_format_properties_3_.end()) {
+            entry->properties_3 = iter_3->second;
+        }
+    }
+
+    entry->excluded = std::find(excluded_formats_.begin(), excluded_formats_.end(), format) != excluded_formats_.end();
+    if (entry->excluded) {
+        return;
+    }
+
+    if (map_of_format_properties_.empty()) {
+        entry->properties = device_format;
+        return;
+    }
+
+    const auto iter = map_of_format_properties_.find(format);
+    if (simulate_formats) {
+        entry->properties = (iter != map_of_format_properties_.end()) ? iter->second : VkFormatProperties{};
+    } else {
+        entry->properties = device_format;
+    }
+
+    if (IsFormatSupported(entry->properties) && iter != map_of_format_properties_.end()) {
+        entry->simulating_unsupported_features =
+            !HasFlags(device_format.linearTilingFeatures, entry->properties.linearTilingFeatures) ||
+            !HasFlags(device_format.optimalTilingFeatures, entry->properties.optimalTilingFeatures) ||
+            !HasFlags(device_format.bufferFeatures, entry->properties.bufferFeatures);
+    }
+}
+'''
+
 LOAD_QUEUE_FAMILY_PROPERTIES = '''
 void LoadQueueFamilyProperties(VkInstance instance, VkPhysicalDevice pd, PhysicalDeviceData *pdd) {
     const auto dt = instance_dispatch_table(instance);
@@ -2546,12 +3194,12 @@ void LoadQueueFamilyProperties(VkInstance instance, VkPhysicalDevice pd, Physica
         std::vector<void *> pNext(count);
         std::vector<VkQueueFamilyProperties2> props(count);
         for (uint32_t i = 0; i < count; ++i) {
-            if (PhysicalDeviceData::HasExtension(pdd, VK_KHR_GLOBAL_PRIORITY_EXTENSION_NAME)) {
+            if (PhysicalDeviceData::HasExtension(pdd, EXTENSION_INDEX_VK_KHR_GLOBAL_PRIORITY)) {
                 pdd->device_queue_family_properties_[i].global_priority_properties_.pNext = pNext[i];
 
                 pNext[i] = &pdd->device_queue_family_properties_[i].global_priority_properties_;
             }
-            if (PhysicalDeviceData::HasExtension(pdd, VK_KHR_VIDEO_QUEUE_EXTENSION_NAME)) {
+            if (PhysicalDeviceData::HasExtension(pdd, EXTENSION_INDEX_VK_KHR_VIDEO_QUEUE)) {
                 pdd->device_queue_family_properties_[i].video_properties_.pNext = pNext[i];
 
                 pNext[i] = &pdd->device_queue_family_properties_[i].video_properties_;
@@ -2560,12 +3208,12 @@ void LoadQueueFamilyProperties(VkInstance instance, VkPhysicalDevice pd, Physica
 
                 pNext[i] = &pdd->device_queue_family_properties_[i].query_result_status_properties_;
             }
-            if (PhysicalDeviceData::HasExtension(pdd, VK_NV_DEVICE_DIAGNOSTIC_CHECKPOINTS_EXTENSION_NAME)) {
+            if (PhysicalDeviceData::HasExtension(pdd, EXTENSION_INDEX_VK_NV_DEVICE_DIAGNOSTIC_CHECKPOINTS)) {
                 pdd->device_queue_family_properties_[i].checkpoint_properties_.pNext = pNext[i];
 
                 pNext[i] = &pdd->device_queue_family_properties_[i].checkpoint_properties_;
 
-                if (PhysicalDeviceData::HasExtension(pdd, VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME)) {
+                if (PhysicalDeviceData::HasExtension(pdd, EXTENSION_INDEX_VK_KHR_SYNCHRONIZATION_2)) {
                     pdd->device_queue_family_properties_[i].checkpoint_properties_2_.pNext = pNext[i];
 
                     pNext[i] = &pdd->device_queue_family_properties_[i].checkpoint_properties_2_;
@@ -2586,7 +3234,129 @@ void LoadQueueFamilyProperties(VkInstance instance, VkPhysicalDevice pd, Physica
 }
 '''
 
-ENUMERATE_PHYSICAL_DEVICES_BEGIN = '''
+LOAD_PHYSICAL_DEVICE_DATA_BEGIN = '''
+// Populate a PDD with the physical device capabilities, overridden by the profile capabilities when load_profile is true
+static VkResult LoadPhysicalDeviceData(VkInstance instance, VkPhysicalDevice physical_device, PhysicalDeviceData &pdd, bool load_profile) {
+    const auto dt = instance_dispatch_table(instance);
+
+    const auto json_loader = JsonLoader::Find(instance);
+    ProfileLayerSettings *layer_settings = &json_loader->layer_settings;
+
+    ArrayOfVkExtensionProperties local_device_extensions;
+    EnumerateAll<VkExtensionProperties>(local_device_extensions, [&](uint32_t *count, VkExtensionProperties *results) {
+        return dt->EnumerateDeviceExtensionProperties(physical_device, nullptr, count, results);
+    });
+
+    for(const auto& ext: local_device_extensions) {
+        pdd.device_extensions_.Insert(ext);
+    }
+
+    pdd.simulation_extensions_ = pdd.device_extensions_;
+
+    dt->GetPhysicalDeviceProperties(physical_device, &pdd.physical_device_properties_);
+    uint32_t effective_api_version = pdd.GetEffectiveVersion();
+    bool api_version_above_1_1 = effective_api_version >= VK_API_VERSION_1_1;
+    bool api_version_above_1_2 = effective_api_version >= VK_API_VERSION_1_2;
+    bool api_version_above_1_3 = effective_api_version >= VK_API_VERSION_1_3;
+
+    ::device_has_astc_hdr = ::PhysicalDeviceData::HasExtension(&pdd, EXTENSION_INDEX_VK_EXT_TEXTURE_COMPRESSION_ASTC_HDR);
+    ::device_has_pvrtc = ::PhysicalDeviceData::HasExtension(&pdd, EXTENSION_INDEX_VK_IMG_FORMAT_PVRTC);
+
+    // Initialize PDD members to the actual Vulkan implementation's defaults.
+    {
+        VkPhysicalDeviceProperties2KHR property_chain = {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2_KHR};
+        VkPhysicalDeviceFeatures2KHR feature_chain = {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2_KHR};
+        VkPhysicalDeviceMemoryProperties2KHR memory_chain = {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2_KHR};
+
+        if (PhysicalDeviceData::HasExtension(&pdd, EXTENSION_INDEX_VK_KHR_PORTABILITY_SUBSET)) {
+            property_chain.pNext = &(pdd.physical_device_portability_subset_properties_);
+            feature_chain.pNext = &(pdd.physical_device_portability_subset_features_);
+        } else if (layer_settings->simulate.emulate_portability) {
+            pdd.physical_device_portability_subset_properties_ = {
+                VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PORTABILITY_SUBSET_PROPERTIES_KHR, nullptr, layer_settings->portability.minVertexInputBindingStrideAlignment};
+            pdd.physical_device_portability_subset_features_ = {
+                VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PORTABILITY_SUBSET_FEATURES_KHR,
+                nullptr,
+                layer_settings->portability.constantAlphaColorBlendFactors,
+                layer_settings->portability.events,
+                layer_settings->portability.imageViewFormatReinterpretation,
+                layer_settings->portability.imageViewFormatSwizzle,
+                layer_settings->portability.imageView2DOn3DImage,
+                layer_settings->portability.multisampleArrayImage,
+                layer_settings->portability.mutableComparisonSamplers,
+                layer_settings->portability.pointPolygons,
+                layer_settings->portability.samplerMipLodBias,
+                layer_settings->portability.separateStencilMaskRef,
+                layer_settings->portability.shaderSampleRateInterpolationFunctions,
+                layer_settings->portability.tessellationIsolines,
+                layer_settings->portability.tessellationPointMode,
+                layer_settings->portability.triangleFans,
+                layer_settings->portability.vertexAttributeAccessBeyondStride};
+        }
+'''
+
+LOAD_PHYSICAL_DEVICE_DATA_MIDDLE = '''
+        if (pdd.GetEffectiveVersion() >= VK_API_VERSION_1_1) {
+            dt->GetPhysicalDeviceProperties2(physical_device, &property_chain);
+            if (layer_settings->simulate.default_feature_values == DEFAULT_FEATURE_VALUES_DEVICE) {
+                dt->GetPhysicalDeviceFeatures2(physical_device, &feature_chain);
+            }
+            dt->GetPhysicalDeviceMemoryProperties2(physical_device, &memory_chain);
+        } else {
+            dt->GetPhysicalDeviceProperties2(physical_device, &property_chain);
+            if (layer_settings->simulate.default_feature_values == DEFAULT_FEATURE_VALUES_DEVICE) {
+                dt->GetPhysicalDeviceFeatures2(physical_device, &feature_chain);
+            }
+            dt->GetPhysicalDeviceMemoryProperties2(physical_device, &memory_chain);
+        }
+
+        pdd.physical_device_properties_ = property_chain.properties;
+        pdd.physical_device_features_ = feature_chain.features;
+        pdd.physical_device_memory_properties_ = memory_chain.memoryProperties;
+    }
+
+    ::device_has_astc = pdd.physical_device_features_.textureCompressionASTC_LDR == VK_TRUE;
+    ::device_has_bc = pdd.physical_device_features_.textureCompressionBC == VK_TRUE;
+    ::device_has_etc2 = pdd.physical_device_features_.textureCompressionETC2 == VK_TRUE;
+
+    if (layer_settings->simulate.capabilities & SIMULATE_QUEUE_FAMILY_PROPERTIES_BIT) {
+        LoadQueueFamilyProperties(instance, physical_device, &pdd);
+    }
+
+    LOG_MESSAGE(layer_settings, DEBUG_REPORT_NOTIFICATION_BIT,
+               "Found \\"%s\\" with Vulkan %d.%d.%d driver.\\n", pdd.physical_device_properties_.deviceName,
+                      VK_API_VERSION_MAJOR(pdd.physical_device_properties_.apiVersion),
+                      VK_API_VERSION_MINOR(pdd.physical_device_properties_.apiVersion),
+                      VK_API_VERSION_PATCH(pdd.physical_device_properties_.apiVersion));
+
+    // Override PDD members with values from configuration file(s).
+    VkResult result = VK_SUCCESS;
+    if (load_profile) {
+        result = json_loader->LoadDevice(pdd.physical_device_properties_.deviceName, &pdd);
+    }
+'''
+
+LOAD_PHYSICAL_DEVICE_DATA_END = '''
+    if (layer_settings->simulate.capabilities & SIMULATE_EXTENSIONS_BIT) {
+        pdd.simulation_extensions_ = pdd.map_of_extension_properties_;
+    } else {
+        pdd.simulation_extensions_ = pdd.device_extensions_;
+    }
+
+    for (std::size_t j = 0, m = layer_settings->simulate.exclude_device_extensions.size(); j < m; ++j) {
+        pdd.simulation_extensions_.Erase(layer_settings->simulate.exclude_device_extensions[j].c_str());
+    }
+
+    InitEnumeratedExtensions(pdd);
+    InitExposedPNextStructs(pdd);
+
+    InitFormatTable(pdd);
+
+    return result;
+}
+'''
+
+ENUMERATE_PHYSICAL_DEVICES = '''
 VKAPI_ATTR VkResult VKAPI_CALL EnumeratePhysicalDevices(VkInstance instance, uint32_t *pPhysicalDeviceCount,
                                                         VkPhysicalDevice *pPhysicalDevices) {
     // Our layer-specific initialization...
@@ -2594,7 +3364,8 @@ VKAPI_ATTR VkResult VKAPI_CALL EnumeratePhysicalDevices(VkInstance instance, uin
     std::lock_guard<std::recursive_mutex> lock(global_lock);
     const auto dt = instance_dispatch_table(instance);
 
-    ProfileLayerSettings *layer_settings = &JsonLoader::Find(instance)->layer_settings;
+    const auto json_loader = JsonLoader::Find(instance);
+    ProfileLayerSettings *layer_settings = &json_loader->layer_settings;
 
     VkResult result = VK_SUCCESS;
     result = dt->EnumeratePhysicalDevices(instance, pPhysicalDeviceCount, pPhysicalDevices);
@@ -2612,7 +3383,7 @@ VKAPI_ATTR VkResult VKAPI_CALL EnumeratePhysicalDevices(VkInstance instance, uin
         }
 
         if (layer_settings->device.force_device != FORCE_DEVICE_OFF && *pPhysicalDeviceCount == 1) {
-            LogMessage(layer_settings, DEBUG_REPORT_NOTIFICATION_BIT, "Forced physical device is disabled because a single physical device was found.\\n");
+            LOG_MESSAGE(layer_settings, DEBUG_REPORT_NOTIFICATION_BIT, "Forced physical device is disabled because a single physical device was found.\\n");
             layer_settings->device.force_device = FORCE_DEVICE_OFF;
         }
 
@@ -2646,14 +3417,14 @@ VKAPI_ATTR VkResult VKAPI_CALL EnumeratePhysicalDevices(VkInstance instance, uin
                     std::swap(physical_devices, physical_devices_tmp);
 
                     if (!force_physical_device_log_once) {
-                        LogMessage(layer_settings, DEBUG_REPORT_NOTIFICATION_BIT,
+                        LOG_MESSAGE(layer_settings, DEBUG_REPORT_NOTIFICATION_BIT,
                             "Force physical device by device UUID: '%s'('%s').\\n",
                             layer_settings->device.force_device_uuid.c_str(),
                             layer_settings->device.force_device_name.c_str());
                     }
                 } else {
                     if (!force_physical_device_log_once) {
-                        LogMessage(layer_settings, DEBUG_REPORT_ERROR_BIT,
+                        LOG_MESSAGE(layer_settings, DEBUG_REPORT_ERROR_BIT,
                             "Force physical device by device UUID is active but the requested physical device '%s'('%s') couldn't be found.\\n",
                             layer_settings->device.force_device_uuid.c_str(),
                             layer_settings->device.force_device_name.c_str());
@@ -2684,14 +3455,14 @@ VKAPI_ATTR VkResult VKAPI_CALL EnumeratePhysicalDevices(VkInstance instance, uin
                     std::swap(physical_devices, physical_devices_tmp);
 
                     if (!force_physical_device_log_once) {
-                        LogMessage(layer_settings, DEBUG_REPORT_NOTIFICATION_BIT,
+                        LOG_MESSAGE(layer_settings, DEBUG_REPORT_NOTIFICATION_BIT,
                             "Force physical device by device name: '%s'.\\n",
                             layer_settings->device.force_device_name.c_str());
                     }
                 }
                 else {
                     if (!force_physical_device_log_once) {
-                        LogMessage(layer_settings, DEBUG_REPORT_ERROR_BIT,
+                        LOG_MESSAGE(layer_settings, DEBUG_REPORT_ERROR_BIT,
                             "Force physical device by device name is active but the requested physical device '%s' couldn't be found.\\n",
                             layer_settings->device.force_device_name.c_str());
                     }
@@ -2707,121 +3478,101 @@ VKAPI_ATTR VkResult VKAPI_CALL EnumeratePhysicalDevices(VkInstance instance, uin
                 continue;
             }
 
-            PhysicalDeviceData &pdd = PhysicalDeviceData::Create(physical_device, instance);
-            ArrayOfVkExtensionProperties local_device_extensions;
-            EnumerateAll<VkExtensionProperties>(local_device_extensions, [&](uint32_t *count, VkExtensionProperties *results) {
-                return dt->EnumerateDeviceExtensionProperties(physical_device, nullptr, count, results);
-            });
+            const auto pdd = PhysicalDeviceData::Create(instance, physical_device, layer_settings, json_loader->requested_version);
+            const VkResult device_result = LoadPhysicalDeviceData(instance, physical_device, *pdd, result == VK_SUCCESS);
+            if (device_result != VK_SUCCESS) {
+                result = device_result;
+            }
+            PhysicalDeviceData::Store(physical_device, pdd);
+        }
+    }
 
-            pdd.device_extensions_.reserve(local_device_extensions.size());
-            for(const auto& ext: local_device_extensions) {
-                pdd.device_extensions_.insert({&(ext.extensionName[0]), ext});
-            }
-
-            pdd.simulation_extensions_ = pdd.device_extensions_;
-
-            dt->GetPhysicalDeviceProperties(physical_device, &pdd.physical_device_properties_);
-            uint32_t effective_api_version = pdd.GetEffectiveVersion();
-            bool api_version_above_1_1 = effective_api_version >= VK_API_VERSION_1_1;
-            bool api_version_above_1_2 = effective_api_version >= VK_API_VERSION_1_2;
-            bool api_version_above_1_3 = effective_api_version >= VK_API_VERSION_1_3;
-
-            ::device_has_astc_hdr = ::PhysicalDeviceData::HasExtension(&pdd, VK_EXT_TEXTURE_COMPRESSION_ASTC_HDR_EXTENSION_NAME);
-            ::device_has_pvrtc = ::PhysicalDeviceData::HasExtension(&pdd, VK_IMG_FORMAT_PVRTC_EXTENSION_NAME);
-
-            // Initialize PDD members to the actual Vulkan implementation's defaults.
-            {
-                VkPhysicalDeviceProperties2KHR property_chain = {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2_KHR};
-                VkPhysicalDeviceFeatures2KHR feature_chain = {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2_KHR};
-                VkPhysicalDeviceMemoryProperties2KHR memory_chain = {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2_KHR};
-
-                if (PhysicalDeviceData::HasExtension(&pdd, VK_KHR_PORTABILITY_SUBSET_EXTENSION_NAME)) {
-                    property_chain.pNext = &(pdd.physical_device_portability_subset_properties_);
-                    feature_chain.pNext = &(pdd.physical_device_portability_subset_features_);
-                } else if (layer_settings->simulate.emulate_portability) {
-                    pdd.physical_device_portability_subset_properties_ = {
-                        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PORTABILITY_SUBSET_PROPERTIES_KHR, nullptr, layer_settings->portability.minVertexInputBindingStrideAlignment};
-                    pdd.physical_device_portability_subset_features_ = {
-                        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PORTABILITY_SUBSET_FEATURES_KHR,
-                        nullptr,
-                        layer_settings->portability.constantAlphaColorBlendFactors,
-                        layer_settings->portability.events,
-                        layer_settings->portability.imageViewFormatReinterpretation,
-                        layer_settings->portability.imageViewFormatSwizzle,
-                        layer_settings->portability.imageView2DOn3DImage,
-                        layer_settings->portability.multisampleArrayImage,
-                        layer_settings->portability.mutableComparisonSamplers,
-                        layer_settings->portability.pointPolygons,
-                        layer_settings->portability.samplerMipLodBias,
-                        layer_settings->portability.separateStencilMaskRef,
-                        layer_settings->portability.shaderSampleRateInterpolationFunctions,
-                        layer_settings->portability.tessellationIsolines,
-                        layer_settings->portability.tessellationPointMode,
-                        layer_settings->portability.triangleFans,
-                        layer_settings->portability.vertexAttributeAccessBeyondStride};
-                }
+    LogFlush(layer_settings);
+
+    return result;
+}
 '''
 
-ENUMERATE_PHYSICAL_DEVICES_MIDDLE = '''
-                if (pdd.GetEffectiveVersion() >= VK_API_VERSION_1_1) {
-                    dt->GetPhysicalDeviceProperties2(physical_device, &property_chain);
-                    if (layer_settings->simulate.default_feature_values == DEFAULT_FEATURE_VALUES_DEVICE) {
-                        dt->GetPhysicalDeviceFeatures2(physical_device, &feature_chain);
-                    }
-                    dt->GetPhysicalDeviceMemoryProperties2(physical_device, &memory_chain);
-                } else {
-                    dt->GetPhysicalDeviceProperties2(physical_device, &property_chain);
-                    if (layer_settings->simulate.default_feature_values == DEFAULT_FEATURE_VALUES_DEVICE) {
-                        dt->GetPhysicalDeviceFeatures2(physical_device, &feature_chain);
-                    }
-                    dt->GetPhysicalDeviceMemoryProperties2(physical_device, &memory_chain);
-                }
+PROFILES_HOT_RELOAD = '''
+void JsonLoader::WatchProfiles(VkInstance instance) {
+    if (!layer_settings.simulate.profile_hot_reload) {
+        return;
+    }
 
-                pdd.physical_device_properties_ = property_chain.properties;
-                pdd.physical_device_features_ = feature_chain.features;
-                pdd.physical_device_memory_properties_ = memory_chain.memoryProperties;
-            }
+    std::vector<std::string> paths = layer_settings.simulate.profile_dirs;
+    paths.push_back(layer_settings.simulate.profile_file);
 
-            ::device_has_astc = pdd.physical_device_features_.textureCompressionASTC_LDR == VK_TRUE;
-            ::device_has_bc = pdd.physical_device_features_.textureCompressionBC == VK_TRUE;
-            ::device_has_etc2 = pdd.physical_device_features_.textureCompressionETC2 == VK_TRUE;
+    profiles_watcher_.reset(new FileWatcher(paths, [instance]() { JsonLoader::ReloadProfiles(instance); }));
+    if (!profiles_watcher_->is_active()) {
+        LOG_MESSAGE(&layer_settings, DEBUG_REPORT_WARNING_BIT, "The profile files can't be watched, '%s' setting is ignored.\\n", kLayerSettingsProfileHotReload);
+        profiles_watcher_.reset();
+    }
+}
 
-            if (layer_settings->simulate.capabilities & SIMULATE_FORMATS_BIT) {
-                LoadDeviceFormats(instance, &pdd, physical_device, &pdd.device_formats_, &pdd.device_formats_3_);
-            }
-            if (layer_settings->simulate.capabilities & SIMULATE_QUEUE_FAMILY_PROPERTIES_BIT) {
-                LoadQueueFamilyProperties(instance, physical_device, &pdd);
-            }
+void JsonLoader::StopWatchingProfiles() {
+    profiles_watcher_.reset();
+}
 
-            LogMessage(layer_settings, DEBUG_REPORT_NOTIFICATION_BIT,
-                       "Found \\"%s\\" with Vulkan %d.%d.%d driver.\\n", pdd.physical_device_properties_.deviceName,
-                              VK_API_VERSION_MAJOR(pdd.physical_device_properties_.apiVersion),
-                              VK_API_VERSION_MINOR(pdd.physical_device_properties_.apiVersion),
-                              VK_API_VERSION_PATCH(pdd.physical_device_properties_.apiVersion));
+void JsonLoader::SwapProfilesState(ProfilesState &state) {
+    // Swapping the maps keeps the file iterators and the resolved profiles roots valid, but not end(), so the index is rebuilt
+    this->profiles_files_.swap(state.files);
+    this->resolved_profiles_.swap(state.resolved_profiles);
+    std::swap(this->profiles_resolved_, state.profiles_resolved);
+    std::swap(this->profile_api_version_, state.profile_api_version);
+    this->excluded_extensions_.swap(state.excluded_extensions);
+    this->excluded_formats_.swap(state.excluded_formats);
 
-            // Override PDD members with values from configuration file(s).
-            if (result == VK_SUCCESS) {
-                JsonLoader &json_loader = *JsonLoader::Find(instance);
-                result = json_loader.LoadDevice(pdd.physical_device_properties_.deviceName, &pdd);
-            }
-'''
+    BuildProfilesIndex();
+}
 
-ENUMERATE_PHYSICAL_DEVICES_END = '''
-            if (layer_settings->simulate.capabilities & SIMULATE_EXTENSIONS_BIT) {
-                pdd.simulation_extensions_ = pdd.map_of_extension_properties_;
-            } else {
-                pdd.simulation_extensions_ = pdd.device_extensions_;
-            }
+// Called from the profiles watcher thread. Each PDD is fully reloaded before replacing the previous one,
+// so that queries see either the previous or the reloaded capabilities. The reload queries the driver again,
+// as the profile values are written over the device values in place and the PDD is not copyable (its pNext
+// chains point to its own members). The format properties are still only queried on their first use.
+void JsonLoader::ReloadProfiles(VkInstance instance) {
+    std::lock_guard<std::recursive_mutex> lock(global_lock);
+
+    const auto json_loader = JsonLoader::Find(instance);
+    if (json_loader == nullptr) {
+        return;
+    }
 
-            for (std::size_t j = 0, m = layer_settings->simulate.exclude_device_extensions.size(); j < m; ++j) {
-                pdd.simulation_extensions_.erase(layer_settings->simulate.exclude_device_extensions[j].c_str());
+    ProfileLayerSettings *layer_settings = &json_loader->layer_settings;
+    const std::string &profile_name = layer_settings->simulate.profile_name;
+
+    LOG_MESSAGE(layer_settings, DEBUG_REPORT_NOTIFICATION_BIT, "Profile files modified, reloading the profiles.\\n");
+
+    // Load the modified files into an empty state, the previous state is restored if the profile can't be reloaded
+    ProfilesState previous_state;
+    json_loader->SwapProfilesState(previous_state);
+
+    if (json_loader->LoadProfilesDatabase() != VK_SUCCESS || json_loader->FindRootFromProfileName(profile_name).isNull()) {
+        json_loader->SwapProfilesState(previous_state);
+        LOG_MESSAGE(layer_settings, DEBUG_REPORT_ERROR_BIT, "- '%s' profile couldn't be reloaded, the physical devices capabilities are unchanged.\\n", profile_name.c_str());
+        LogFlush(layer_settings);
+        return;
+    }
+
+    const auto dt = instance_dispatch_table(instance);
+
+    std::vector<VkPhysicalDevice> physical_devices;
+    VkResult result = EnumerateAll<VkPhysicalDevice>(physical_devices, [&](uint32_t *count, VkPhysicalDevice *results) {
+        return dt->EnumeratePhysicalDevices(instance, count, results);
+    });
+
+    if (result == VK_SUCCESS) {
+        for (const auto &physical_device : physical_devices) {
+            if (!PhysicalDeviceData::Find(physical_device)) {
+                continue;
             }
+
+            const auto pdd = PhysicalDeviceData::Create(instance, physical_device, layer_settings, json_loader->requested_version);
+            LoadPhysicalDeviceData(instance, physical_device, *pdd, true);
+            PhysicalDeviceData::Store(physical_device, pdd);
         }
     }
 
     LogFlush(layer_settings);
-
-    return result;
 }
 '''
 
@@ -2860,7 +3611,6 @@ VKAPI_ATTR PFN_vkVoidFunction VKAPI_CALL GetInstanceProcAddr(VkInstance instance
         return nullptr;
     }
 
-    std::lock_guard<std::recursive_mutex> lock(global_lock);
     const auto dt = instance_dispatch_table(instance);
 
     if (!dt->GetInstanceProcAddr) {
@@ -2870,83 +3620,6 @@ VKAPI_ATTR PFN_vkVoidFunction VKAPI_CALL GetInstanceProcAddr(VkInstance instance
 }
 '''
 
-GET_VALUE_PHYSICAL_DEVICE_PROPERTIES = '''
-bool JsonLoader::GetStruct(const char* device_name, bool requested_profile, const Json::Value &parent, VkPhysicalDeviceProperties *dest) {
-    LogMessage(&layer_settings, DEBUG_REPORT_DEBUG_BIT, \"\\tJsonLoader::GetStruct(VkPhysicalDeviceProperties)\\n");
-    bool valid = true;
-    if (!GetStruct(device_name, requested_profile, parent["limits"], &dest->limits)) {
-        valid = false;
-    }
-    if (!GetStruct(device_name, requested_profile, parent["sparseProperties"], &dest->sparseProperties)) {
-        valid = false;
-    }
-    for (const auto &prop : parent.getMemberNames()) {
-        GET_VALUE(prop, apiVersion, false, requested_profile);
-        GET_VALUE(prop, driverVersion, true, requested_profile);
-        GET_VALUE(prop, vendorID, true, requested_profile);
-        GET_VALUE(prop, deviceID, true, requested_profile);
-        GET_VALUE_ENUM_WARN(prop, deviceType, true, requested_profile, WarnIfNotEqualEnum);
-        GetArray(device_name, parent, prop, "deviceName", dest->deviceName, true);         // size < VK_MAX_PHYSICAL_DEVICE_NAME_SIZE
-        GetArray(device_name, parent, prop, "pipelineCacheUUID", dest->pipelineCacheUUID, true);  // size == VK_UUID_SIZE*/
-    }
-    return valid;
-}
-'''
-
-GET_VALUE_PHYSICAL_DEVICE_PORTABILITY_SUBSET_PROPERTIES = '''
-bool JsonLoader::GetStruct(const char* device_name, bool requested_profile, const Json::Value &parent, VkPhysicalDevicePortabilitySubsetPropertiesKHR *dest) {
-    LogMessage(&layer_settings, DEBUG_REPORT_DEBUG_BIT, \"\\tJsonLoader::GetStruct(VkPhysicalDevicePortabilitySubsetPropertiesKHR)\\n");
-    bool valid = true;
-    for (const auto &member : parent.getMemberNames()) {
-        GET_VALUE_WARN(member, minVertexInputBindingStrideAlignment, false, requested_profile, WarnIfLesser);
-    }
-    return valid;
-}
-'''
-
-GET_VALUE_PHYSICAL_DEVICE_PORTABILITY_SUBSET_FEATURES = '''
-bool JsonLoader::GetStruct(const char* device_name, bool requested_profile, const Json::Value &parent, VkPhysicalDevicePortabilitySubsetFeaturesKHR *dest) {
-    LogMessage(&layer_settings, DEBUG_REPORT_DEBUG_BIT, \"\\tJsonLoader::GetStruct(VkPhysicalDevicePortabilitySubsetFeaturesKHR)\\n");
-    bool valid = true;
-    for (const auto &member : parent.getMemberNames()) {
-        if (layer_settings.simulate.emulate_portability) {
-            dest->constantAlphaColorBlendFactors = layer_settings.portability.constantAlphaColorBlendFactors;
-            dest->events = layer_settings.portability.events;
-            dest->imageViewFormatReinterpretation = layer_settings.portability.imageViewFormatReinterpretation;
-            dest->imageViewFormatSwizzle = layer_settings.portability.imageViewFormatSwizzle;
-            dest->imageView2DOn3DImage = layer_settings.portability.imageView2DOn3DImage;
-            dest->multisampleArrayImage = layer_settings.portability.multisampleArrayImage;
-            dest->mutableComparisonSamplers = layer_settings.portability.mutableComparisonSamplers;
-            dest->pointPolygons = layer_settings.portability.pointPolygons;
-            dest->samplerMipLodBias = layer_settings.portability.samplerMipLodBias;
-            dest->separateStencilMaskRef = layer_settings.portability.separateStencilMaskRef;
-            dest->shaderSampleRateInterpolationFunctions = layer_settings.portability.shaderSampleRateInterpolationFunctions;
-            dest->tessellationIsolines = layer_settings.portability.tessellationIsolines;
-            dest->tessellationPointMode = layer_settings.portability.tessellationPointMode;
-            dest->triangleFans = layer_settings.portability.triangleFans;
-            dest->vertexAttributeAccessBeyondStride = layer_settings.portability.vertexAttributeAccessBeyondStride;
-        } else {
-            GET_VALUE_WARN(member, constantAlphaColorBlendFactors, false, requested_profile, WarnIfNotEqualBool);
-            GET_VALUE_WARN(member, events, false, requested_profile, WarnIfNotEqualBool);
-            GET_VALUE_WARN(member, imageViewFormatReinterpretation, false, requested_profile, WarnIfNotEqualBool);
-            GET_VALUE_WARN(member, imageViewFormatSwizzle, false, requested_profile, WarnIfNotEqualBool);
-            GET_VALUE_WARN(member, imageView2DOn3DImage, false, requested_profile, WarnIfNotEqualBool);
-            GET_VALUE_WARN(member, multisampleArrayImage, false, requested_profile, WarnIfNotEqualBool);
-            GET_VALUE_WARN(member, mutableComparisonSamplers, false, requested_profile, WarnIfNotEqualBool);
-            GET_VALUE_WARN(member, pointPolygons, false, requested_profile, WarnIfNotEqualBool);
-            GET_VALUE_WARN(member, samplerMipLodBias, false, requested_profile, WarnIfNotEqualBool);
-            GET_VALUE_WARN(member, separateStencilMaskRef, false, requested_profile, WarnIfNotEqualBool);
-            GET_VALUE_WARN(member, shaderSampleRateInterpolationFunctions, false, requested_profile, WarnIfNotEqualBool);
-            GET_VALUE_WARN(member, tessellationIsolines, false, requested_profile, WarnIfNotEqualBool);
-            GET_VALUE_WARN(member, tessellationPointMode, false, requested_profile, WarnIfNotEqualBool);
-            GET_VALUE_WARN(member, triangleFans, false, requested_profile, WarnIfNotEqualBool);
-            GET_VALUE_WARN(member, vertexAttributeAccessBeyondStride, false, requested_profile, WarnIfNotEqualBool);
-        }
-    }
-    return valid;
-}
-'''
-
 class VulkanProfilesLayerGenerator():
     emulated_extensions = ['VK_KHR_portability_subset']
     additional_features = ['VkPhysicalDeviceFeatures', 'VkPhysicalDevicePortabilitySubsetFeaturesKHR']
@@ -2967,6 +3640,9 @@ class VulkanProfilesLayerGenerator():
             f.write(GLOBAL_VARS)
             f.write(GET_DEFINES)
             f.write(self.generate_is_instance_extension())
+            f.write(self.generate_format_index())
+            f.write(self.generate_extension_index())
+            f.write(EXTENSION_SET)
             f.write(self.generate_physical_device_data())
             f.write(self.generate_json_loader())
             f.write(self.generate_is_format_functions())
@@ -2993,9 +3669,11 @@ class VulkanProfilesLayerGenerator():
             f.write(TRANSFER_DEFINES_ARRAY)
             f.write(self.generate_transfer_values())
             f.write(TRANSFER_UNDEFINE)
-            f.write(self.generate_load_device_formats())
+            f.write(ENUMERATED_EXTENSIONS)
+            f.write(FORMAT_TABLE)
             f.write(LOAD_QUEUE_FAMILY_PROPERTIES)
             f.write(self.generate_enumerate_physical_device())
+            f.write(PROFILES_HOT_RELOAD)
             f.write(GET_INSTANCE_PROC_ADDR)
 
     def struct_or_extension_platform(self, struct_or_ext_name):
@@ -3186,61 +3864,62 @@ class VulkanProfilesLayerGenerator():
         return gen
 
     def generate_get_struct(self, struct, extends, additional):
-        gen = ''
-        first = True
-        count = 0
+        cases = dict()
         for name, value  in registry.structs.items():
             if name in self.ignored_structs:
                 continue
             if (extends in value.extends and value.isAlias == False) or (name in additional):
                 aliases = value.aliases.copy()
-                count += 1
-                if count == 75:
-                    count = 0
-                    first = True
-                    gen += ' // Blocks nested too deeply, break\n'
                 while (aliases):
                     current = aliases.pop()
-                    if first:
-                        first = False
-                        gen += '    '
-                    else:
-                        gen += ' else '
-                    gen += 'if (name == \"' + current + '\"'
+                    names = [current]
                     copy_aliases = aliases.copy()
                     for alias in copy_aliases:
                         same_version = registry.structs[current].definedByVersion and registry.structs[alias].definedByVersion
                         same_extension = registry.structs[current].definedByExtensions and registry.structs[current].definedByExtensions == registry.structs[alias].definedByExtensions
                         if same_version or same_extension:
-                            gen += ' || name == \"' + alias + '\"'
+                            names.append(alias)
                             aliases.remove(alias)
 
-                    gen += ') {\n'
-
+                    body = ''
                     version = registry.structs[current].definedByVersion
                     if version:
                         if version and (version.major != 1 or version.minor != 0):
-                            gen += '        if (!CheckVersionSupport(' + registry.structs[current].definedByVersion.versionMacro + ', name)) return false;\n'
+                            body += '    if (!CheckVersionSupport(' + registry.structs[current].definedByVersion.versionMacro + ', name)) return false;\n'
                     else:
                         ext = registry.extensions[registry.structs[current].definedByExtensions[0]]
-                        gen += self.generate_platform_protect_begin(ext.name)
+                        body += self.generate_platform_protect_begin(ext.name)
                         if not ext.name in self.emulated_extensions:
                             ext_name = ext.upperCaseName + '_EXTENSION_NAME'
-                            gen += '        auto support = CheckExtensionSupport(' + ext_name + ', name);\n'
-                            gen += '        if (support != ExtensionSupport::SUPPORTED) return valid(support);\n'
+                            body += '    auto support = CheckExtensionSupport(' + ext_name + ', name);\n'
+                            body += '    if (support != ExtensionSupport::SUPPORTED) return valid(support);\n'
                     # Workarounds
                     if current == 'VkPhysicalDeviceLimits':
-                        gen += '        return GetStruct(device_name, requested_profile, ' + struct + ', &pdd_->physical_device_properties_.limits);\n'
+                        body += '    return GetStruct(device_name, requested_profile, ' + struct + ', &pdd_->physical_device_properties_.limits);\n'
                     elif current == 'VkPhysicalDeviceSparseProperties':
-                        gen += '        return GetStruct(device_name, requested_profile, ' + struct + ', &pdd_->physical_device_properties_.sparseProperties);\n'
+                        body += '    return GetStruct(device_name, requested_profile, ' + struct + ', &pdd_->physical_device_properties_.sparseProperties);\n'
                     else:
-                        gen += '        return GetStruct(device_name, requested_profile, ' + struct + ', &pdd_->' + self.create_var_name(current) + ');\n'
+                        body += '    return GetStruct(device_name, requested_profile, ' + struct + ', &pdd_->' + self.create_var_name(current) + ');\n'
 
                     if self.struct_or_extension_platform(current):
-                        gen += '#else\n        return false;\n'
-                        gen += self.generate_platform_protect_end(ext.name)
-
-                    gen += '    }'
+                        body += '#else\n    return false;\n'
+                        body += self.generate_platform_protect_end(ext.name)
+
+                    for current_name in names:
+                        cases.setdefault(self.hash_member_name(current_name), []).append((current_name, body))
+
+        gen = '    switch (HashMemberName(name.c_str())) {\n'
+        for hash, blocks in cases.items():
+            gen += '        case ' + '0x{0:08X}u'.format(hash) + ':\n'
+            for current_name, body in blocks:
+                gen += '            if (name == \"' + current_name + '\") {\n'
+                for line in body.splitlines():
+                    gen += (line if line.startswith('#') else '            ' + line) + '\n'
+                gen += '            }\n'
+            gen += '            break;\n'
+        gen += '        default:\n'
+        gen += '            break;\n'
+        gen += '    }'
         return gen
 
     def generate_get_queue_family_properties(self):
@@ -3292,7 +3971,7 @@ class VulkanProfilesLayerGenerator():
         gen = '\nvoid JsonLoader::AddPromotedExtensions(uint32_t api_version) {\n'
         gen += '\tconst uint32_t minor = VK_API_VERSION_MINOR(api_version);\n'
         gen += '\tconst uint32_t major = VK_API_VERSION_MAJOR(api_version);\n'
-        gen += '\tLogMessage(&layer_settings, DEBUG_REPORT_NOTIFICATION_BIT,\n'
+        gen += '\tLOG_MESSAGE(&layer_settings, DEBUG_REPORT_NOTIFICATION_BIT,\n'
         gen += '\t\"- Adding promoted extensions to core in Vulkan (%" PRIu32 ".%" PRIu32 ").\\n", major, minor);\n\n'
 
         for i in range(registry.headerVersionNumber.major):
@@ -3310,10 +3989,8 @@ class VulkanProfilesLayerGenerator():
                 gen += '            VkExtensionProperties extension;\n'
                 gen += '            strcpy(extension.extensionName, ext);\n'
                 gen += '            extension.specVersion = 1;\n'
-                gen += '            if (!PhysicalDeviceData::HasSimulatedExtension(pdd_, ext)) {\n'
-                gen += '                pdd_->simulation_extensions_.insert({ext, extension});\n'
-                gen += '            }\n'
-                gen += '            pdd_->map_of_extension_properties_.insert({ext, extension});\n'
+                gen += '            pdd_->simulation_extensions_.Insert(extension);\n'
+                gen += '            pdd_->map_of_extension_properties_.Insert(extension);\n'
                 gen += '        }\n'
                 gen += '    }\n'
         gen += '}\n'
@@ -3335,68 +4012,49 @@ class VulkanProfilesLayerGenerator():
                     gen += self.generate_get_value_function(feature)
         for struct in self.additional_features:
             if struct == 'VkPhysicalDevicePortabilitySubsetFeaturesKHR':
-                gen += GET_VALUE_PHYSICAL_DEVICE_PORTABILITY_SUBSET_FEATURES
+                gen += self.generate_get_value_portability_subset_features()
             else:
                 gen += self.generate_get_value_function(struct)
         for struct in self.additional_properties:
             if struct == 'VkPhysicalDeviceProperties':
-                gen += GET_VALUE_PHYSICAL_DEVICE_PROPERTIES
+                gen += self.generate_get_value_physical_device_properties()
             elif struct == 'VkPhysicalDevicePortabilitySubsetPropertiesKHR':
-                gen += GET_VALUE_PHYSICAL_DEVICE_PORTABILITY_SUBSET_PROPERTIES
+                gen += self.generate_get_value_portability_subset_properties()
             else:
                 gen += self.generate_get_value_function(struct)
 
         return gen
 
     def generate_fill_physical_device_pnext_chain(self):
-        gen = '\nvoid FillPNextChain(PhysicalDeviceData *physicalDeviceData, void *place) {\n'
-        gen += '    ProfileLayerSettings *layer_settings = &JsonLoader::Find(physicalDeviceData->instance())->layer_settings;\n'
-        gen += '    while (place) {\n'
-        gen += '        VkBaseOutStructure *structure = (VkBaseOutStructure *)place;\n\n'
-        gen += '        // These switch statements check which struct is in the pNext chain and, if the physical device has the proper extension,\n'
-        gen += '        // fill the struct with any override data provided by the PhysicalDeviceData object.\n\n'
-        gen += '        switch (structure->sType) {\n'
-        gen += '            // VK_KHR_portability_subset is a special case since it can also be emulated by the Profiles layer.\n'
-        gen += '            case VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PORTABILITY_SUBSET_PROPERTIES_KHR:\n'
-        gen += '                if (PhysicalDeviceData::HasSimulatedExtension(physicalDeviceData, VK_KHR_PORTABILITY_SUBSET_EXTENSION_NAME) ||\n'
-        gen += '                    layer_settings->simulate.emulate_portability) {\n'
-        gen += '                    VkPhysicalDevicePortabilitySubsetPropertiesKHR *psp = (VkPhysicalDevicePortabilitySubsetPropertiesKHR *)place;\n'
-        gen += '                    void *pNext = psp->pNext;\n'
-        gen += '                    *psp = physicalDeviceData->physical_device_portability_subset_properties_;\n'
-        gen += '                    if (layer_settings->portability.vertexAttributeAccessBeyondStride) {\n'
-        gen += '                        psp->minVertexInputBindingStrideAlignment = layer_settings->portability.minVertexInputBindingStrideAlignment;\n'
-        gen += '                    }\n'
-        gen += '                    psp->pNext = pNext;\n'
-        gen += '                }\n'
-        gen += '                break;\n'
+        gen = PNEXT_STRUCT
+        gen += '\n// Physical device feature and property structs filled by FillPNextChain(), with the PDD member holding the values and\n'
+        gen += '// whether the struct is exposed by the simulated device\n'
+        gen += 'static const std::vector<PNextStruct> &GetPNextStructList() {\n'
+        gen += '    static const std::vector<PNextStruct> structs = {\n'
 
         for property in self.non_extension_properties:
-            gen += self.generate_fill_case(property)
+            gen += self.generate_pnext_struct(property)
         for feature in self.non_extension_features:
-            gen += self.generate_fill_case(feature)
+            gen += self.generate_pnext_struct(feature)
         for ext, properties, features in self.extension_structs:
             gen += self.generate_platform_protect_begin(ext)
             for property in properties:
-                # exception, already handled above
+                # exception, handled by FillPNextChain() since it can be emulated
                 if property == 'VkPhysicalDevicePortabilitySubsetPropertiesKHR':
                     continue
-                gen += self.generate_fill_case(property)
+                gen += self.generate_pnext_struct(property)
             for feature in features:
-                gen += self.generate_fill_case(feature)
+                gen += self.generate_pnext_struct(feature)
             gen += self.generate_platform_protect_end(ext)
 
-        gen += '            default:\n'
-        gen += '                break;\n'
-
-        gen += '        }\n\n'
-        gen += '        place = structure->pNext;\n'
-        gen += '    }\n'
+        gen += '    };\n'
+        gen += '    return structs;\n'
         gen += '}\n'
-
+        gen += FILL_PNEXT_CHAIN
         return gen
 
     def generate_fill_queue_family_properties_pnext_chain(self):
-        gen = '\nvoid FillQueueFamilyPropertiesPNextChain(PhysicalDeviceData *physicalDeviceData, VkQueueFamilyProperties2KHR *pQueueFamilyProperties2, uint32_t count) {\n'
+        gen = '\nvoid FillQueueFamilyPropertiesPNextChain(const PhysicalDeviceData *physicalDeviceData, VkQueueFamilyProperties2KHR *pQueueFamilyProperties2, uint32_t count) {\n'
         gen += '    for (uint32_t i = 0; i < count; ++i) {\n'
         gen += '        void* place = pQueueFamilyProperties2[i].pNext;\n'
         gen += '        while (place) {\n'
@@ -3460,35 +4118,98 @@ class VulkanProfilesLayerGenerator():
 
         return gen
 
-    def generate_load_device_formats(self):
-        gen = '\nvoid LoadDeviceFormats(VkInstance instance, PhysicalDeviceData *pdd, VkPhysicalDevice pd, MapOfVkFormatProperties *dest,\n'
-        gen += '                       MapOfVkFormatProperties3 *dest3) {\n'
-        gen += '    std::vector<VkFormat> formats = {\n'
-        a = registry.enums['VkFormat']
+    def generate_extension_index(self):
+        extensions = list(registry.extensions.values())
+        count = len(extensions)
+
+        # Hash and displace perfect hash of the extension names: the first hash selects a bucket and the displacement of the
+        # bucket seeds the second hash which selects a slot without collision.
+        def hash_name(name, seed):
+            value = 2166136261 ^ seed
+            for c in name.encode():
+                value = ((value ^ c) * 16777619) & 0xFFFFFFFF
+            return value
+
+        slot_count = 1
+        while slot_count < count * 2:
+            slot_count *= 2
+        bucket_count = max(1, slot_count // 4)
+
+        buckets = [[] for _ in range(bucket_count)]
+        for index, extension in enumerate(extensions):
+            buckets[hash_name(extension.name, 0) % bucket_count].append(index)
+
+        displacements = [0] * bucket_count
+        slots = [count] * slot_count
+        for bucket in sorted(range(bucket_count), key=lambda b: len(buckets[b]), reverse=True):
+            if not buckets[bucket]:
+                break
+            displacement = 1
+            while True:
+                candidates = [hash_name(extensions[index].name, displacement) % slot_count for index in buckets[bucket]]
+                if len(set(candidates)) == len(candidates) and all(slots[c] == count for c in candidates):
+                    break
+                displacement += 1
+            displacements[bucket] = displacement
+            for index, candidate in zip(buckets[bucket], candidates):
+                slots[candidate] = index
+
+        gen = '\n// Index of every extension known by the layer, used to store the extension sets as bitsets\n'
+        gen += 'enum ExtensionIndex {\n'
+        for extension in extensions:
+            gen += '    EXTENSION_INDEX_' + extension.upperCaseName + ',\n'
+        gen += '    EXTENSION_INDEX_COUNT\n'
+        gen += '};\n\n'
+        gen += 'static const char *const kExtensionNames[EXTENSION_INDEX_COUNT] = {\n'
+        for extension in extensions:
+            gen += '    "' + extension.name + '",\n'
+        gen += '};\n\n'
+        gen += 'static const uint32_t kExtensionHashBucketCount = ' + str(bucket_count) + ';\n'
+        gen += 'static const uint32_t kExtensionHashSlotCount = ' + str(slot_count) + ';\n\n'
+        gen += 'static const uint32_t kExtensionHashDisplacements[kExtensionHashBucketCount] = {'
+        for i, displacement in enumerate(displacements):
+            gen += ('\n    ' if i % 16 == 0 else ' ') + str(displacement) + ','
+        gen += '\n};\n\n'
+        gen += 'static const uint16_t kExtensionHashSlots[kExtensionHashSlotCount] = {'
+        for i, slot in enumerate(slots):
+            gen += ('\n    ' if i % 16 == 0 else ' ') + str(slot) + ','
+        gen += '\n};\n\n'
+        gen += 'static uint32_t HashExtensionName(const char *extension_name, uint32_t seed) {\n'
+        gen += '    uint32_t hash = 2166136261u ^ seed;\n'
+        gen += '    for (const char *c = extension_name; *c != \'\\0\'; ++c) {\n'
+        gen += '        hash = (hash ^ static_cast<uint8_t>(*c)) * 16777619u;\n'
+        gen += '    }\n'
+        gen += '    return hash;\n'
+        gen += '}\n\n'
+        gen += '// Returns EXTENSION_INDEX_COUNT for an extension unknown by the layer\n'
+        gen += 'static ExtensionIndex GetExtensionIndex(const char *extension_name) {\n'
+        gen += '    const uint32_t displacement = kExtensionHashDisplacements[HashExtensionName(extension_name, 0) % kExtensionHashBucketCount];\n'
+        gen += '    const uint16_t index = kExtensionHashSlots[HashExtensionName(extension_name, displacement) % kExtensionHashSlotCount];\n'
+        gen += '    if (index == EXTENSION_INDEX_COUNT || strcmp(kExtensionNames[index], extension_name) != 0) {\n'
+        gen += '        return EXTENSION_INDEX_COUNT;\n'
+        gen += '    }\n'
+        gen += '    return static_cast<ExtensionIndex>(index);\n'
+        gen += '}\n'
+        return gen
+
+    def generate_format_index(self):
+        gen = '\n// All the non-alias VkFormat values known by the layer\n'
+        gen += 'static const std::vector<VkFormat> &GetFormats() {\n'
+        gen += '    static const std::vector<VkFormat> formats = {\n'
         for format in registry.enums['VkFormat'].values:
             if format not in registry.enums['VkFormat'].aliasValues:
                 gen += '        ' + format + ',\n'
         gen += '    };\n'
-        gen += '    const auto dt = instance_dispatch_table(instance);\n'
-        gen += '    for (const auto format : formats) {\n'
-        gen += '        VkFormatProperties3KHR format_properties_3 = {};\n'
-        gen += '        format_properties_3.sType = VK_STRUCTURE_TYPE_FORMAT_PROPERTIES_3_KHR;\n\n'
-        gen += '        VkFormatProperties2 format_properties = {};\n'
-        gen += '        format_properties.sType = VK_STRUCTURE_TYPE_FORMAT_PROPERTIES_2;\n'
-        gen += '        format_properties.pNext = &format_properties_3;\n\n'
-        gen += '        if (pdd->GetEffectiveVersion() >= VK_API_VERSION_1_1) {\n'
-        gen += '            dt->GetPhysicalDeviceFormatProperties2(pd, format, &format_properties);\n'
-        gen += '        } else {\n'
-        gen += '            dt->GetPhysicalDeviceFormatProperties2KHR(pd, format, &format_properties);\n'
-        gen += '        }\n'
-        gen += '        (*dest)[format] = format_properties.formatProperties;\n'
-        gen += '        (*dest3)[format] = format_properties_3;\n'
-        gen += '    }\n'
+        gen += '    return formats;\n'
+        gen += '}\n\n'
+        gen += 'static const EnumIndex &GetFormatIndex() {\n'
+        gen += '    static const EnumIndex format_index(GetFormats());\n'
+        gen += '    return format_index;\n'
         gen += '}\n'
         return gen
 
     def generate_enumerate_physical_device(self):
-        gen = ENUMERATE_PHYSICAL_DEVICES_BEGIN
+        gen = LOAD_PHYSICAL_DEVICE_DATA_BEGIN
 
         for ext, properties, features in self.extension_structs:
             if ext == 'VK_KHR_portability_subset': # portability subset can be emulated and is handled differently
@@ -3502,7 +4223,7 @@ class VulkanProfilesLayerGenerator():
             version = registry.structs[feature].definedByVersion
             gen += self.generate_physical_device_chain_case(None, version, [], [feature])
 
-        gen += ENUMERATE_PHYSICAL_DEVICES_MIDDLE
+        gen += LOAD_PHYSICAL_DEVICE_DATA_MIDDLE
 
         for i in range(registry.headerVersionNumber.major):
             version_major = i + 1
@@ -3510,7 +4231,7 @@ class VulkanProfilesLayerGenerator():
             for j in range(registry.headerVersionNumber.minor):
                 version_minor = j + 1
                 minor = str(version_minor)
-                gen += '\n            // VK_VULKAN_' + str(major) + '_' + str(minor) + '\n'
+                gen += '\n    // VK_VULKAN_' + str(major) + '_' + str(minor) + '\n'
                 for ext, property_names, feature_names in self.extension_structs:
                     for property_name in property_names:
                         property = registry.structs[property_name]
@@ -3524,7 +4245,7 @@ class VulkanProfilesLayerGenerator():
                                     promoted_version = alias.definedByVersion
                                     break
                         if promoted_version and version_major == promoted_version.major and version_minor == promoted_version.minor:
-                            gen += '            TransferValue(&(pdd.physical_device_vulkan_' + major + minor + '_properties_), &(pdd.' + self.create_var_name(property_name) + '), pdd.vulkan_' + major + '_' + minor + '_properties_written_);\n'
+                            gen += '    TransferValue(&(pdd.physical_device_vulkan_' + major + minor + '_properties_), &(pdd.' + self.create_var_name(property_name) + '), pdd.vulkan_' + major + '_' + minor + '_properties_written_);\n'
                     for feature_name in feature_names:
                         feature = registry.structs[feature_name]
                         promoted_version = None
@@ -3537,16 +4258,17 @@ class VulkanProfilesLayerGenerator():
                                     promoted_version = alias.definedByVersion
                                     break
                         if promoted_version and version_major == promoted_version.major and version_minor == promoted_version.minor:
-                            gen += '            TransferValue(&(pdd.physical_device_vulkan_' + major + minor + '_features_), &(pdd.' + self.create_var_name(feature_name) + '), pdd.vulkan_' + major + '_' + minor + '_features_written_);\n'
+                            gen += '    TransferValue(&(pdd.physical_device_vulkan_' + major + minor + '_features_), &(pdd.' + self.create_var_name(feature_name) + '), pdd.vulkan_' + major + '_' + minor + '_features_written_);\n'
 
-        gen += ENUMERATE_PHYSICAL_DEVICES_END
+        gen += LOAD_PHYSICAL_DEVICE_DATA_END
+        gen += ENUMERATE_PHYSICAL_DEVICES
 
         return gen
 
     def generate_physical_device_chain_case(self, ext, version, property_names, feature_names):
         gen = self.generate_platform_protect_begin(ext)
         if ext:
-            gen += '\n                if ('
+            gen += '\n        if ('
             first = True
             for promotedTo in [ext] + registry.getExtensionPromotedToExtensionList(ext):
                 if first:
@@ -3554,20 +4276,20 @@ class VulkanProfilesLayerGenerator():
                 else:
                     gen += ' || '
                 gen += 'PhysicalDeviceData::HasExtension(&pdd, '
-                gen += registry.extensions[promotedTo].upperCaseName + '_EXTENSION_NAME'
+                gen += 'EXTENSION_INDEX_' + registry.extensions[promotedTo].upperCaseName
                 gen += ')'
             gen += ') {\n'
         else:
-            gen += '\n                if (api_version_above_' + str(version.major) + '_' + str(version.minor) + ') {\n'
+            gen += '\n        if (api_version_above_' + str(version.major) + '_' + str(version.minor) + ') {\n'
         for property_name in property_names:
             name = self.create_var_name(property_name)
-            gen += '                    pdd.' + name + '.pNext = property_chain.pNext;\n\n'
-            gen += '                    property_chain.pNext = &(pdd.' + name + ');\n'
+            gen += '            pdd.' + name + '.pNext = property_chain.pNext;\n\n'
+            gen += '            property_chain.pNext = &(pdd.' + name + ');\n'
         for feature_name in feature_names:
             name = self.create_var_name(feature_name)
-            gen += '                    pdd.' + name + '.pNext = feature_chain.pNext;\n\n'
-            gen += '                    feature_chain.pNext = &(pdd.' + name + ');\n'
-        gen += '                }\n'
+            gen += '            pdd.' + name + '.pNext = feature_chain.pNext;\n\n'
+            gen += '            feature_chain.pNext = &(pdd.' + name + ');\n'
+        gen += '        }\n'
         gen += self.generate_platform_protect_end(ext)
         return gen
 
@@ -3583,14 +4305,17 @@ class VulkanProfilesLayerGenerator():
         gen += '}\n'
         return gen
 
-    def generate_fill_case(self, struct):
+    def generate_pnext_struct(self, struct):
         structure = registry.structs[struct]
         if structure.name in self.ignored_structs:
             return ''
-        gen = '            case ' + structure.sType + ':\n'
-        gen += '                '
+        gen = '        {' + structure.sType + ', sizeof(' + structure.name + '),\n'
+        gen += '         [](const PhysicalDeviceData *physicalDeviceData) -> const void * { return &physicalDeviceData->' + self.create_var_name(structure.name) + '; },\n'
+        if structure.definedByExtensions or (structure.definedByVersion and (structure.definedByVersion.major != 1 or structure.definedByVersion.minor != 0)):
+            gen += '         [](const PhysicalDeviceData *physicalDeviceData) { return '
+        else:
+            gen += '         [](const PhysicalDeviceData *) { return '
         if structure.definedByExtensions:
-            gen += 'if ('
             first = True
             for ext in structure.definedByExtensions:
                 if first:
@@ -3603,19 +4328,14 @@ class VulkanProfilesLayerGenerator():
                     else:
                         gen += '('
                     gen += 'PhysicalDeviceData::HasSimulatedExtension(physicalDeviceData, '
-                    gen += registry.extensions[promotedTo].upperCaseName + '_EXTENSION_NAME'
+                    gen += 'EXTENSION_INDEX_' + registry.extensions[promotedTo].upperCaseName
                     gen += ')'
                 gen += ')'
-            gen += ') '
         elif structure.definedByVersion and (structure.definedByVersion.major != 1 or structure.definedByVersion.minor != 0):
-            gen += 'if (physicalDeviceData->GetEffectiveVersion() >= ' + structure.definedByVersion.versionMacro + ') '
-        gen += '{\n'
-        gen += '                    ' + structure.name + ' *data = (' + structure.name + ' *)place;\n'
-        gen += '                    void *pNext = data->pNext;\n'
-        gen += '                    *data = physicalDeviceData->' + self.create_var_name(structure.name) + ';\n'
-        gen += '                    data->pNext = pNext;\n'
-        gen += '                }\n'
-        gen += '                break;\n'
+            gen += 'physicalDeviceData->GetEffectiveVersion() >= ' + structure.definedByVersion.versionMacro
+        else:
+            gen += 'true'
+        gen += '; }},\n'
         return gen
 
     def generate_get_value_function(self, structure):
@@ -3625,78 +4345,176 @@ class VulkanProfilesLayerGenerator():
         gen += 'bool JsonLoader::GetStruct(const char* device_name, bool requested_profile, const Json::Value &parent, ' + structure + ' *dest) {\n'
         gen += '    (void)dest;\n'
         gen += '    (void)requested_profile;\n'
-        gen += '    LogMessage(&layer_settings, DEBUG_REPORT_DEBUG_BIT, \"\\tJsonLoader::GetStruct(' + structure + ')\\n\");\n'
+        gen += '    LOG_MESSAGE(&layer_settings, DEBUG_REPORT_DEBUG_BIT, \"\\tJsonLoader::GetStruct(' + structure + ')\\n\");\n'
+        gen += '    struct_name_ = "' + structure + '";\n'
         gen += '    bool valid = true;\n'
-        gen += '    for (const auto &member : parent.getMemberNames()) {\n'
+        cases = dict()
         for member_name in registry.structs[structure].members:
             member = registry.structs[structure].members[member_name]
+            line = None
             not_modifiable = str(member.limittype == 'exact' or member.limittype == 'noauto').lower()
             if member.isArray:
-                gen += '        GetArray(device_name, parent, member, "' + member_name + '", dest->' + member_name + ', ' + not_modifiable + ');\n'
+                line = 'GetArray(device_name, parent, member, "' + member_name + '", dest->' + member_name + ', ' + not_modifiable + ');'
             elif member.type in registry.enums:
-                gen += '        GET_VALUE_ENUM_WARN(member, ' + member_name + ', ' + not_modifiable + ', requested_profile, WarnIfNotEqualEnum);\n'
+                line = 'GET_VALUE_ENUM_WARN(member, ' + member_name + ', ' + not_modifiable + ', requested_profile, WarnIfNotEqualEnum);'
             elif member.type == 'VkConformanceVersion' or member.type == 'VkToolPurposeFlags':
                 continue
             elif member.type == 'VkBool32':
-                gen += '        GET_VALUE_WARN(member, ' + member_name + ', ' + not_modifiable + ', requested_profile, WarnIfNotEqualBool);\n'
+                line = 'GET_VALUE_WARN(member, ' + member_name + ', ' + not_modifiable + ', requested_profile, WarnIfNotEqualBool);'
             elif member.type == 'size_t':
                 if 'min' in member.limittype:
-                    gen += '        GET_VALUE_SIZE_T_WARN(member, ' + member_name + ', ' + not_modifiable + ', requested_profile, WarnIfLesserSizet);\n'
+                    line = 'GET_VALUE_SIZE_T_WARN(member, ' + member_name + ', ' + not_modifiable + ', requested_profile, WarnIfLesserSizet);'
                 elif 'max' in member.limittype or 'bits' in member.limittype:
-                    gen += '        GET_VALUE_SIZE_T_WARN(member, ' + member_name + ', ' + not_modifiable + ', requested_profile, WarnIfGreaterSizet);\n'
+                    line = 'GET_VALUE_SIZE_T_WARN(member, ' + member_name + ', ' + not_modifiable + ', requested_profile, WarnIfGreaterSizet);'
                 #elif member.limittype == 'pot':
                 else:
-                    gen += '        GET_VALUE_SIZE_T_WARN(member, ' + member_name + ', ' + not_modifiable + ', requested_profile, WarnIfNotEqualSizet);\n'
+                    line = 'GET_VALUE_SIZE_T_WARN(member, ' + member_name + ', ' + not_modifiable + ', requested_profile, WarnIfNotEqualSizet);'
             elif member.type == 'uint64_t' or member.type == 'int32_t' or member.type == 'VkDeviceSize':
                 if 'min' in member.limittype:
-                    gen += '        GET_VALUE_WARN(member, ' + member_name + ', ' + not_modifiable + ', requested_profile, WarnIfLesser);\n'
+                    line = 'GET_VALUE_WARN(member, ' + member_name + ', ' + not_modifiable + ', requested_profile, WarnIfLesser);'
                 elif 'max' in member.limittype or 'bits' in member.limittype:
-                    gen += '        GET_VALUE_WARN(member, ' + member_name + ', ' + not_modifiable + ', requested_profile, WarnIfGreater);\n'
+                    line = 'GET_VALUE_WARN(member, ' + member_name + ', ' + not_modifiable + ', requested_profile, WarnIfGreater);'
                 else:
-                    gen += '        GET_VALUE_WARN(member, ' + member_name + ', ' + not_modifiable + ', requested_profile, WarnIfNotEqual64u);\n'
+                    line = 'GET_VALUE_WARN(member, ' + member_name + ', ' + not_modifiable + ', requested_profile, WarnIfNotEqual64u);'
             elif member.type == 'int64_t':
                 if 'min' in member.limittype:
-                    gen += '        GET_VALUE_WARN(member, ' + member_name + ', ' + not_modifiable + ', requested_profile, WarnIfLesser);\n'
+                    line = 'GET_VALUE_WARN(member, ' + member_name + ', ' + not_modifiable + ', requested_profile, WarnIfLesser);'
                 elif 'max' in member.limittype or 'bits' in member.limittype:
-                    gen += '        GET_VALUE_WARN(member, ' + member_name + ', ' + not_modifiable + ', requested_profile, WarnIfGreater);\n'
+                    line = 'GET_VALUE_WARN(member, ' + member_name + ', ' + not_modifiable + ', requested_profile, WarnIfGreater);'
                 else:
-                    gen += '        GET_VALUE_WARN(member, ' + member_name + ', ' + not_modifiable + ', requested_profile, WarnIfNotEquali64);\n'
+                    line = 'GET_VALUE_WARN(member, ' + member_name + ', ' + not_modifiable + ', requested_profile, WarnIfNotEquali64);'
             elif member.type == 'uint32_t':
                 if 'min' in member.limittype:
-                    gen += '        GET_VALUE_WARN(member, ' + member_name + ', ' + not_modifiable + ', requested_profile, WarnIfLesser);\n'
+                    line = 'GET_VALUE_WARN(member, ' + member_name + ', ' + not_modifiable + ', requested_profile, WarnIfLesser);'
                 elif 'max' in member.limittype or 'bits' in member.limittype:
-                    gen += '        GET_VALUE_WARN(member, ' + member_name + ', ' + not_modifiable + ', requested_profile, WarnIfGreater);\n'
+                    line = 'GET_VALUE_WARN(member, ' + member_name + ', ' + not_modifiable + ', requested_profile, WarnIfGreater);'
                 else:
-                    gen += '        GET_VALUE_WARN(member, ' + member_name + ', ' + not_modifiable + ', requested_profile, WarnIfNotEqual32u);\n'
+                    line = 'GET_VALUE_WARN(member, ' + member_name + ', ' + not_modifiable + ', requested_profile, WarnIfNotEqual32u);'
             elif member.type == 'VkExtent2D' or member.type == 'VkExtent3D':
                 if 'min' in member.limittype:
-                    gen += '        GET_VALUE_WARN(member, ' + member_name + ', ' + not_modifiable + ', requested_profile, WarnIfLesser);\n'
+                    line = 'GET_VALUE_WARN(member, ' + member_name + ', ' + not_modifiable + ', requested_profile, WarnIfLesser);'
                 elif 'max' in member.limittype or 'bits' in member.limittype:
-                    gen += '        GET_VALUE_WARN(member, ' + member_name + ', ' + not_modifiable + ', requested_profile, WarnIfGreater);\n'
+                    line = 'GET_VALUE_WARN(member, ' + member_name + ', ' + not_modifiable + ', requested_profile, WarnIfGreater);'
                 else:
-                    gen += '        GET_VALUE_WARN(member, ' + member_name + ', ' + not_modifiable + ', requested_profile, WarnIfNotEqual32u);\n'
+                    line = 'GET_VALUE_WARN(member, ' + member_name + ', ' + not_modifiable + ', requested_profile, WarnIfNotEqual32u);'
             elif member.type == 'float':
                 if 'min' in member.limittype:
-                    gen += '        GET_VALUE_WARN(member, ' + member_name + ', ' + not_modifiable + ', requested_profile, WarnIfLesserFloat);\n'
+                    line = 'GET_VALUE_WARN(member, ' + member_name + ', ' + not_modifiable + ', requested_profile, WarnIfLesserFloat);'
                 elif 'max' in member.limittype:
-                    gen += '        GET_VALUE_WARN(member, ' + member_name + ', ' + not_modifiable + ', requested_profile, WarnIfGreaterFloat);\n'
+                    line = 'GET_VALUE_WARN(member, ' + member_name + ', ' + not_modifiable + ', requested_profile, WarnIfGreaterFloat);'
                 else:
-                    gen += '        GET_VALUE_WARN(member, ' + member_name + ', ' + not_modifiable + ', requested_profile, WarnIfNotEqualFloat);\n'
+                    line = 'GET_VALUE_WARN(member, ' + member_name + ', ' + not_modifiable + ', requested_profile, WarnIfNotEqualFloat);'
             elif member.limittype == 'bitmask':
-                gen += '        GET_VALUE_FLAG_WARN(member, ' + member_name + ', ' + not_modifiable + ', requested_profile);\n'
+                line = 'GET_VALUE_FLAG_WARN(member, ' + member_name + ', ' + not_modifiable + ', requested_profile);'
             elif member.limittype == 'min': # enum values
-                gen += '        GET_VALUE_ENUM_WARN(member, ' + member_name + ', ' + not_modifiable + ', requested_profile, WarnIfLesser);\n'
+                line = 'GET_VALUE_ENUM_WARN(member, ' + member_name + ', ' + not_modifiable + ', requested_profile, WarnIfLesser);'
             elif member.limittype == 'max' or member.limittype == 'bits': # enum values
-                gen += '        GET_VALUE_ENUM_WARN(member, ' + member_name + ', ' + not_modifiable + ', requested_profile, WarnIfGreater);\n'
+                line = 'GET_VALUE_ENUM_WARN(member, ' + member_name + ', ' + not_modifiable + ', requested_profile, WarnIfGreater);'
             else:
                 print("ERROR: Unsupported limittype '{0}' in member '{1}' of structure '{2}'".format(member.limittype, member_name, structure))
+            if line is not None:
+                cases.setdefault(self.hash_member_name(member_name), []).append((member_name, line))
 
-        gen += '    }\n'
+        gen += self.generate_member_switch(cases)
         gen += '    return valid;\n'
         gen += '}\n\n'
         gen += self.generate_platform_protect_end(structure)
         return gen
 
+    def generate_get_value_physical_device_properties(self):
+        cases = dict()
+        lines = [
+            ('apiVersion', 'GET_VALUE(member, apiVersion, false, requested_profile);'),
+            ('driverVersion', 'GET_VALUE(member, driverVersion, true, requested_profile);'),
+            ('vendorID', 'GET_VALUE(member, vendorID, true, requested_profile);'),
+            ('deviceID', 'GET_VALUE(member, deviceID, true, requested_profile);'),
+            ('deviceType', 'GET_VALUE_ENUM_WARN(member, deviceType, true, requested_profile, WarnIfNotEqualEnum);'),
+            ('deviceName', 'GetArray(device_name, parent, member, "deviceName", dest->deviceName, true);  // size < VK_MAX_PHYSICAL_DEVICE_NAME_SIZE'),
+            ('pipelineCacheUUID', 'GetArray(device_name, parent, member, "pipelineCacheUUID", dest->pipelineCacheUUID, true);  // size == VK_UUID_SIZE'),
+        ]
+        for member_name, line in lines:
+            cases.setdefault(self.hash_member_name(member_name), []).append((member_name, line))
+
+        gen = '\nbool JsonLoader::GetStruct(const char* device_name, bool requested_profile, const Json::Value &parent, VkPhysicalDeviceProperties *dest) {\n'
+        gen += '    LOG_MESSAGE(&layer_settings, DEBUG_REPORT_DEBUG_BIT, \"\\tJsonLoader::GetStruct(VkPhysicalDeviceProperties)\\n\");\n'
+        gen += '    bool valid = true;\n'
+        gen += '    if (!GetStruct(device_name, requested_profile, parent["limits"], &dest->limits)) {\n'
+        gen += '        valid = false;\n'
+        gen += '    }\n'
+        gen += '    if (!GetStruct(device_name, requested_profile, parent["sparseProperties"], &dest->sparseProperties)) {\n'
+        gen += '        valid = false;\n'
+        gen += '    }\n'
+        gen += '    struct_name_ = "VkPhysicalDeviceProperties";\n'
+        gen += self.generate_member_switch(cases)
+        gen += '    return valid;\n'
+        gen += '}\n'
+        return gen
+
+    def generate_get_value_portability_subset_properties(self):
+        cases = dict()
+        cases.setdefault(self.hash_member_name('minVertexInputBindingStrideAlignment'), []).append(('minVertexInputBindingStrideAlignment',
+            'GET_VALUE_WARN(member, minVertexInputBindingStrideAlignment, false, requested_profile, WarnIfLesser);'))
+
+        gen = '\nbool JsonLoader::GetStruct(const char* device_name, bool requested_profile, const Json::Value &parent, VkPhysicalDevicePortabilitySubsetPropertiesKHR *dest) {\n'
+        gen += '    LOG_MESSAGE(&layer_settings, DEBUG_REPORT_DEBUG_BIT, \"\\tJsonLoader::GetStruct(VkPhysicalDevicePortabilitySubsetPropertiesKHR)\\n\");\n'
+        gen += '    struct_name_ = "VkPhysicalDevicePortabilitySubsetPropertiesKHR";\n'
+        gen += '    bool valid = true;\n'
+        gen += self.generate_member_switch(cases)
+        gen += '    return valid;\n'
+        gen += '}\n'
+        return gen
+
+    def generate_get_value_portability_subset_features(self):
+        members = ['constantAlphaColorBlendFactors', 'events', 'imageViewFormatReinterpretation', 'imageViewFormatSwizzle',
+                   'imageView2DOn3DImage', 'multisampleArrayImage', 'mutableComparisonSamplers', 'pointPolygons', 'samplerMipLodBias',
+                   'separateStencilMaskRef', 'shaderSampleRateInterpolationFunctions', 'tessellationIsolines', 'tessellationPointMode',
+                   'triangleFans', 'vertexAttributeAccessBeyondStride']
+        cases = dict()
+        for member_name in members:
+            cases.setdefault(self.hash_member_name(member_name), []).append((member_name,
+                'GET_VALUE_WARN(member, ' + member_name + ', false, requested_profile, WarnIfNotEqualBool);'))
+
+        gen = '\nbool JsonLoader::GetStruct(const char* device_name, bool requested_profile, const Json::Value &parent, VkPhysicalDevicePortabilitySubsetFeaturesKHR *dest) {\n'
+        gen += '    LOG_MESSAGE(&layer_settings, DEBUG_REPORT_DEBUG_BIT, \"\\tJsonLoader::GetStruct(VkPhysicalDevicePortabilitySubsetFeaturesKHR)\\n\");\n'
+        gen += '    struct_name_ = "VkPhysicalDevicePortabilitySubsetFeaturesKHR";\n'
+        gen += '    bool valid = true;\n'
+        gen += '    if (layer_settings.simulate.emulate_portability) {\n'
+        gen += '        // The emulated values replace the profile values, as soon as the profile defines the structure\n'
+        gen += '        if (!parent.empty()) {\n'
+        for member_name in members:
+            gen += '            dest->' + member_name + ' = layer_settings.portability.' + member_name + ';\n'
+        gen += '        }\n'
+        gen += '        return valid;\n'
+        gen += '    }\n'
+        gen += self.generate_member_switch(cases)
+        gen += '    return valid;\n'
+        gen += '}\n'
+        return gen
+
+    def hash_member_name(self, name):
+        # Must match HashMemberName() in the generated layer
+        result = 2166136261
+        for c in name.encode('utf-8'):
+            result = ((result ^ c) * 16777619) & 0xFFFFFFFF
+        return result
+
+    def generate_member_switch(self, cases):
+        if not cases:
+            return ''
+        gen = '    for (Json::Value::const_iterator it = parent.begin(), end = parent.end(); it != end; ++it) {\n'
+        gen += '        const std::string member = it.name();\n'
+        gen += '        switch (HashMemberName(member.c_str())) {\n'
+        for hash, members in cases.items():
+            gen += '            case ' + '0x{0:08X}u'.format(hash) + ':\n'
+            for member_name, line in members:
+                gen += '                ' + line + '\n'
+            gen += '                break;\n'
+        gen += '            default:\n'
+        gen += '                break;\n'
+        gen += '        }\n'
+        gen += '    }\n'
+        return gen
+
     def get_read_from_type(self, type):
         if type == 'uint32_t':
             return 'asUint()'